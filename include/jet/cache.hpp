@@ -0,0 +1,222 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "json/value.h"
+
+#include "jet/defines.h"
+#include "jet/peerasync.hpp"
+
+namespace hbk {
+	namespace jet {
+		class CallbackGuard;
+		class MappedFile;
+
+		/// fetches and keeps everything matching to the given matcher. Changes may be notified by callback functions.
+		///
+		/// The cache is read-mostly. It is split into shards by the hash of the path.
+		/// Readers work on immutable snapshots of the shards and get shared immutable entries.
+		/// Changing the value of an element replaces its entry. Adding or removing an element replaces the snapshot of its shard (read-copy-update).
+		/// Readers do not wait while the fetch composes a new entry, shard or index. Access is not wait-free though: shards, index and entries
+		/// are taken by std::atomic_load on shared pointers. With libstdc++ that locks a mutex from a process-wide pool for the duration
+		/// of the reference count update, the same pool the updating fetch uses when publishing.
+		///
+		/// All elements are kept in a path index as well, which is ordered by path. It is updated together with the shards.
+		/// The index is split into chunks of limited size. Adding or removing an element replaces one chunk and the list of chunks.
+		/// Readers iterate over an immutable snapshot of the index.
+		///
+		/// The cache can be saved to a snapshot file. A cache started with a snapshot file serves its elements before the fetch delivers anything.
+		/// The file is memory-mapped, values are parsed on first access.
+		/// The restored elements are reconciled with the fetch by comparing their serialized value:
+		/// - An element notified with the same value is kept as it is. No callback is called.
+		/// - An element notified with a different value is changed. The change callback is called.
+		/// - Elements not notified until the response to the fetch request arrives are gone. The remove callback is called.
+		/// class is thread-safe
+		class cache {
+		public:
+			/// \param path Path of the state
+			/// \param value Value of the state
+			using Cb = std::function < void ( const std::string& path, const Json::Value& value) >;
+
+			/// the latest value of an element
+			struct Entry {
+				Entry(const Json::Value& v, uint64_t ver);
+				const Json::Value value;
+				/// 1 when the element was added, incremented on each change. Elements restored from a snapshot file keep their version.
+				const uint64_t version;
+			};
+			using entryPtr_t = std::shared_ptr < const Entry >;
+
+			using visitor_t = std::function < void ( const std::string& path, const entryPtr_t& entry) >;
+
+			/// \param shardCount Adding or removing an element copies the snapshot of one shard. More shards keep those small.
+			cache(hbk::jet::PeerAsync& peer, hbk::jet::matcher_t match, unsigned int shardCount = 256);
+			/// Start with the elements of a snapshot file. The cache starts empty if the snapshot file can not be used.
+			/// \param snapshotFileName Written by saveSnapshotFile(). The file may not be changed while the cache exists, saving a new snapshot replaces it.
+			/// \param addCb, changeCb, removeCb as for setCbs(). Given here, they are set before the fetch reconciles the restored elements.
+			cache(hbk::jet::PeerAsync& peer, hbk::jet::matcher_t match, const std::string& snapshotFileName, Cb addCb = Cb(), Cb changeCb = Cb(), Cb removeCb = Cb(), unsigned int shardCount = 256);
+			cache(const cache&) = delete;
+			cache& operator=(const cache&) = delete;
+			virtual ~cache();
+
+			/// set specific callback to cb_t() if there is no callback to be called!
+			/// Callbacks are called after the cache got updated.
+			void setCbs(Cb addCb, Cb changeCb, Cb removeCb);
+
+			/// \return an empty object if no entry with this path does exist
+			Json::Value getEntry(const std::string &path) const;
+
+			/// Does not copy the value
+			/// \return empty pointer if no entry with this path does exist
+			entryPtr_t find(const std::string &path) const;
+
+			/// visits all entries one shard after the other. Changes happening meanwhile might be visited or not.
+			void forEach(const visitor_t& visitor) const;
+
+			/// visits all entries whose path starts with prefix in ascending order of the path
+			void forEachWithPrefix(const std::string& prefix, const visitor_t& visitor) const;
+
+			/// visits all entries with first <= path < last in ascending order of the path
+			/// \param last empty for no upper bound
+			void forEachInRange(const std::string& first, const std::string& last, const visitor_t& visitor) const;
+
+			/// visits all entries whose path matches the pattern in ascending order of the path
+			/// \param pattern '?' matches one character, '*' matches any characters within one level of the path, '**' matches any characters including '/'
+			void forEachMatching(const std::string& pattern, const visitor_t& visitor) const;
+
+			/// \return number of entries
+			size_t size() const;
+
+			/// Save all elements in a snapshot file. The file is written under a temporary name and renamed when complete.
+			/// \return 0 on success, -1 on error
+			int saveSnapshotFile(const std::string& fileName) const;
+
+		private:
+			struct Slot {
+				Slot(const std::string& p, size_t h, const entryPtr_t& e);
+				/// restored from a snapshot file, the entry is created on first access
+				Slot(const std::string& p, size_t h, const char* pValue, size_t valueLength, uint64_t ver);
+				const std::string path;
+				const size_t hash;
+				/// accessed by std::atomic_load, std::atomic_store and std::atomic_compare_exchange_strong only
+				entryPtr_t entry;
+
+				/// serialized value in the snapshot file, nullptr if not restored
+				const char* pSnapshotValue;
+				const size_t snapshotValueLength;
+				const uint64_t snapshotVersion;
+				/// restored elements are confirmed when being notified by the fetch
+				std::atomic < bool > confirmed;
+			};
+			using slotPtr_t = std::shared_ptr < Slot >;
+			/// sorted by hash
+			using slots_t = std::vector < slotPtr_t >;
+			using snapshot_t = std::shared_ptr < const slots_t >;
+
+			struct Shard {
+				Shard();
+				/// current snapshot, accessed by std::atomic_load and std::atomic_store only
+				snapshot_t slots;
+				std::mutex writeMtx;
+			};
+
+			/// part of the path index, sorted by path
+			using chunk_t = std::vector < slotPtr_t >;
+			using chunkPtr_t = std::shared_ptr < const chunk_t >;
+			/// chunks sorted by the path of their first slot
+			using index_t = std::vector < chunkPtr_t >;
+			using indexPtr_t = std::shared_ptr < const index_t >;
+
+			struct Callbacks {
+				Cb addCb;
+				Cb changeCb;
+				Cb removeCb;
+			};
+
+			enum updateResult_t {
+				ADDED,
+				CHANGED,
+				/// a restored element got notified with the same value
+				CONFIRMED
+			};
+
+			void fetchCb( const Json::Value& params, int status);
+			void fetchResultCb(const Json::Value& result);
+			/// the response to the fetch request reaches the cache through m_guard
+			void addFetch();
+
+			/// \return entry of the slot, restored entries are parsed on first access
+			static entryPtr_t loadEntry(Slot& slot);
+
+			/// \return 0 on success, -1 on error
+			int loadSnapshotFile(const std::string& fileName);
+			/// remove restored elements that were not notified by the fetch
+			void removeUnconfirmed();
+
+			/// \return index of the slot with this path or slots.size()
+			static size_t findSlot(const slots_t& slots, size_t hash, const std::string& path);
+
+			/// @param proceed false stops the iteration
+			/// @param filter only entries passing are visited
+			void visitFrom(const std::string& first, const std::function < bool (const std::string& path) >& proceed,
+				const std::function < bool (const std::string& path) >& filter, const visitor_t& visitor) const;
+			/// m_indexMtx needs to be locked by the caller!
+			void addToIndex(const slotPtr_t& slot);
+			/// m_indexMtx needs to be locked by the caller!
+			void removeFromIndex(const std::string& path);
+
+			updateResult_t update(const std::string& path, const Json::Value& value);
+			/// \return true if the element was known
+			bool remove(const std::string& path);
+			void clear();
+
+			hbk::jet::PeerAsync& m_peer;
+			hbk::jet::matcher_t m_match;
+			std::hash < std::string > m_hash;
+			std::vector < Shard > m_shards;
+			std::atomic < size_t > m_size;
+			/// current snapshot of the path index, accessed by std::atomic_load and std::atomic_store only
+			indexPtr_t m_index;
+			std::mutex m_indexMtx;
+			/// accessed by std::atomic_load and std::atomic_store only
+			std::shared_ptr < const Callbacks > m_callbacks;
+			/// restored slots point into the mapped snapshot file
+			std::shared_ptr < const MappedFile > m_snapshotFile;
+			/// closed on destruction, the response to the fetch request might arrive afterwards
+			std::shared_ptr < CallbackGuard > m_guard;
+			hbk::jet::fetchId_t m_fetchId;
+		};
+	}
+}
@@ -0,0 +1,129 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "jet/defines.h"
+
+namespace hbk
+{
+	namespace jet
+	{
+		class MatcherSet;
+
+		/// Evaluates a matcher_t locally, the way the jet daemon does for fetch and get.
+		/// All conditions are AND gated. Empty strings are no condition.
+		///
+		/// The needles are prepared once on construction, case insensitive needles are folded to lower case.
+		/// For case insensitive matching, the path is folded once, all conditions are evaluated on the folded path.
+		/// Substrings are searched 16 candidate positions at once using SSE2 if available.
+		/// \note case folding is limited to ASCII characters
+		class CompiledMatcher
+		{
+		public:
+			/// matches everything
+			CompiledMatcher();
+			explicit CompiledMatcher(const matcher_t& matcher);
+
+			/// \return true if the path fulfills all conditions
+			bool match(const std::string& path) const;
+			bool match(const char* pPath, size_t length) const;
+
+			const matcher_t& getMatcher() const
+			{
+				return m_matcher;
+			}
+
+			/// fold ASCII upper case characters to lower case
+			static void foldCase(const char* pText, size_t length, char* pFolded);
+			static std::string foldCase(const std::string& text);
+
+			/// \return true if the needle is part of the text
+			static bool contains(const char* pText, size_t length, const std::string& needle);
+			/// \return true if the text starts with the prefix
+			static bool startsWith(const char* pText, size_t length, const std::string& prefix);
+			/// \return true if the text ends with the suffix
+			static bool endsWith(const char* pText, size_t length, const std::string& suffix);
+
+		private:
+			friend class MatcherSet;
+
+			/// @param pPath Already folded if the matcher is case insensitive
+			bool matchPrepared(const char* pPath, size_t length) const;
+
+			matcher_t m_matcher;
+			std::string m_contains;
+			std::string m_startsWith;
+			std::string m_endsWith;
+			std::string m_equals;
+			std::string m_equalsNot;
+			std::vector < std::string > m_containsAllOf;
+		};
+
+		/// Many matchers evaluated at once against one path.
+		///
+		/// The path is folded once for all case insensitive matchers.
+		/// Matchers with an equals condition are found by a hash lookup of the path, only those are evaluated completely.
+		/// All other matchers are evaluated one after the other with their cheapest conditions first.
+		class MatcherSet
+		{
+		public:
+			MatcherSet();
+
+			/// \return index of the matcher in the set
+			size_t add(const matcher_t& matcher);
+
+			/// \return number of matchers in the set
+			size_t size() const
+			{
+				return m_matchers.size();
+			}
+
+			void clear();
+
+			/// @param matches Is cleared and filled with the indices of all matchers matching the path in ascending order
+			void match(const std::string& path, std::vector < size_t >& matches) const;
+
+			/// \return true if any of the matchers matches the path
+			bool matchAny(const std::string& path) const;
+
+		private:
+			using equalsIndex_t = std::unordered_map < std::string, std::vector < size_t > >;
+
+			/// matchers with equals condition, key is the prepared equals condition
+			equalsIndex_t m_caseSensitiveEquals;
+			equalsIndex_t m_caseInsensitiveEquals;
+			/// matchers without equals condition
+			std::vector < size_t > m_caseSensitive;
+			std::vector < size_t > m_caseInsensitive;
+
+			std::vector < CompiledMatcher > m_matchers;
+		};
+	}
+}
@@ -0,0 +1,162 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#pragma once
+
+#if !defined(__cpp_impl_coroutine)
+#error "jet/coroutine.hpp requires C++20 coroutines"
+#endif
+
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <utility>
+
+#include "jet/future.hpp"
+
+/// Coroutine support for the futures of the jet peer.
+///
+/// A future can be awaited by a coroutine:
+/// \code
+/// hbk::jet::Future < int > sequence(hbk::jet::PeerAsync& peer)
+/// {
+/// 	hbk::jet::JsonRpcResponseObject response = co_await peer.setStateValue("a", 1, 1.0);
+/// 	response = co_await peer.callMethod("b", Json::Value(), 1.0);
+/// 	co_return response[hbk::jsonrpc::RESULT].asInt();
+/// }
+/// \endcode
+/// Coroutines returning a future can be awaited themselves or be collected using whenAll().
+/// Each sequence costs one coroutine frame and one future state per request, not a thread.
+///
+/// Coroutines awaiting a future of PeerAsync are resumed in its eventloop. This includes requests canceled by
+/// PeerAsync::cancelRequest() or by stopping the peer. Coroutines still waiting to be resumed when the peer is destroyed
+/// are resumed by the destructor. Other futures resume the coroutine in the context that completes them unless an
+/// executor was set on their promise.
+/// \warning Do not block the eventloop while waiting for a future from within a coroutine resumed by it.
+
+namespace hbk
+{
+	namespace jet
+	{
+		/// suspends the awaiting coroutine until the future is ready
+		template < class T >
+		class FutureAwaiter
+		{
+		public:
+			explicit FutureAwaiter(Future < T > future)
+				: m_future(std::move(future))
+			{
+			}
+
+			bool await_ready() const
+			{
+				return m_future.isReady();
+			}
+
+			void await_suspend(std::coroutine_handle < > handle)
+			{
+				executor_t executor;
+				{
+					std::lock_guard < std::mutex > lock(m_future.m_state->mtx);
+					executor = m_future.m_state->executor;
+				}
+				if (executor) {
+					m_future.onReady([executor, handle]()
+					{
+						executor([handle]()
+						{
+							handle.resume();
+						});
+					});
+					return;
+				}
+				// resumes right away if the future got ready meanwhile
+				m_future.onReady([handle]()
+				{
+					handle.resume();
+				});
+			}
+
+			/// \return the result of the future
+			/// \throws the exception the promise was broken with
+			T await_resume() const
+			{
+				return m_future.get();
+			}
+
+		private:
+			Future < T > m_future;
+		};
+
+		template < class T >
+		FutureAwaiter < T > operator co_await(Future < T > future)
+		{
+			return FutureAwaiter < T > (std::move(future));
+		}
+
+		namespace detail
+		{
+			/// promise type of coroutines returning a future
+			template < class T >
+			struct futurePromise
+			{
+				Future < T > get_return_object()
+				{
+					return promise.getFuture();
+				}
+
+				/// the coroutine starts right away in the context of its caller
+				std::suspend_never initial_suspend() noexcept
+				{
+					return std::suspend_never();
+				}
+
+				/// the frame is destroyed when the coroutine finishes, the result lives in the future state
+				std::suspend_never final_suspend() noexcept
+				{
+					return std::suspend_never();
+				}
+
+				void return_value(T value)
+				{
+					promise.setValue(std::move(value));
+				}
+
+				void unhandled_exception()
+				{
+					promise.setException(std::current_exception());
+				}
+
+				Promise < T > promise;
+			};
+		}
+	}
+}
+
+template < class T, class... Args >
+struct std::coroutine_traits < hbk::jet::Future < T >, Args... >
+{
+	using promise_type = hbk::jet::detail::futurePromise < T >;
+};
@@ -23,6 +23,8 @@
 
 #ifndef _HBK__JET__DEFINES_H
 #define _HBK__JET__DEFINES_H
+#include <stdint.h>
+
 #include <functional>
 #include <list>
 #include <string>
@@ -119,6 +121,9 @@ namespace hbk {
 		
 		using fetchId_t = int;
 
+		/// Identifies a request waiting for its response. 0 if no response is expected.
+		using requestId_t = uint64_t;
+
 		/// @param notification contains PATH and EVENT as key-value-pairs and VALUE as an object
 		/// ```
 		/// {
@@ -187,6 +192,18 @@ namespace hbk {
 		/// \throws hbk::Exception::jsonException on error
 		using stateCallback_t = std::function < SetStateCbResult (const Json::Value& value, const std::string& path) >;
 
+		class Responder;
+
+		/// callback method processing the request for a registered jet method that is completed later.
+		/// Complete the request using the responder. This might happen after the callback returned and from any thread.
+		/// \throws hbk::Exception::jsonException on error. It will be delivered to the requesting jet peer in form of an jsonrpc error object.
+		using deferredMethodCallback_t = std::function < void (const Json::Value& params, Responder responder) >;
+
+		/// callback method processing the request to set a registered jet state that is completed later.
+		/// Complete the request using the responder. This might happen after the callback returned and from any thread.
+		/// \throws hbk::Exception::jsonException on error. It will be delivered to the requesting jet peer in form of an jsonrpc error object.
+		using deferredStateCallback_t = std::function < void (const Json::Value& value, const std::string& path, Responder responder) >;
+
 		/// Used for asynchronous execution of requests.
 		/// Asynchronuous requests without a response callback will be send without an id. Hence the jetd won't send a response.
 		/// \param result a json rpc response object
@@ -222,8 +239,47 @@ namespace hbk {
 		/// \endcode
 		using responseCallback_t = std::function < void ( const JsonRpcResponseObject& result) >;
 
+		/// Called once all requests of a batch are completed
+		/// @param results result or error object of each request in the order of the requests
+		using batchResponseCallback_t = std::function < void ( const std::vector < JsonRpcResponseObject >& results) >;
+
 		using userGroups_t = std::list < std::string > ;
 
+		/// Called when the send queue of a peer crosses a watermark. Executed in eventloop context.
+		/// @param congested true if the high watermark was exceeded, false if the queue drained below the low watermark
+		using backpressureCallback_t = std::function < void (bool congested) >;
+
+		/// Called when a peer that reconnects automatically lost or restored the connection to the jet daemon. Executed in eventloop context.
+		/// @param connected false if the connection was lost, true if it was restored
+		using connectionCallback_t = std::function < void (bool connected) >;
+
+		/// counters of the send queue of a peer
+		struct sendQueueStatus_t {
+			sendQueueStatus_t();
+			/// bytes waiting for the socket to get writable
+			size_t queuedBytes;
+			/// maximum of queuedBytes ever reached
+			size_t maxQueuedBytes;
+			/// sum of all bytes that could not be written immediately
+			uint64_t totalQueuedBytes;
+			/// number of times the high watermark was exceeded
+			uint64_t congestionCount;
+			/// true from exceeding the high watermark until draining below the low watermark
+			bool congested;
+		};
+
+		/// counters of the telegrams received by a peer
+		struct receiveStatus_t {
+			receiveStatus_t();
+			uint64_t telegramCount;
+			/// telegrams that could not be decoded
+			uint64_t decodeErrorCount;
+			/// notifications of fetches unknown to the peer. Those arrive for a short time after removing a fetch.
+			uint64_t droppedFetchNotificationCount;
+			/// requests for states or methods unknown to the peer
+			uint64_t droppedRequestCount;
+		};
+
 		/// For describing the match rules for fetchers.
 		/// All rules are AND gated!
 		struct matcher_t {
@@ -246,7 +302,7 @@ namespace hbk {
 			std::vector < std::string > containsAllOf;
 
 			/// return string describing all fetch conditions
-			std::string print()
+			std::string print() const
 			{
 				std::string msg;
 
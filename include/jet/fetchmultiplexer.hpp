@@ -0,0 +1,134 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <json/value.h>
+
+#include "jet/compiledmatcher.hpp"
+#include "jet/defines.h"
+#include "jet/peerasync.hpp"
+
+namespace hbk
+{
+	namespace jet
+	{
+		class CallbackGuard;
+
+		/// Serves many local subscriptions with few fetches of the jet daemon.
+		///
+		/// A subscription is served by an existing daemon fetch if that fetch covers the matcher of the subscription,
+		/// that is every path matching the subscription matches the fetch as well. Otherwise a new daemon fetch with the matcher of the subscription is added.
+		/// Each notification of the daemon is parsed once. The matchers of all subscriptions of the fetch are evaluated at once, it is fanned out locally to those matching.
+		///
+		/// The latest notification of each element is kept per daemon fetch.
+		/// A subscription joining an existing daemon fetch gets an "add" notification for each of those elements matching.
+		/// Subscribe wide matchers first. A wider subscription added later does not take over the subscriptions of narrower daemon fetches.
+		///
+		/// Subscription callbacks are called in the context the fetch callbacks of the peer are called in. They may subscribe and unsubscribe.
+		/// \warning The multiplexer is to be destroyed before the peer and not while fetch callbacks are being executed by another thread.
+		class FetchMultiplexer
+		{
+		public:
+			using subscriptionId_t = unsigned int;
+
+			explicit FetchMultiplexer(PeerAsync& peer);
+			FetchMultiplexer(const FetchMultiplexer&) = delete;
+			FetchMultiplexer& operator=(const FetchMultiplexer&) = delete;
+			/// Removes all daemon fetches
+			virtual ~FetchMultiplexer();
+
+			/// @param callback Called with each notification matching. Called with status -1 if the connection got lost or the daemon fetch failed.
+			/// If the daemon fetch failed, the subscription is removed.
+			/// \return id of the subscription. Never 0.
+			subscriptionId_t subscribe(const matcher_t& match, fetchCallback_t callback);
+
+			/// The daemon fetch is removed together with its last subscription
+			/// \return 0 on success, -1 if the subscription is not known
+			int unsubscribe(subscriptionId_t subscriptionId);
+
+			/// \return number of fetches of the jet daemon in use
+			size_t getFetchCount() const;
+
+			/// \return number of subscriptions
+			size_t getSubscriptionCount() const;
+
+		private:
+			struct Subscription {
+				Subscription(subscriptionId_t subscriptionId, const matcher_t& match, fetchCallback_t cb);
+				subscriptionId_t id;
+				CompiledMatcher matcher;
+				fetchCallback_t callback;
+			};
+			using subscriptionPtr_t = std::shared_ptr < const Subscription >;
+			struct SubscriptionList {
+				std::vector < subscriptionPtr_t > subscriptions;
+				/// the matchers of the subscriptions in the same order. All are evaluated at once.
+				MatcherSet matchers;
+			};
+			/// replaced as a whole. Notifications are fanned out to the subscriptions as they were when the notification arrived.
+			using subscriptions_t = std::shared_ptr < const SubscriptionList >;
+
+			/// one fetch of the jet daemon
+			struct Upstream {
+				explicit Upstream(const matcher_t& match);
+				matcher_t matcher;
+				fetchId_t fetchId;
+				subscriptions_t subscriptions;
+				/// latest notification of each element notified
+				std::map < std::string, Json::Value > elements;
+			};
+			using upstreamPtr_t = std::shared_ptr < Upstream >;
+
+			static subscriptions_t makeSubscriptionList(std::vector < subscriptionPtr_t > subscriptions);
+			/// \return true if every path matching inner matches outer as well. Conservative, false if not sure.
+			static bool covers(const matcher_t& outer, const matcher_t& inner);
+
+			/// \return daemon fetch covering the matcher or empty pointer
+			upstreamPtr_t findUpstream(const matcher_t& match) const;
+			/// called by the peer for each notification of a daemon fetch
+			void notify(const std::weak_ptr < Upstream >& weakUpstream, const Json::Value& notification, int status);
+			/// forget the daemon fetch and all its subscriptions. m_mtx needs to be locked by the caller!
+			void eraseUpstream(const upstreamPtr_t& upstream);
+			static void callSubscription(const Subscription& subscription, const Json::Value& notification, int status);
+
+			PeerAsync& m_peer;
+			std::vector < upstreamPtr_t > m_upstreams;
+			std::unordered_map < subscriptionId_t, upstreamPtr_t > m_subscriptions;
+			subscriptionId_t m_lastSubscriptionId;
+			/// closed on destruction, responses to fetch requests might arrive afterwards
+			std::shared_ptr < CallbackGuard > m_guard;
+			/// recursive because subscription callbacks may subscribe and unsubscribe
+			mutable std::recursive_mutex m_mtx;
+		};
+	}
+}
@@ -0,0 +1,110 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <json/value.h>
+
+#include "jet/defines.h"
+
+namespace Json {
+	class CharReader;
+}
+
+namespace hbk {
+	namespace jet {
+		/// Receives what a FrameDecoder decoded from a telegram
+		class FrameConsumer
+		{
+		public:
+			virtual ~FrameConsumer() = default;
+
+			/// a complete json-rpc message or a batch of json-rpc messages
+			virtual void consumeMessage(const Json::Value& message) = 0;
+
+			/// \return true if notifications of the fetch are to be consumed. Others are dropped without decoding their parameters.
+			/// The consumer is responsible for reporting what it does not consume.
+			virtual bool isFetchConsumed(fetchId_t fetchId) = 0;
+
+			/// \return true if requests for the state or method are to be consumed. Others are dropped without decoding them.
+			/// The consumer is responsible for reporting what it does not consume.
+			virtual bool isRequestConsumed(const std::string& path) = 0;
+
+			/// a notification of a fetch
+			/// @param params Parameters of the notification containing path, event and value
+			virtual void consumeFetchNotification(fetchId_t fetchId, const Json::Value& params) = 0;
+		};
+
+		/// Decodes received telegrams. A jet peer might use different decoders. All are expected to deliver the same to the consumer.
+		class FrameDecoder
+		{
+		public:
+			virtual ~FrameDecoder() = default;
+
+			/// @param pTelegram complete json document without length information
+			/// @param len length of the telegram
+			/// @param consumer gets the decoded messages
+			/// @param[out] errorMessage tells what went wrong
+			/// \return false if the telegram could not be decoded
+			virtual bool decode(const char* pTelegram, size_t len, FrameConsumer& consumer, std::string& errorMessage) = 0;
+		};
+
+		/// Parses the complete telegram with jsoncpp and hands it to FrameConsumer::consumeMessage()
+		class JsonFrameDecoder : public FrameDecoder
+		{
+		public:
+			JsonFrameDecoder();
+			JsonFrameDecoder(const JsonFrameDecoder&) = delete;
+			JsonFrameDecoder& operator=(const JsonFrameDecoder&) = delete;
+			virtual ~JsonFrameDecoder();
+
+			virtual bool decode(const char* pTelegram, size_t len, FrameConsumer& consumer, std::string& errorMessage) override;
+
+		protected:
+			/// \return false if the json document could not be parsed
+			bool parse(const char* pBegin, const char* pEnd, Json::Value& value, std::string& errorMessage);
+
+		private:
+			std::unique_ptr < Json::CharReader > const m_reader;
+		};
+
+		/// Finds the routing keys (method and id) of a telegram without building a json document.
+		/// Parameters of a fetch notification are parsed only if the fetch is consumed.
+		/// Requests for states or methods are parsed completely only if they are consumed.
+		/// Everything else, like responses and batches, is parsed completely and handed to FrameConsumer::consumeMessage().
+		/// This is the default decoder of PeerAsync.
+		class ScanningFrameDecoder : public JsonFrameDecoder
+		{
+		public:
+			virtual bool decode(const char* pTelegram, size_t len, FrameConsumer& consumer, std::string& errorMessage) override;
+
+		private:
+			/// path of the last request. Reused to keep its capacity.
+			std::string m_path;
+		};
+	}
+}
@@ -0,0 +1,315 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace hbk
+{
+	namespace jet
+	{
+		template < class T >
+		class Future;
+
+		template < class T >
+		class Promise;
+
+		template < class T >
+		Future < std::vector < T > > whenAll(const std::vector < Future < T > >& futures);
+
+		template < class T >
+		class FutureAwaiter;
+
+		/// executes a job in another context, e.g. by posting it to an eventloop
+		typedef std::function < void(std::function < void() >) > executor_t;
+
+		namespace detail
+		{
+			/// shared by a promise and all futures and continuations waiting for it. This is the only allocation per request.
+			template < class T >
+			struct futureState
+			{
+				futureState()
+					: mtx()
+					, condition()
+					, ready(false)
+					, value()
+					, error()
+					, continuation()
+					, executor()
+				{
+				}
+
+				std::mutex mtx;
+				std::condition_variable condition;
+				bool ready;
+				/// not changed after being ready
+				T value;
+				/// set if the promise was broken
+				std::exception_ptr error;
+				/// executed once when getting ready
+				std::function < void() > continuation;
+				/// if set, coroutines awaiting the future are resumed through it. Set before the future is handed out.
+				executor_t executor;
+			};
+		}
+
+		/// Result of an asynchronuous operation that is available later.
+		/// Copies refer to the same result.
+		/// Continuations attached via then() are executed in the context that completes the promise (usually the eventloop) or
+		/// right away if the result is already available.
+		/// \warning Waiting for a result from within the eventloop that is to deliver it, blocks forever!
+		template < class T >
+		class Future
+		{
+			friend class Promise < T >;
+			template < class U >
+			friend class Future;
+			template < class U >
+			friend Future < std::vector < U > > whenAll(const std::vector < Future < U > >& futures);
+			friend class FutureAwaiter < T >;
+
+		public:
+			/// refers to no result
+			Future()
+				: m_state()
+			{
+			}
+
+			/// \return false if the future refers to no result
+			bool valid() const
+			{
+				return static_cast < bool > (m_state);
+			}
+
+			/// \return true if the result is available
+			bool isReady() const
+			{
+				std::lock_guard < std::mutex > lock(m_state->mtx);
+				return m_state->ready;
+			}
+
+			/// block until the result is available
+			void wait() const
+			{
+				std::unique_lock < std::mutex > lock(m_state->mtx);
+				m_state->condition.wait(lock, [this]() { return m_state->ready; });
+			}
+
+			/// block until the result is available or the timeout elapsed
+			/// \return true if the result is available
+			template < class Rep, class Period >
+			bool waitFor(const std::chrono::duration < Rep, Period >& timeout) const
+			{
+				std::unique_lock < std::mutex > lock(m_state->mtx);
+				return m_state->condition.wait_for(lock, timeout, [this]() { return m_state->ready; });
+			}
+
+			/// block until the result is available
+			/// \return the result
+			/// \throws the exception the promise was broken with
+			const T& get() const
+			{
+				wait();
+				if (m_state->error) {
+					std::rethrow_exception(m_state->error);
+				}
+				return m_state->value;
+			}
+
+			/// Attach a continuation that is called with the result. The result of the continuation is delivered by the future returned.
+			/// If the promise was broken or the continuation throws, the future returned gets the exception.
+			/// @param continuation a callable taking const T& and returning a value
+			template < class F >
+			Future < typename std::decay < decltype(std::declval < F > ()(std::declval < const T& > ())) >::type > then(F continuation) const
+			{
+				using result_t = typename std::decay < decltype(continuation(std::declval < const T& > ())) >::type;
+				Promise < result_t > promise;
+				Future < result_t > future = promise.getFuture();
+				std::shared_ptr < detail::futureState < T > > state = m_state;
+				onReady([state, promise, continuation]() mutable
+				{
+					if (state->error) {
+						promise.setException(state->error);
+						return;
+					}
+					try {
+						promise.setValue(continuation(state->value));
+					} catch(...) {
+						promise.setException(std::current_exception());
+					}
+				});
+				return future;
+			}
+
+		private:
+			explicit Future(std::shared_ptr < detail::futureState < T > > state)
+				: m_state(std::move(state))
+			{
+			}
+
+			/// callback is executed once the result is available. Executed right away if the result is already available.
+			void onReady(std::function < void() > callback) const
+			{
+				{
+					std::lock_guard < std::mutex > lock(m_state->mtx);
+					if (!m_state->ready) {
+						if (m_state->continuation) {
+							std::function < void() > previous = std::move(m_state->continuation);
+							m_state->continuation = [previous, callback]()
+							{
+								previous();
+								callback();
+							};
+						} else {
+							m_state->continuation = std::move(callback);
+						}
+						return;
+					}
+				}
+				callback();
+			}
+
+			std::shared_ptr < detail::futureState < T > > m_state;
+		};
+
+		/// Delivers the result of an asynchronuous operation to its futures. Copies refer to the same result.
+		/// The result is set once, later calls are ignored.
+		template < class T >
+		class Promise
+		{
+		public:
+			Promise()
+				: m_state(std::make_shared < detail::futureState < T > > ())
+			{
+			}
+
+			Future < T > getFuture() const
+			{
+				return Future < T > (m_state);
+			}
+
+			void setValue(T value)
+			{
+				complete(&value, std::exception_ptr());
+			}
+
+			void setException(std::exception_ptr error)
+			{
+				complete(nullptr, error);
+			}
+
+			/// Coroutines awaiting the future are resumed through the executor instead of the context completing the promise.
+			/// To be set before handing out the future.
+			void setExecutor(executor_t executor)
+			{
+				std::lock_guard < std::mutex > lock(m_state->mtx);
+				m_state->executor = std::move(executor);
+			}
+
+		private:
+			void complete(T* pValue, std::exception_ptr error)
+			{
+				std::function < void() > continuation;
+				{
+					std::lock_guard < std::mutex > lock(m_state->mtx);
+					if (m_state->ready) {
+						return;
+					}
+					if (pValue) {
+						m_state->value = std::move(*pValue);
+					}
+					m_state->error = error;
+					m_state->ready = true;
+					continuation.swap(m_state->continuation);
+				}
+				m_state->condition.notify_all();
+				if (continuation) {
+					continuation();
+				}
+			}
+
+			std::shared_ptr < detail::futureState < T > > m_state;
+		};
+
+		/// \return future that is ready when all futures are ready. It delivers their results in the same order.
+		/// If one of the promises was broken, the future returned gets its exception.
+		template < class T >
+		Future < std::vector < T > > whenAll(const std::vector < Future < T > >& futures)
+		{
+			struct collector
+			{
+				std::mutex mtx;
+				std::vector < T > values;
+				size_t remaining;
+				std::exception_ptr error;
+				Promise < std::vector < T > > promise;
+			};
+
+			std::shared_ptr < collector > pCollector = std::make_shared < collector > ();
+			Future < std::vector < T > > result = pCollector->promise.getFuture();
+			pCollector->values.resize(futures.size());
+			pCollector->remaining = futures.size();
+			if (futures.empty()) {
+				pCollector->promise.setValue(std::vector < T > ());
+				return result;
+			}
+
+			for (size_t index = 0; index < futures.size(); ++index) {
+				std::shared_ptr < detail::futureState < T > > state = futures[index].m_state;
+				futures[index].onReady([pCollector, state, index]()
+				{
+					bool complete;
+					{
+						std::lock_guard < std::mutex > lock(pCollector->mtx);
+						if (state->error) {
+							if (!pCollector->error) {
+								pCollector->error = state->error;
+							}
+						} else {
+							pCollector->values[index] = state->value;
+						}
+						complete = (--pCollector->remaining == 0);
+					}
+					if (complete) {
+						if (pCollector->error) {
+							pCollector->promise.setException(pCollector->error);
+						} else {
+							pCollector->promise.setValue(std::move(pCollector->values));
+						}
+					}
+				});
+			}
+			return result;
+		}
+	}
+}
@@ -0,0 +1,134 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <json/value.h>
+
+#include "jet/defines.h"
+#include "jet/future.hpp"
+#include "jet/peerasync.hpp"
+
+namespace hbk
+{
+	namespace jet
+	{
+		class CallbackGuard;
+
+		/// Read-through cache for get requests.
+		///
+		/// The first get with a matcher adds a fetch of the jet daemon with that matcher. The response is composed when the response to the fetch request arrives.
+		/// The fetch keeps the cached states up to date afterwards. Further gets with the same matcher are answered locally without a request to the daemon.
+		/// Matchers are normalized before looking them up: Conditions of case insensitive matchers are folded,
+		/// contains and containsAllOf are treated as one set of conditions.
+		///
+		/// Memory is bounded by the number of matchers and the number of states cached. When exceeding one of those,
+		/// the least recently used matchers are dropped together with their fetch.
+		/// A matcher is dropped as well when the connection to the daemon gets lost.
+		///
+		/// Responses to fetch requests arriving after destruction are dropped. Result callbacks still waiting for those are called with an error object on destruction.
+		/// \note Unlike the daemon, the cache delivers the states ordered by path. Methods are not delivered, as by the daemon.
+		/// \warning The cache is to be destroyed before the peer and not while fetch callbacks are being executed by another thread.
+		class GetCache
+		{
+		public:
+			/// @param maxMatcherCount maximum number of matchers cached, each takes a fetch of the jet daemon
+			/// @param maxStateCount maximum number of states cached for all matchers
+			explicit GetCache(PeerAsync& peer, size_t maxMatcherCount = 64, size_t maxStateCount = 65536);
+			GetCache(const GetCache&) = delete;
+			GetCache& operator=(const GetCache&) = delete;
+			/// Removes all fetches
+			virtual ~GetCache();
+
+			/// Like PeerAsync::getAsync()
+			/// @param resultCallback If the matcher is cached, it is called before returning. Otherwise it is executed in eventloop context.
+			void getAsync(const matcher_t& match, responseCallback_t resultCallback);
+
+			/// Like getAsync() but the response is delivered by a future.
+			/// \return future delivering the response object
+			ResponseFuture get(const matcher_t& match);
+
+			/// Drop all matchers and remove their fetches
+			void clear();
+
+			/// \return number of matchers cached, including those waiting for the response of their fetch
+			size_t getMatcherCount() const;
+
+			/// \return number of states cached
+			size_t getStateCount() const;
+
+		private:
+			struct Entry;
+			using entryPtr_t = std::shared_ptr < Entry >;
+			/// most recently used first
+			using lru_t = std::list < entryPtr_t >;
+
+			struct Entry {
+				Entry(const matcher_t& match, const std::string& normalizedKey);
+				matcher_t matcher;
+				std::string key;
+				fetchId_t fetchId;
+				/// the response to the fetch request arrived, all matching states were notified
+				bool complete;
+				/// latest value of each state
+				std::map < std::string, Json::Value > values;
+				/// gets waiting for the fetch to complete
+				std::vector < responseCallback_t > waiting;
+				lru_t::iterator lruPosition;
+			};
+
+			/// \return key that is equal for all matchers that are known to match the same paths
+			static std::string normalize(const matcher_t& match);
+			static JsonRpcResponseObject composeResponse(const Entry& entry);
+			static void callResultCallback(const responseCallback_t& resultCallback, const JsonRpcResponseObject& response);
+
+			/// called by the peer for each notification of a fetch
+			void fetchCb(const std::weak_ptr < Entry >& weakEntry, const Json::Value& notification, int status);
+			/// called by the peer with the response to the fetch request
+			void fetchResultCb(const std::weak_ptr < Entry >& weakEntry, const JsonRpcResponseObject& result);
+			/// Forget the matcher and remove its fetch. m_mtx needs to be locked by the caller!
+			void erase(const entryPtr_t& entry);
+			/// Drop least recently used matchers until within the limits. Matchers waiting for their fetch are kept. m_mtx needs to be locked by the caller!
+			void enforceLimits();
+
+			PeerAsync& m_peer;
+			const size_t m_maxMatcherCount;
+			const size_t m_maxStateCount;
+			std::unordered_map < std::string, entryPtr_t > m_entries;
+			lru_t m_lru;
+			size_t m_stateCount;
+			/// closed on destruction, responses to fetch requests might arrive afterwards
+			std::shared_ptr < CallbackGuard > m_guard;
+			mutable std::mutex m_mtx;
+		};
+	}
+}
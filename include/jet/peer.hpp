@@ -70,6 +70,10 @@ namespace hbk
 			/// try to reconnect to the jet daemon and resume operation
 			bool resume();
 
+			/// @ingroup anyPeer
+			/// Reconnect automatically after losing the connection to the jet daemon. See PeerAsync::setAutoReconnect()
+			void setAutoReconnect(std::chrono::milliseconds minDelay, std::chrono::milliseconds maxDelay, connectionCallback_t callback = connectionCallback_t());
+
 			/// @ingroup anyPeer
 			/// The peer authenticates itself against the daemon
 			Json::Value authenticate(const std::string& user, const std::string& password);
@@ -192,7 +196,8 @@ namespace hbk
 			/// @param callback function to be called when state is set via jet. leave empty for read only states
 			/// @param value initial value of the state
 			/// \throws hbk::exception::jsonrpcException on error
-			void addState(const std::string& path, const Json::Value& value, stateCallback_t callback = stateCallback_t());
+			/// \return handle to notify the state fast
+			StateHandle addState(const std::string& path, const Json::Value& value, stateCallback_t callback = stateCallback_t());
 
 			/// @ingroup owningPeer
 			/// the peer serves a new state
@@ -201,7 +206,8 @@ namespace hbk
 			/// @param value initial value of the state
 			/// @param timeout_s the timeout in seconds how long a routed request for this state might last
 			/// \throws hbk::exception::jsonrpcException on error
-			void addState(const std::string& path, const Json::Value& value, double timeout_s, stateCallback_t callback = stateCallback_t());
+			/// \return handle to notify the state fast
+			StateHandle addState(const std::string& path, const Json::Value& value, double timeout_s, stateCallback_t callback = stateCallback_t());
 
 			/// @ingroup owningPeer
 			/// the peer serves a new state on jet
@@ -212,9 +218,23 @@ namespace hbk
 			/// @param callback function to be called when state is set via jet. Put nullptr in for read only states.
 			/// @param timeout_s the timeout in seconds how long a routed request for this state might last
 			/// \throws exception on error
-			void addState(const std::string& path, const userGroups_t& fetchGroups,
-			              const userGroups_t& setGroups, const Json::Value& value,
-			              double timeout_s, stateCallback_t callback = stateCallback_t());
+			/// \return handle to notify the state fast
+			StateHandle addState(const std::string& path, const userGroups_t& fetchGroups,
+			                     const userGroups_t& setGroups, const Json::Value& value,
+			                     double timeout_s, stateCallback_t callback = stateCallback_t());
+
+			/// @ingroup owningPeer
+			/// The peer serves many new states. Much faster than adding them one by one, there is no round trip per state.
+			/// States that could not be added are unregistered.
+			/// @param[out] pStates handles to notify the states fast, in the order of the states. Ignored if nullptr.
+			/// \return result or error object of each state in the order of the states
+			std::vector < JsonRpcResponseObject > addStates(const std::vector < StateSpec >& states, std::vector < StateHandle >* pStates = nullptr);
+
+			/// @ingroup owningPeer
+			/// The peer serves many new methods. Much faster than adding them one by one, there is no round trip per method.
+			/// Methods that could not be added are unregistered.
+			/// \return result or error object of each method in the order of the methods
+			std::vector < JsonRpcResponseObject > addMethods(const std::vector < MethodSpec >& methods);
 
 			/// @ingroup owningPeer
 			/// @param path the key onto which the new state will be published
@@ -222,7 +242,8 @@ namespace hbk
 			/// @param resultCallback called on completion providing the result
 			/// @param callback function to be called when state is set via jet. leave empty for read only states
 			/// \throws hbk::exception::jsonrpcException on error
-			void addStateAsync(const std::string& path, const Json::Value& value, responseCallback_t resultCallback, stateCallback_t callback);
+			/// \return handle to notify the state fast
+			StateHandle addStateAsync(const std::string& path, const Json::Value& value, responseCallback_t resultCallback, stateCallback_t callback);
 
 			/// @ingroup owningPeer
 			/// @param path the key onto which the new state will be published
@@ -231,7 +252,8 @@ namespace hbk
 			/// @param resultCallback called on completion providing the result
 			/// @param callback function to be called when state is set via jet. leave empty for read only states
 			/// \throws hbk::exception::jsonrpcException on error
-			void addStateAsync(const std::string& path, const Json::Value& value, double timeout_s, responseCallback_t resultCallback, stateCallback_t callback);
+			/// \return handle to notify the state fast
+			StateHandle addStateAsync(const std::string& path, const Json::Value& value, double timeout_s, responseCallback_t resultCallback, stateCallback_t callback);
 
 			/// @ingroup owningPeer
 			/// the peer serves a new state on jet
@@ -243,7 +265,8 @@ namespace hbk
 			/// @param timeout_s the timeout in seconds how long a routed request for this state might last
 			/// @param resultCallback called on completion providing the result
 			/// \throws exception on error
-			void addStateAsync(const std::string& path, const Json::Value& value, const userGroups_t& fetchGroups, const userGroups_t& setGroups,
+			/// \return handle to notify the state fast
+			StateHandle addStateAsync(const std::string& path, const Json::Value& value, const userGroups_t& fetchGroups, const userGroups_t& setGroups,
 				double timeout_s, responseCallback_t resultCallback, stateCallback_t callback);
 
 			/// @ingroup owningPeer
@@ -269,12 +292,21 @@ namespace hbk
 				return m_peerAsync.notifyState(path, value);
 			}
 
+			template <class valueType>
+			/// @ingroup owningPeer
+			/// called by the jet peer to notify new state value to the jet daemon
+			/// @param state Handle returned when adding the state
+			int notifyState(const StateHandle& state, valueType value)
+			{
+				return m_peerAsync.notifyState(state, value);
+			}
+
 			/// @ingroup anyPeer
 			/// The jet peer singleton connecting to the local jet daemon
 			static Peer& local();
 		private:
 
-			void addStatePrivate(const std::string& path, const Json::Value& value, Json::Value& params, stateCallback_t callback = stateCallback_t());
+			StateHandle addStatePrivate(const std::string& path, const Json::Value& value, Json::Value& params, stateCallback_t callback = stateCallback_t());
 			void addMethodPrivate(const std::string& path, Json::Value& params, methodCallback_t callback);
 			SetStateResult setStateValuePrivate(const std::string& path, const Json::Value& value, Json::Value& params);
 			JsonRpcResponseObject callMethodPrivate(const std::string& path, const Json::Value& args, Json::Value& params);
@@ -26,8 +26,12 @@
 #include <stdint.h>
 
 #include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
@@ -35,12 +39,12 @@
 #include <json/reader.h>
 #include "hbk/jsonrpc/jsonrpc_defines.h"
 #include "hbk/communication/socketnonblocking.h"
+#include "hbk/sys/notifier.h"
+#include "hbk/sys/timer.h"
 
 #include "jet/defines.h"
-
-namespace Json {
-	class CharReader;
-}
+#include "jet/framedecoder.hpp"
+#include "jet/future.hpp"
 
 namespace hbk
 {
@@ -49,12 +53,159 @@ namespace hbk
 	}
 	namespace jet
 	{
+		class FetchTable;
+		class PathRegistry;
+		class WorkerPool;
+		class ReceiveBuffer;
+		class PendingRequests;
+
+		class PeerAsync;
+
+		namespace detail
+		{
+			struct notifyBoolTag;
+			struct notifySignedTag;
+			struct notifyUnsignedTag;
+			struct notifyFloatTag;
+			struct notifyStringTag;
+			struct notifyJsonTag;
+
+			struct pendingResponse;
+			struct responderLink;
+			struct resumeQueue;
+
+			/// a state registered by this peer
+			struct stateEntry
+			{
+				/// @param params parameters of the request adding the state
+				stateEntry(const std::string& statePath, const Json::Value& params, stateCallback_t stateCallback, deferredStateCallback_t deferredStateCallback = deferredStateCallback_t());
+				stateEntry(const stateEntry&) = delete;
+				stateEntry& operator=(const stateEntry&) = delete;
+
+				/// \return parameters to add the state again with its latest value
+				Json::Value getAddParams() const;
+
+				const std::string path;
+				/// parameters of the request adding the state. Used to add it again after reconnecting.
+				const Json::Value addParams;
+				/// start of a change notification including the escaped path. Composed once on registration.
+				const std::string changePrefix;
+				const stateCallback_t callback;
+				/// used instead of callback if set
+				const deferredStateCallback_t deferredCallback;
+				/// false after the state was removed or registered again
+				std::atomic < bool > registered;
+				/// change notifications of this state are conflated
+				std::atomic < bool > conflated;
+
+				/// latest value notified, serialized. Empty if it did not change since being added.
+				/// Kept only if the peer reconnects automatically.
+				mutable std::string value;
+				mutable std::mutex valueMtx;
+			};
+		}
+
+		/// Refers to a state registered by a jet peer. Returned when adding a state.
+		/// Notifying via the handle does not need to look up and escape the path of the state.
+		/// \note The handle does not keep the state alive. After the state was removed, notifying via the handle fails.
+		/// \warning Use the handle with the peer that created it only!
+		class StateHandle
+		{
+			friend class PeerAsync;
+			friend class Peer;
+		public:
+			/// refers to no state
+			StateHandle();
+
+			/// \return true if the state is still registered by the peer
+			bool isRegistered() const;
+
+			/// \return path of the state, empty if the handle refers to no state
+			const std::string& getPath() const;
+
+		private:
+			explicit StateHandle(std::shared_ptr < const detail::stateEntry > entry);
+
+			std::shared_ptr < const detail::stateEntry > m_entry;
+		};
+
+		/// Completes a request for a deferred state or method. Handed to deferredStateCallback_t and deferredMethodCallback_t.
+		/// All copies refer to the same request. It is completed once, completing it again fails.
+		/// If the last copy is destructed without completing the request, an error response is send.
+		/// \note Complete from any thread. After the peer was destructed, completing fails.
+		class Responder
+		{
+			friend class PeerAsync;
+		public:
+			/// refers to no request
+			Responder();
+
+			/// Send the result of a method
+			/// \return 0 on success, -1 if already completed or on error
+			int complete(const Json::Value& result);
+
+			/// Finish setting a state. Like when returning from a stateCallback_t, a value that is not null is notified before the response is send.
+			/// \return 0 on success, -1 if already completed or on error
+			int complete(const SetStateCbResult& stateResult);
+
+			/// Send an error response
+			/// \return 0 on success, -1 if already completed or on error
+			int fail(int code, const std::string& message);
+
+			/// \return true if the request was completed or the responder refers to no request
+			bool isCompleted() const;
+
+		private:
+			explicit Responder(std::shared_ptr < detail::pendingResponse > response);
+
+			std::shared_ptr < detail::pendingResponse > m_response;
+		};
+
+		/// A state to be added by PeerAsync::addStatesAsync() or Peer::addStates()
+		struct StateSpec
+		{
+			/// @param callback function to be called when state is set via jet. leave empty for read only states
+			/// @param timeout_s the timeout in seconds how long a routed request for this state might last. 0 for the default of the jet daemon.
+			StateSpec(const std::string& statePath, const Json::Value& stateValue, stateCallback_t stateCallback = stateCallback_t(), double timeout = 0.0);
+
+			std::string path;
+			Json::Value value;
+			stateCallback_t callback;
+			double timeout_s;
+			/// user groups that are allowed to fetch this state, empty for everybody
+			userGroups_t fetchGroups;
+			/// user groups that are allowed to set this state, empty for everybody
+			userGroups_t setGroups;
+		};
+
+		/// A method to be added by PeerAsync::addMethodsAsync() or Peer::addMethods()
+		struct MethodSpec
+		{
+			/// @param callback function to be called when method is called via jet.
+			/// @param timeout_s the timeout in seconds how long a routed request for this method might last. 0 for the default of the jet daemon.
+			MethodSpec(const std::string& methodPath, methodCallback_t methodCallback, double timeout = 0.0);
+
+			std::string path;
+			methodCallback_t callback;
+			double timeout_s;
+			/// user groups that are allowed to fetch this method, empty for everybody
+			userGroups_t fetchGroups;
+			/// user groups that are allowed to call this method, empty for everybody
+			userGroups_t callGroups;
+		};
+
+		/// delivers the json rpc response object of a request
+		using ResponseFuture = Future < JsonRpcResponseObject >;
+
 		/// C++ jet peer for asynchronuous calls. Data is received asynchronuously in the context of the provided event loop which calls the receive method when data is available
 		/// \note All methods that do not provide a timeout, have the default timeout of the jet daemon.
 		/// \note All callback functions are executed in the eventloop context. Eventloop needs to be running and may not be blocked to have callback functions executed!
-		class PeerAsync
+		class PeerAsync : private FrameConsumer
 		{
 			friend class Peer;
+			friend class AsyncRequest;
+			friend class AsyncRequestBatch;
+			friend struct detail::pendingResponse;
 		public:
 			/** 
 			 *  @defgroup remotePeer Methods called by remote jet peer
@@ -100,46 +251,60 @@ namespace hbk
 			/// @ingroup anyPeer
 			/// @param name User defined name
 			/// @param debug Switch debug log messages
-			/// @param resultCallback called on completion or error providing the result. Executed in eventloop eontext.
+			/// @param resultCallback called on completion or error providing the result. Executed in eventloop context.
 			void configAsync(const std::string& name, bool debug, responseCallback_t resultCallback=responseCallback_t());
 
 			/// @ingroup anyPeer
 			/// try to reconnect to jetd after loss of connection
 			bool resume();
 
+			/// @ingroup anyPeer
+			/// Reconnect automatically after losing the connection to the jet daemon.
+			/// States and methods are kept when the connection is lost. After reconnecting, they are added again at once
+			/// with the access groups and timeouts they were added with. States are added with the latest value notified.
+			/// Fetches are restored as usual.
+			/// Reconnecting is tried after minDelay first. The delay doubles with each failed attempt up to maxDelay.
+			/// Requests waiting for a response are completed with an error object when the connection is lost.
+			/// @param minDelay 0 to switch off reconnecting automatically
+			/// @param callback Executed in eventloop context when the connection is lost or restored
+			void setAutoReconnect(std::chrono::milliseconds minDelay, std::chrono::milliseconds maxDelay, connectionCallback_t callback = connectionCallback_t());
+
 			/// @ingroup anyPeer
 			/// the peer authenticates itself against the daemon
 			/// @param user user name
 			/// @param password password of user
-			/// @param resultCallback called on completion or error providing the result. Executed in eventloop eontext.
+			/// @param resultCallback called on completion or error providing the result. Executed in eventloop context.
 			void authenticateAsync(const std::string& user, const std::string& password, responseCallback_t resultCallback=responseCallback_t());
 
 			/// @ingroup remotePeer
 			/// calls a method of the remote peer.
 			/// @param path path of the method to call
 			/// @param args nothing or an array with arguments
-			/// @param resultCb called called on completion or error providing the result. Executed in eventloop eontext.
-			void callMethodAsync(const std::string& path, const Json::Value& args, responseCallback_t resultCb);
+			/// @param resultCb called called on completion or error providing the result. Executed in eventloop context.
+			/// \return id of the request to be used with cancelRequest()
+			requestId_t callMethodAsync(const std::string& path, const Json::Value& args, responseCallback_t resultCb);
 
 			/// @ingroup remotePeer
 			/// calls a method of the remote peer.
 			/// @param path path of the method to call
 			/// @param args nothing or an array with arguments
 			/// @param timeout_s the timeout in seconds how long a routed request for this call might last
-			/// @param resultCb called on completion or error providing the result. Executed in eventloop eontext.
-			void callMethodAsync(const std::string& path, const Json::Value& args, double timeout_s, responseCallback_t resultCb);
+			/// @param resultCb called on completion or error providing the result. Executed in eventloop context.
+			/// \return id of the request to be used with cancelRequest()
+			requestId_t callMethodAsync(const std::string& path, const Json::Value& args, double timeout_s, responseCallback_t resultCb);
 
 			/// @ingroup remotePeer
 			/// Subscribes to all changes made to states matching the filter criteria
 			/// \param match the filter used
-			/// \param callback Called on any matching notification. Executed in eventloop eontext.
-			/// \param resultCb called on completion or error providing the result. Executed in eventloop eontext.
+			/// \param callback Called on any matching notification. Executed in eventloop context.
+			/// \param resultCb called on completion or error providing the result. Executed in eventloop context.
 			/// \return the fetch id
 			fetchId_t addFetchAsync(const matcher_t& match, fetchCallback_t callback, responseCallback_t resultCb=responseCallback_t());
 
 			/// @ingroup remotePeer
+			/// \note Notifications are dispatched without locking. A notification being dispatched right now might still reach the callback.
 			/// @param fetchId id of the fetch to remove
-			/// @param resultCb called on completion or error providing the result. Executed in eventloop eontext.
+			/// @param resultCb called on completion or error providing the result. Executed in eventloop context.
 			void removeFetchAsync(fetchId_t fetchId, responseCallback_t resultCb=responseCallback_t());
 
 			/// @ingroup remotePeer
@@ -154,31 +319,70 @@ namespace hbk
 			/// }
 			/// \param match the filter used
 			/// \endcode
-			void getAsync(const matcher_t& match, responseCallback_t resultCallback);
+			/// \return id of the request to be used with cancelRequest()
+			requestId_t getAsync(const matcher_t& match, responseCallback_t resultCallback);
 
 			/// @ingroup remotePeer
 			/// set the value of the remote state
-			void setStateValueAsync(const std::string& path, const Json::Value& value, responseCallback_t resultCallback=responseCallback_t());
+			/// \return id of the request to be used with cancelRequest(), 0 without resultCallback
+			requestId_t setStateValueAsync(const std::string& path, const Json::Value& value, responseCallback_t resultCallback=responseCallback_t());
 
 			/// @ingroup remotePeer
 			/// set the value of the remote state
 			/// @param path Path of the state to set
 			/// @param value Requested value for the state
 			/// @param timeout_s Timeout in seconds how long to wait for the response
-			/// @param resultCallback called on completion or error providing the result. Executed in eventloop eontext.
-			void setStateValueAsync(const std::string& path, const Json::Value& value, double timeout_s, responseCallback_t resultCallback=responseCallback_t());
+			/// @param resultCallback called on completion or error providing the result. Executed in eventloop context.
+			/// \return id of the request to be used with cancelRequest(), 0 without resultCallback
+			requestId_t setStateValueAsync(const std::string& path, const Json::Value& value, double timeout_s, responseCallback_t resultCallback=responseCallback_t());
+
+			/// @ingroup remotePeer
+			/// Like callMethodAsync() but the response is delivered by a future.
+			/// Issue many requests and wait for all of them using whenAll() or chain them using Future::then().
+			/// \return future delivering the response object
+			ResponseFuture callMethod(const std::string& path, const Json::Value& args, double timeout_s);
+
+			/// @ingroup remotePeer
+			/// Like setStateValueAsync() but the response is delivered by a future.
+			/// \return future delivering the response object
+			ResponseFuture setStateValue(const std::string& path, const Json::Value& value, double timeout_s);
+
+			/// @ingroup remotePeer
+			/// Like getAsync() but the response is delivered by a future.
+			/// \return future delivering the response object
+			ResponseFuture get(const matcher_t& match);
+
+			/// @ingroup remotePeer
+			/// Like addFetchAsync() but the response is delivered by a future.
+			/// @param[out] pFetchId id of the fetch if not nullptr
+			/// \return future delivering the response object
+			ResponseFuture addFetch(const matcher_t& match, fetchCallback_t callback, fetchId_t* pFetchId = nullptr);
+
+			/// @ingroup anyPeer
+			/// Requests without response within this time are completed with an error object.
+			/// For set and call requests, the timeout of the routed request is added.
+			/// Deadlines have a resolution of 10ms. They are checked in eventloop context.
+			/// @param timeout 0 to wait for the response forever (default)
+			void setRequestTimeout(std::chrono::milliseconds timeout);
+
+			/// @ingroup anyPeer
+			/// Stop waiting for the response of a request. Its response callback is called with an error object before this returns.
+			/// A response arriving later is ignored.
+			/// @param requestId as returned when starting the request
+			/// \return 0 on success, -1 if the request is not waiting for a response
+			int cancelRequest(requestId_t requestId);
 
 			/// @ingroup owningPeer
 			/// The peer serves a new method on jet. Other peers can call the method.
-			/// @param callback Callback function executed when registered method gets called. Executed in eventloop eontext.
+			/// @param callback Callback function executed when registered method gets called. Executed in eventloop context.
 			void addMethodAsync(const std::string& path, responseCallback_t resultCallback, methodCallback_t callback);
 
 			/// @ingroup owningPeer
 			/// The peer serves a new method on jet. Other peers can call the method.
 			/// @param path Path of the state to set
 			/// @param timeout_s the timeout in seconds how long a routed request for this method might last
-			/// @param resultCallback called on completion or error providing the result. Executed in eventloop eontext.
-			/// @param callback Callback function executed when registered method gets called. Executed in eventloop eontext.
+			/// @param resultCallback called on completion or error providing the result. Executed in eventloop context.
+			/// @param callback Callback function executed when registered method gets called. Executed in eventloop context.
 			void addMethodAsync(const std::string& path, double timeout_s, responseCallback_t resultCallback, methodCallback_t callback);
 
 			/// @ingroup owningPeer
@@ -186,9 +390,9 @@ namespace hbk
 			/// @param path the key onto which the new method will be published
 			/// @param fetchGroups list of user groups that are allowed to fetch this method
 			/// @param callGroups list of user groups that are allowed to call this method
-			/// @param callback Callback function executed when registered method gets called. Executed in eventloop eontext.
+			/// @param callback Callback function executed when registered method gets called. Executed in eventloop context.
 			/// @param timeout_s the timeout in seconds how long a routed request for this method might last
-			/// @param resultCallback called on completion or error providing the result. Executed in eventloop eontext.
+			/// @param resultCallback called on completion or error providing the result. Executed in eventloop context.
 			void addMethodAsync(const std::string& path, const userGroups_t& fetchGroups, const userGroups_t& callGroups,
 				methodCallback_t callback, double timeout_s, responseCallback_t resultCallback);
 
@@ -196,22 +400,34 @@ namespace hbk
 			/// The peer no longer serves the method.
 			void removeMethodAsync(const std::string& path, responseCallback_t resultCallback=responseCallback_t());
 
+			/// @ingroup owningPeer
+			/// The peer serves a new method on jet that is completed later.
+			/// The callback returns right away, the response is send when the request is completed via the responder.
+			/// Hence the peer serves many concurrent slow method calls, i.e. those calling other peers or waiting for hardware.
+			/// @param path Path of the new method
+			/// @param timeout_s the timeout in seconds how long a routed request for this method might last
+			/// @param resultCallback called on completion or error providing the result. Executed in eventloop context.
+			/// @param callback function to be called when method is called via jet.
+			void addDeferredMethodAsync(const std::string& path, double timeout_s, responseCallback_t resultCallback, deferredMethodCallback_t callback);
+
 			/// @ingroup owningPeer
 			/// The peer serves a new state on jet. Other peers can fetch or set the state.
 			/// @param path Path of the new state
 			/// @param value Initial value of the state
 			/// @param resultCallback called on completion or error providing the result
-			/// @param callback function to be called when state is set via jet. Executed in eventloop eontext. leave empty for read only states.
-			void addStateAsync(const std::string& path, const Json::Value& value, responseCallback_t resultCallback, stateCallback_t callback);
+			/// @param callback function to be called when state is set via jet. Executed in eventloop context. leave empty for read only states.
+			/// \return handle to notify the state fast
+			StateHandle addStateAsync(const std::string& path, const Json::Value& value, responseCallback_t resultCallback, stateCallback_t callback);
 
 			/// @ingroup owningPeer
 			/// The peer serves a new state on jet Other peers can fetch or set the state.
 			/// @param path Path of the new state
 			/// @param value Initial value of the state
-			/// @param resultCallback called on completion or error providing the result. Executed in eventloop eontext.
-			/// @param callback function to be called when state is set via jet. Executed in eventloop eontext. leave empty for read only states
+			/// @param resultCallback called on completion or error providing the result. Executed in eventloop context.
+			/// @param callback function to be called when state is set via jet. Executed in eventloop context. leave empty for read only states
 			/// @param timeout_s the timeout in seconds how long a routed request for this state might last
-			void addStateAsync(const std::string& path, const Json::Value& value, double timeout_s, responseCallback_t resultCallback, stateCallback_t callback);
+			/// \return handle to notify the state fast
+			StateHandle addStateAsync(const std::string& path, const Json::Value& value, double timeout_s, responseCallback_t resultCallback, stateCallback_t callback);
 
 			/// @ingroup owningPeer
 			/// The peer serves a new state on jet Other peers can fetch or set the state.
@@ -219,12 +435,41 @@ namespace hbk
 			/// @param fetchGroups list of user groups that are allowed to fetch this state
 			/// @param setGroups list of user groups that are allowed to set this state
 			/// @param value the initial value of the state
-			/// @param callback function to be called when state is set via jet. Executed in eventloop eontext. Put nullptr in for read only states.
+			/// @param callback function to be called when state is set via jet. Executed in eventloop context. Put nullptr in for read only states.
 			/// @param timeout_s the timeout in seconds how long a routed request for this state might last
-			/// @param resultCallback called on completion or error providing the result. Executed in eventloop eontext.
-			void addStateAsync(const std::string& path, const userGroups_t& fetchGroups, const userGroups_t& setGroups,
+			/// @param resultCallback called on completion or error providing the result. Executed in eventloop context.
+			/// \return handle to notify the state fast
+			StateHandle addStateAsync(const std::string& path, const userGroups_t& fetchGroups, const userGroups_t& setGroups,
 				const Json::Value& value, double timeout_s, responseCallback_t resultCallback, stateCallback_t callback);
 
+			/// @ingroup owningPeer
+			/// The peer serves a new state on jet that is set later.
+			/// The callback returns right away, the response is send when the request is completed via the responder.
+			/// @param path Path of the new state
+			/// @param value Initial value of the state
+			/// @param timeout_s the timeout in seconds how long a routed request for this state might last
+			/// @param resultCallback called on completion or error providing the result. Executed in eventloop context.
+			/// @param callback function to be called when state is set via jet.
+			/// \return handle to notify the state fast
+			StateHandle addDeferredStateAsync(const std::string& path, const Json::Value& value, double timeout_s, responseCallback_t resultCallback, deferredStateCallback_t callback);
+
+			/// @ingroup owningPeer
+			/// The peer serves many new states. All callbacks are registered at once before the first request is send.
+			/// The requests are send as json rpc batches. All of them are in flight at once, there is no round trip per state.
+			/// States that could not be added are unregistered. A path contained more than once is added by its first occurrence,
+			/// further ones fail without sending a request.
+			/// @param resultCallback called once all states are added or failed. Executed in eventloop context.
+			/// \return handles to notify the states fast, in the order of the states
+			std::vector < StateHandle > addStatesAsync(const std::vector < StateSpec >& states, batchResponseCallback_t resultCallback);
+
+			/// @ingroup owningPeer
+			/// The peer serves many new methods. All callbacks are registered at once before the first request is send.
+			/// The requests are send as json rpc batches. All of them are in flight at once, there is no round trip per method.
+			/// Methods that could not be added are unregistered. A path contained more than once is added by its first occurrence,
+			/// further ones fail without sending a request.
+			/// @param resultCallback called once all methods are added or failed. Executed in eventloop context.
+			void addMethodsAsync(const std::vector < MethodSpec >& methods, batchResponseCallback_t resultCallback);
+
 			/// @ingroup owningPeer
 			/// @param path Path of the state to be removed
 			/// The peer no longer serves the state
@@ -236,10 +481,99 @@ namespace hbk
 			template <class valueType>
 			int notifyState(const std::string& path, valueType value);
 
+			/// @ingroup owningPeer
+			/// the peer serving the state notifies a change to the jet daemon. All other fetching peers are notified.
+			/// This is the fastest way to notify. Path lookup and escaping were done when adding the state.
+			/// @param state Handle returned when adding the state
+			/// \return -1 if the state is not registered or on error
+			template <class valueType>
+			int notifyState(const StateHandle& state, valueType value);
+
+			/// Messages that can not be written to the socket immediately are queued and written when the socket gets writable.
+			/// Hence sending never blocks, even if the jet daemon is slow.
 			/// @param value payload to be send
 			/// \throws exception on error
 			void sendMessage(const Json::Value &value);
 
+			/// @ingroup anyPeer
+			/// The peer is congested when the send queue exceeds the high watermark. It stays congested until the queue drained below the low watermark.
+			/// Senders are not blocked nor are messages dropped. Reduce the rate of sending while congested!
+			/// @param lowWatermark in bytes
+			/// @param highWatermark in bytes
+			/// @param callback Executed in eventloop context whenever the peer gets congested or relieved
+			void setSendQueueWatermarks(size_t lowWatermark, size_t highWatermark, backpressureCallback_t callback = backpressureCallback_t());
+
+			/// @ingroup anyPeer
+			/// \return true if the send queue exceeded the high watermark and did not drain below the low watermark yet
+			bool isCongested() const;
+
+			/// @ingroup anyPeer
+			sendQueueStatus_t getSendQueueStatus() const;
+
+			/// @ingroup anyPeer
+			/// Messages are no longer send one by one but collected and send together with a single system call.
+			/// This saves lots of system calls when sending many messages (i.e. notifying many states) in a row.
+			/// Collected messages are send
+			/// - at the end of the current eventloop cycle if window is 0
+			/// - when the window elapsed after collecting the first message otherwise
+			/// - when the collected messages reach MAX_MESSAGE_SIZE
+			/// - on flush() or uncork()
+			/// \note Errors on sending collected messages are logged and not reported to the caller of sendMessage()
+			/// @param window Time to collect messages. The eventloop timer has a resolution of milliseconds, the window is rounded up.
+			void cork(std::chrono::microseconds window = std::chrono::microseconds(0));
+
+			/// @ingroup anyPeer
+			/// Send all collected messages and send all following messages immediately
+			void uncork();
+
+			/// @ingroup anyPeer
+			/// Send all collected messages and all pending conflated change notifications now
+			/// \throws hbk::exception::jsonrpcException on error
+			void flush();
+
+			/// @ingroup owningPeer
+			/// Change notifications of all states are conflated. Only the latest value of each state is kept and send later.
+			/// Pending change notifications are send
+			/// - at the end of the current eventloop cycle if interval is 0
+			/// - when the interval elapsed after the first pending change notification otherwise
+			/// - on flush() or unconflate()
+			///
+			/// This bounds the load of network and jet daemon no matter how often states are notified.
+			/// Fetching peers might miss intermediate values!
+			/// @param interval Maximum delay of a change notification. The eventloop timer has a resolution of milliseconds.
+			void conflate(std::chrono::milliseconds interval = std::chrono::milliseconds(0));
+
+			/// @ingroup owningPeer
+			/// Send pending conflated change notifications. All following change notifications are send immediately
+			/// unless conflation was enabled for the state. Those are send at the end of the eventloop cycle again.
+			void unconflate();
+
+			/// @ingroup owningPeer
+			/// Enable or disable conflation of a single state. Pending change notifications are send as configured by conflate().
+			/// Disabling sends all pending conflated change notifications.
+			/// @param state Handle returned when adding the state
+			/// \return -1 if the state is not registered
+			int conflate(const StateHandle& state, bool enable);
+
+			/// @ingroup anyPeer
+			receiveStatus_t getReceiveStatus() const;
+
+			/// @ingroup anyPeer
+			/// Replace the decoder of received telegrams. Default is the ScanningFrameDecoder.
+			/// \warning Do not call from within a callback function executed in eventloop context!
+			void setFrameDecoder(std::unique_ptr < FrameDecoder > frameDecoder);
+
+			/// @ingroup anyPeer
+			/// Execute state and method callbacks on a pool of threads instead of the eventloop.
+			/// A slow callback does not delay fetch notifications, responses and requests for other states and methods anymore.
+			/// Requests for the same path are executed one after the other in the order they were received.
+			/// The response is send when the callback returns.
+			/// Callbacks already queued are executed before this returns. Requests received meanwhile are executed by the new workers already.
+			/// Callbacks queued are dropped when the peer gets stopped or the connection is lost, their responses can not be send anymore.
+			/// @param workerCount number of threads. 0 executes the callbacks in eventloop context (default)
+			/// \warning Do not call from within a callback function!
+			void setCallbackWorkers(unsigned int workerCount);
+
 			/// If using yout own event loop, wait for this to get readable before calling receive()
 			sys::event getReceiverEvent() const
 			{
@@ -260,14 +594,6 @@ namespace hbk
 
 
 		protected:
-			/// the path of the method is the key.
-			using methodCallbacks_t = std::unordered_map < std::string, methodCallback_t >;
-			/// the path of the state is the key.
-			using stateCallbacks_t = std::unordered_map < std::string, stateCallback_t >;
-
-			/// fetch id is the key
-			using fetchers_t = std::unordered_map < fetchId_t, fetcher_t >;
-
 			/// Connect to jet daemon and start jet peer
 			/// \throws std::runtime_error
 			void start();
@@ -275,13 +601,18 @@ namespace hbk
 			void stop();
 
 		private:
+			/// \return true if adding states and methods failed because the connection is lost. They are added again after reconnecting.
+			bool isRestoredLater() const;
 			void addMethodResultCb(const Json::Value& result, const std::string& path);
 			void addStateResultCb(const Json::Value& result, const std::string& path);
 			void addFetchResultCb(const Json::Value& result, fetchId_t fetchId);
 
-			void registerFetch(fetchId_t fetchId, const fetcher_t& fetcher);
-			void registerMethod(const std::string& path, methodCallback_t callback);
-			void registerState(const std::string& path, stateCallback_t callback);
+			/// \return id of the new fetch
+			fetchId_t registerFetch(const fetcher_t& fetcher);
+			/// @param params parameters of the request adding the method
+			void registerMethod(const std::string& path, const Json::Value& params, methodCallback_t callback, deferredMethodCallback_t deferredCallback = deferredMethodCallback_t());
+			/// @param params parameters of the request adding the state
+			std::shared_ptr < const detail::stateEntry > registerState(const std::string& path, const Json::Value& params, stateCallback_t callback, deferredStateCallback_t deferredCallback = deferredStateCallback_t());
 
 			void unregisterFetch(fetchId_t fetchId);
 			void unregisterMethod(const std::string& path);
@@ -289,16 +620,105 @@ namespace hbk
 
 			static void addPathInformation(Json::Value& params, const matcher_t& match);
 			
-			/// create a new fetch id
-			static fetchId_t createFetchId();
-
-			void addMethodAsyncPrivate(const std::string& path, Json::Value& params, responseCallback_t resultCallback, methodCallback_t callback);
-
-			/// restore a fetch already known in the internal structures. This is done when reconnecting after loosing connection to jetd.
-			void restoreFetch(const matcher_t& match, fetchId_t fetchId);
+			void addMethodAsyncPrivate(const std::string& path, Json::Value& params, responseCallback_t resultCallback, methodCallback_t callback, deferredMethodCallback_t deferredCallback = deferredMethodCallback_t());
+
+			/// restore all fetches known in the internal structures at once. This is done when reconnecting after loosing connection to jetd.
+			/// A fetch that can not be restored is removed, its fetcher is called with the error response and status -1.
+			void restoreFetches();
+			/// add all states and methods known in the internal structures at once. This is done when reconnecting after loosing connection to jetd.
+			void restoreRegistrations();
+
+			/// Close the connection. Open requests are completed, fetchers are notified. States and methods are kept.
+			void disconnect();
+			/// called when the connection got lost. Stops the peer or schedules reconnecting.
+			void connectionLost();
+			/// arm the reconnect timer, executed in eventloop context
+			void startReconnectTimer();
+			/// executed in eventloop context
+			void reconnect(bool fired);
+			/// remember the latest value of the state if the peer reconnects automatically
+			void keepStateValue(const std::string& path, const Json::Value& value);
+			/// remember the value of a change notification that is not terminated yet if the peer reconnects automatically
+			void keepChangedValue(const std::string& path, const std::string& telegram);
+
+			/// the generic way, composes a Json::Value
+			template <class valueType>
+			static void appendChangeValue(std::string& telegram, const valueType& value, detail::notifyJsonTag);
+			/// the fast way for scalar values and strings.
+			template <class valueType>
+			static void appendChangeValue(std::string& telegram, const valueType& value, detail::notifyBoolTag);
+			template <class valueType>
+			static void appendChangeValue(std::string& telegram, const valueType& value, detail::notifySignedTag);
+			template <class valueType>
+			static void appendChangeValue(std::string& telegram, const valueType& value, detail::notifyUnsignedTag);
+			template <class valueType>
+			static void appendChangeValue(std::string& telegram, const valueType& value, detail::notifyFloatTag);
+			template <class valueType>
+			static void appendChangeValue(std::string& telegram, const valueType& value, detail::notifyStringTag);
+
+			static void appendChangeValue(std::string& telegram, bool value);
+			static void appendChangeValue(std::string& telegram, int64_t value);
+			static void appendChangeValue(std::string& telegram, uint64_t value);
+			static void appendChangeValue(std::string& telegram, double value);
+			static void appendChangeValue(std::string& telegram, const char* pString, size_t len);
+			static void appendChangeValue(std::string& telegram, const Json::Value& value);
+
+			/// \return thread local buffer with the start of the change notification of the state. The value is to be appended by the caller.
+			/// @param[out] conflated true if the change notification is to be conflated
+			std::string& startChangeNotification(const std::string& path, bool& conflated);
+			std::string& startChangeNotification(const detail::stateEntry& state, bool& conflated);
+			/// append the end of the change notification and send or conflate it
+			/// \return 0 on success, -1 on error
+			int finishChangeNotification(std::string& telegram, const std::string& path, bool conflated);
+			/// Replace the pending change notification of the state or add a new one.
+			/// The telegram is swapped in, the caller gets back a buffer to reuse.
+			void conflateChange(const std::string& path, std::string& telegram);
+
+			/// @param pPayload serialized json to be send
+			/// \throws hbk::exception::jsonrpcException on error
+			void sendPayload(const char* pPayload, size_t len);
 
 			/// called when a complete packet arrived. This might contain a single jet message or a batch of several jet messages.
 			void receiveCallback(const Json::Value& data);
+			/// decode a complete telegram and process it
+			void processTelegram(const char* pTelegram, size_t len);
+
+			virtual void consumeMessage(const Json::Value& message) override;
+			virtual bool isFetchConsumed(fetchId_t fetchId) override;
+			virtual bool isRequestConsumed(const std::string& path) override;
+			virtual void consumeFetchNotification(fetchId_t fetchId, const Json::Value& params) override;
+
+			/// send collected messages. m_sendMutex needs to be locked by the caller!
+			/// \return -1 on error
+			int sendCollected();
+			/// executed in eventloop context to send collected messages
+			void flushScheduled();
+			/// Write to the socket without blocking. What can not be written is queued. m_sendMutex needs to be locked by the caller!
+			/// \return -1 on error
+			int writeBlocks(const communication::dataBlock_t* pBlocks, size_t blockCount);
+			/// executed in eventloop context when the socket got writable
+			int drainSendQueue();
+			/// m_sendMutex needs to be locked by the caller!
+			void clearSendQueue();
+			/// executed in eventloop context to report a change of congestion
+			void reportCongestion();
+
+			/// send collected messages if MAX_MESSAGE_SIZE is reached, schedule sending otherwise. m_sendMutex needs to be locked by the caller!
+			/// \return -1 on error
+			int collect();
+			/// send all pending conflated change notifications at once
+			/// \return -1 on error
+			int sendConflated();
+			/// executed in eventloop context to send pending conflated change notifications
+			void sendConflatedScheduled();
+			/// executed in eventloop context to resume coroutines awaiting futures of this peer
+			void resumeScheduled();
+			/// The job is executed in eventloop context. Used for results that are known before sending a request.
+			void post(std::function < void() > job);
+			/// \return promise whose awaiting coroutines are resumed in the eventloop of this peer
+			Promise < JsonRpcResponseObject > createPromise() const;
+			/// forget the pending change notification of the state
+			void dropConflated(const std::string& path);
 
 			/// Handles all kinds of messages coming in
 			/// 
@@ -314,10 +734,16 @@ namespace hbk
 			/// }
 			/// \endcode
 			void handleMessage(const Json::Value& data);
+			/// execute the state callback and send the response
+			void handleStateRequest(const detail::stateEntry& state, const Json::Value& data);
+			/// execute the method callback and send the response
+			void handleMethodRequest(const methodCallback_t& callback, const Json::Value& data);
+			/// execute the callback of a deferred method. The response is send when the request is completed.
+			void handleDeferredMethodRequest(const deferredMethodCallback_t& callback, const Json::Value& data);
 
-			void addStateAsyncPrivate(const std::string& path, const Json::Value& value, Json::Value& params, responseCallback_t resultCallback, stateCallback_t callback);
-			void setStateValueAsyncPrivate(const std::string& path, const Json::Value& value, Json::Value& params, responseCallback_t resultCallback);
-			void callMethodAsyncPrivate(const std::string& path, const Json::Value& args, Json::Value& params, responseCallback_t resultCb);
+			StateHandle addStateAsyncPrivate(const std::string& path, const Json::Value& value, Json::Value& params, responseCallback_t resultCallback, stateCallback_t callback, deferredStateCallback_t deferredCallback = deferredStateCallback_t());
+			requestId_t setStateValueAsyncPrivate(const std::string& path, const Json::Value& value, Json::Value& params, responseCallback_t resultCallback);
+			requestId_t callMethodAsyncPrivate(const std::string& path, const Json::Value& args, Json::Value& params, responseCallback_t resultCb);
 
 			/// name or tcp address of jetd
 			/// name of unix domain socket
@@ -329,56 +755,198 @@ namespace hbk
 
 			hbk::sys::EventLoop& m_eventLoop;
 			hbk::communication::SocketNonblocking m_socket;
-			volatile bool m_stopped;
-
+			std::atomic < bool > m_stopped;
+			/// incremented whenever the connection is closed. Requests received on a previous connection are not to be answered.
+			std::atomic < uint64_t > m_connectionGeneration;
+
+
+			mutable std::mutex m_sendMutex;
+			/// bytes that could not be written to the socket yet. Sending starts at m_sendQueuePos.
+			std::string m_sendQueue;
+			size_t m_sendQueuePos;
+			size_t m_lowWatermark;
+			size_t m_highWatermark;
+			sendQueueStatus_t m_sendQueueStatus;
+			backpressureCallback_t m_backpressureCallback;
+			/// congestion last reported to m_backpressureCallback
+			bool m_reportedCongestion;
+			hbk::sys::Notifier m_backpressureNotifier;
+
+			/// if set, messages are collected in m_sendBuffer
+			bool m_corked;
+			std::chrono::milliseconds m_corkWindow;
+			/// complete jet telegrams (length information followed by payload) waiting to be send
+			std::string m_sendBuffer;
+			/// sending the collected messages is scheduled already
+			bool m_flushScheduled;
+			hbk::sys::Notifier m_flushNotifier;
+			hbk::sys::Timer m_flushTimer;
+
+			/// locked before m_sendMutex when sending pending change notifications
+			std::mutex m_conflateMutex;
+			/// change notifications of all states are conflated
+			std::atomic < bool > m_conflateAll;
+			std::chrono::milliseconds m_conflateInterval;
+			/// latest change notification of each state. Only the first m_conflatedCount are pending.
+			/// Strings are kept to reuse their capacity. An empty string is a dropped change notification.
+			std::vector < std::string > m_conflatedChanges;
+			size_t m_conflatedCount;
+			/// path => index in m_conflatedChanges
+			std::unordered_map < std::string, size_t > m_conflatedIndex;
+			/// complete jet telegrams (length information followed by payload) of all pending change notifications
+			std::string m_conflatedFrames;
+			/// sending the pending change notifications is scheduled already
+			bool m_conflateScheduled;
+			hbk::sys::Notifier m_conflateNotifier;
+			hbk::sys::Timer m_conflateTimer;
 
-			std::mutex m_sendMutex;
 			std::mutex m_receiveMutex; /// is needed when working with ThreadPools and external eventloops. e.g. Qt
 
-			/// buffer for length information of each received jet telegram
-			uint32_t m_bigEndianLengthBuffer;
-			size_t m_lengthBufferLevel;
+			/// Received data is read into this buffer in chunks as large as possible. Telegrams are parsed in place.
+			std::unique_ptr < ReceiveBuffer > const m_receiveBuffer;
 
 
-			stateCallbacks_t m_stateCallbacks;
-			/// user defined callback triggered from handleObject might create or detroy a state.
-			std::recursive_mutex m_mtx_stateCallbacks;
-			methodCallbacks_t m_methodCallbacks;
-			/// user defined callback triggered from handleObject might create or detroy a method.
-			std::recursive_mutex m_mtx_methodCallbacks;
-			fetchers_t m_fetchers;
-			/// user defined callback triggered from handleObject might create or detroy a fetch.
-			std::recursive_mutex m_mtx_fetchers;
+			/// States and methods are dispatched without locking. User defined callbacks might create or destroy states and methods.
+			std::unique_ptr < PathRegistry > const m_pathRegistry;
+			/// executes state and method callbacks if set. Replaced while m_receiveMutex is locked.
+			std::unique_ptr < WorkerPool > m_callbackWorkers;
+			/// shared with all responders of deferred requests. Cut on destruction.
+			std::shared_ptr < detail::responderLink > const m_responderLink;
+			/// Fetch notifications are dispatched without locking. User defined callbacks might create or destroy fetches.
+			std::unique_ptr < FetchTable > const m_fetchTable;
 
 
-			/// payload of jet telegram
-			std::vector < char > m_dataBuffer;
-			size_t m_dataBufferLevel;
-
 			/// this is use in a synchronized sequence. Hence we create in only once and reuse it.
-			std::unique_ptr<Json::CharReader> const m_reader;
+			std::unique_ptr < FrameDecoder > m_frameDecoder;
 			std::string parseErrors;
-
-			static std::atomic <fetchId_t > m_sfetchId;
+			std::atomic < uint64_t > m_telegramCount;
+			std::atomic < uint64_t > m_decodeErrorCount;
+			std::atomic < uint64_t > m_droppedFetchNotificationCount;
+			std::atomic < uint64_t > m_droppedRequestCount;
+
+			/// requests of this peer waiting for a response
+			std::unique_ptr<PendingRequests> const m_pendingRequests;
+			/// in milliseconds, 0 for no limit
+			std::atomic < int64_t > m_requestTimeout;
+
+			std::atomic < bool > m_connected;
+			/// reconnect automatically after losing the connection
+			std::atomic < bool > m_autoReconnect;
+			/// locked when reconnecting and when stopping. Reconnecting after the peer was stopped is prevented.
+			std::mutex m_reconnectMutex;
+			std::chrono::milliseconds m_reconnectMinDelay;
+			std::chrono::milliseconds m_reconnectMaxDelay;
+			/// delay before the next attempt to reconnect
+			std::chrono::milliseconds m_reconnectDelay;
+			connectionCallback_t m_connectionCallback;
+			/// the timer is armed in eventloop context only
+			hbk::sys::Notifier m_reconnectNotifier;
+			hbk::sys::Timer m_reconnectTimer;
+
+			/// jobs to be executed in eventloop context, e.g. resuming coroutines awaiting futures of this peer.
+			/// Shared with the promises handed out. Cut on destruction.
+			std::shared_ptr < detail::resumeQueue > const m_resumeQueue;
+			hbk::sys::Notifier m_resumeNotifier;
 		};
 
+		namespace detail
+		{
+			/// The kind of value decides how it gets serialized on notification
+			struct notifyBoolTag {};
+			struct notifySignedTag {};
+			struct notifyUnsignedTag {};
+			struct notifyFloatTag {};
+			struct notifyStringTag {};
+			struct notifyJsonTag {};
+
+			template < class valueType >
+			struct notifyTag
+			{
+				using type = typename std::conditional < std::is_same < valueType, bool >::value, notifyBoolTag,
+					typename std::conditional < std::is_integral < valueType >::value && std::is_signed < valueType >::value, notifySignedTag,
+					typename std::conditional < std::is_integral < valueType >::value, notifyUnsignedTag,
+					typename std::conditional < std::is_floating_point < valueType >::value, notifyFloatTag,
+					typename std::conditional < std::is_same < valueType, std::string >::value || std::is_same < valueType, const char* >::value || std::is_same < valueType, char* >::value, notifyStringTag,
+					notifyJsonTag >::type >::type >::type >::type >::type;
+			};
+
+			inline const char* stringData(const std::string& value)
+			{
+				return value.c_str();
+			}
+
+			inline size_t stringLength(const std::string& value)
+			{
+				return value.length();
+			}
+
+			inline const char* stringData(const char* value)
+			{
+				return value;
+			}
+
+			inline size_t stringLength(const char* value)
+			{
+				return strlen(value);
+			}
+		}
+
 		template <class valueType>
 		/// we tell the jet daemon about the new value of the state. We do not send an id, hence jetd will not give us an response. This increases performance a lot.
 		int PeerAsync::notifyState(const std::string& path, valueType value)
 		{
-			Json::Value data;
-
-			data[jsonrpc::METHOD] = CHANGE;
-			Json::Value& params = data[jsonrpc::PARAMS];
-			params[PATH] = path;
-			params[VALUE] = value;
+			bool conflated;
+			std::string& telegram = startChangeNotification(path, conflated);
+			appendChangeValue(telegram, value, typename detail::notifyTag < typename std::decay < valueType >::type >::type());
+			return finishChangeNotification(telegram, path, conflated);
+		}
 
-			try {
-				sendMessage(data);
-			} catch(...) {
+		template <class valueType>
+		int PeerAsync::notifyState(const StateHandle& state, valueType value)
+		{
+			if (!state.isRegistered()) {
 				return -1;
 			}
-			return 0;
+			bool conflated;
+			std::string& telegram = startChangeNotification(*state.m_entry, conflated);
+			appendChangeValue(telegram, value, typename detail::notifyTag < typename std::decay < valueType >::type >::type());
+			return finishChangeNotification(telegram, state.m_entry->path, conflated);
+		}
+
+		template <class valueType>
+		void PeerAsync::appendChangeValue(std::string& telegram, const valueType& value, detail::notifyJsonTag)
+		{
+			appendChangeValue(telegram, Json::Value(value));
+		}
+
+		template <class valueType>
+		void PeerAsync::appendChangeValue(std::string& telegram, const valueType& value, detail::notifyBoolTag)
+		{
+			appendChangeValue(telegram, static_cast < bool > (value));
+		}
+
+		template <class valueType>
+		void PeerAsync::appendChangeValue(std::string& telegram, const valueType& value, detail::notifySignedTag)
+		{
+			appendChangeValue(telegram, static_cast < int64_t > (value));
+		}
+
+		template <class valueType>
+		void PeerAsync::appendChangeValue(std::string& telegram, const valueType& value, detail::notifyUnsignedTag)
+		{
+			appendChangeValue(telegram, static_cast < uint64_t > (value));
+		}
+
+		template <class valueType>
+		void PeerAsync::appendChangeValue(std::string& telegram, const valueType& value, detail::notifyFloatTag)
+		{
+			appendChangeValue(telegram, static_cast < double > (value));
+		}
+
+		template <class valueType>
+		void PeerAsync::appendChangeValue(std::string& telegram, const valueType& value, detail::notifyStringTag)
+		{
+			appendChangeValue(telegram, detail::stringData(value), detail::stringLength(value));
 		}
 	}
 }
@@ -21,15 +21,6 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
-#include <mutex>
-
-#ifdef _WIN32
-#define syslog fprintf
-#define LOG_ERR stderr
-#else
-#include "syslog.h"
-#endif
-
 #include <json/writer.h>
 
 #include "asyncrequest.h"
@@ -42,52 +33,60 @@ namespace hbk
 {
 	namespace jet
 	{
-		unsigned int AsyncRequest::m_sid = 0;
-		AsyncRequest::openRequests_t AsyncRequest::m_openRequestCbs;
-		std::mutex AsyncRequest::m_mtx_openRequestCbs;
-
 		AsyncRequest::AsyncRequest(const char *pName, const Json::Value& params)
 			: m_id(0)
+			, m_pPendingRequests(nullptr)
 		{
 			m_requestDoc[jsonrpc::JSONRPC] = "2.0";
 			m_requestDoc[jsonrpc::METHOD] = pName;
 			m_requestDoc[jsonrpc::PARAMS] = params;
 		}
 
-		void AsyncRequest::execute(PeerAsync& peerAsync, const responseCallback_t& resultCb)
+		std::chrono::milliseconds AsyncRequest::getTimeout(const PeerAsync& peerAsync) const
+		{
+			std::chrono::milliseconds timeout(peerAsync.m_requestTimeout);
+			if (timeout.count() == 0) {
+				return timeout;
+			}
+			// set and call are routed to the owning peer, the jet daemon responds when its timeout elapsed.
+			const std::string method = m_requestDoc[jsonrpc::METHOD].asString();
+			if ((method == SET) || (method == CALL)) {
+				const Json::Value& timeoutNode = m_requestDoc[jsonrpc::PARAMS][TIMEOUT];
+				if (timeoutNode.isNumeric()) {
+					timeout += std::chrono::milliseconds(static_cast < std::chrono::milliseconds::rep > (timeoutNode.asDouble() * 1000));
+				}
+			}
+			return timeout;
+		}
+
+		requestId_t AsyncRequest::prepare(PeerAsync& peerAsync, const responseCallback_t& resultCb)
 		{
 			if (resultCb) {
 				// we do not expect an answer when there is no result callback to be called
-				{
-					std::lock_guard < std::mutex > local(m_mtx_openRequestCbs);
-					m_id = ++m_sid;
-					m_openRequestCbs[m_id].responseCallback = resultCb;
-				}
-				m_requestDoc[jsonrpc::ID] = m_id;
+				m_pPendingRequests = peerAsync.m_pendingRequests.get();
+				m_id = m_pPendingRequests->add(resultCb, getTimeout(peerAsync));
+				m_requestDoc[jsonrpc::ID] = static_cast < Json::UInt64 > (m_id);
 			}
+			return m_id;
+		}
+
+		requestId_t AsyncRequest::execute(PeerAsync& peerAsync, const responseCallback_t& resultCb)
+		{
+			prepare(peerAsync, resultCb);
 
 			try {
 				peerAsync.sendMessage(m_requestDoc);
 			} catch (const hbk::exception::jsonrpcException& e) {
 				// "instant" error response call back is not to be called int this context but in eventloop context 
 				// that handles all responmse callback functions.
-				// To achive this, we use a notifier with a callback that is executed in the eventloop context.
 				if (resultCb) {
-					// no std::make_unique because we are bound to C++11
-					auto NotifierCb = [this, e]()
-					{
-						Json::Value response;
-						response[jsonrpc::ID] = m_id;
-						response[jsonrpc::ERR][jsonrpc::CODE] = e.code();
-						response[jsonrpc::ERR][jsonrpc::MESSAGE] = e.message();
-						handleResult(response);
-					};
-					// Here we create it because we need it only in this case!
-					m_openRequestCbs[m_id].errorNotifier = std::unique_ptr<hbk::sys::Notifier>(new hbk::sys::Notifier(peerAsync.getEventLoop()));
-					m_openRequestCbs[m_id].errorNotifier->set(NotifierCb);
-					m_openRequestCbs[m_id].errorNotifier->notify();
+					Json::Value error;
+					error[jsonrpc::ERR][jsonrpc::CODE] = e.code();
+					error[jsonrpc::ERR][jsonrpc::MESSAGE] = e.message();
+					m_pPendingRequests->notifyError(m_id, peerAsync.getEventLoop(), error);
 				}
 			}
+			return m_id;
 		}
 
 		void AsyncRequest::execute(PeerAsync& peerAsync)
@@ -98,50 +97,59 @@ namespace hbk
 				// ignore!
 			}
 		}
-		
-		void AsyncRequest::handleResult(const Json::Value& data)
+
+		AsyncRequestBatch::AsyncRequestBatch(PeerAsync& peerAsync)
+			: m_peerAsync(peerAsync)
+			, m_writerBuilder()
+			, m_batch()
+			, m_ids()
 		{
-			unsigned int id = data[jsonrpc::ID].asUInt();
-			responseCallback_t responseCallback;
-			{
-				std::lock_guard < std::mutex > lock(m_mtx_openRequestCbs);
-				const auto iter = m_openRequestCbs.find(id);
-				if (iter == m_openRequestCbs.cend()) {
-					syslog(LOG_ERR, "jet peer: No request with id='%u' is waiting for a response!", id);
-					return;
-				}
-				responseCallback = iter->second.responseCallback;
-				m_openRequestCbs.erase(iter);
+			m_writerBuilder.settings_["indentation"] = "";
+		}
+
+		void AsyncRequestBatch::add(const char* pName, const Json::Value& params, const responseCallback_t& resultCb)
+		{
+			AsyncRequest request(pName, params);
+			requestId_t id = request.prepare(m_peerAsync, resultCb);
+			std::string msg = Json::writeString(m_writerBuilder, request.getRequestDoc());
+			// 2 bytes for the brackets of the batch
+			if ((!m_batch.empty()) && (m_batch.length() + 1 + msg.length() + 2 > MAX_MESSAGE_SIZE)) {
+				execute();
 			}
-			try {
-				responseCallback(data);
-			} catch(...) {
-				// catch and ignoreeverything!
+			if (!m_batch.empty()) {
+				m_batch += ',';
+			}
+			m_batch += msg;
+			if (id) {
+				m_ids.push_back(id);
 			}
 		}
 
-		size_t AsyncRequest::clear()
+		void AsyncRequestBatch::execute()
 		{
-			size_t count;
-			std::lock_guard < std::mutex > lock(m_mtx_openRequestCbs);
+			if (m_batch.empty()) {
+				return;
+			}
+			std::string batch;
+			batch.reserve(m_batch.length() + 2);
+			batch += '[';
+			batch += m_batch;
+			batch += ']';
+			m_batch.clear();
+			std::vector < requestId_t > ids;
+			ids.swap(m_ids);
 
-			count = m_openRequestCbs.size();
-			for (auto &iter: m_openRequestCbs) {
-				responseCallback_t resopnseCallback = iter.second.responseCallback;
-				if (resopnseCallback) {
-					Json::Value error;
-					error[jsonrpc::ID] = iter.first;
-					error[jsonrpc::ERR][jsonrpc::CODE] = -1;
-					error[jsonrpc::ERR][jsonrpc::MESSAGE] = "jet request has been canceled without response!";
-					try {
-						resopnseCallback(error);
-					} catch(...) {
-						// catch and ignoreeverything!
-					}
+			try {
+				m_peerAsync.sendPayload(batch.c_str(), batch.length());
+			} catch (const hbk::exception::jsonrpcException& e) {
+				// all requests of the batch get the error response in eventloop context
+				Json::Value error;
+				error[jsonrpc::ERR][jsonrpc::CODE] = e.code();
+				error[jsonrpc::ERR][jsonrpc::MESSAGE] = e.message();
+				for (requestId_t id: ids) {
+					m_peerAsync.m_pendingRequests->notifyError(id, m_peerAsync.getEventLoop(), error);
 				}
 			}
-			m_openRequestCbs.clear();
-			return count;
 		}
 	}
 }
@@ -24,16 +24,18 @@
 #ifndef __HBK_JET_ASYNCREQUEST_H
 #define __HBK_JET_ASYNCREQUEST_H
 
-#include <unordered_map>
-#include <mutex>
+#include <chrono>
+#include <string>
+#include <vector>
 
 #include <json/value.h>
-
-#include "hbk/sys/notifier.h"
+#include <json/writer.h>
 
 #include "jet/peerasync.hpp"
 #include "jet/defines.h"
 
+#include "pendingrequests.h"
+
 namespace hbk
 {
 	namespace jet
@@ -55,36 +57,56 @@ namespace hbk
 			AsyncRequest& operator=(const AsyncRequest&) = delete;
 
 			/// send the request does not wait for result
-			/// the result callback is being kept until the result arrives.
-			void execute(PeerAsync &peerAsync, const responseCallback_t& resultCb);
+			/// the result callback is being kept until the result arrives or the request timeout of the peer elapsed.
+			/// \return id of the request waiting for the response
+			requestId_t execute(PeerAsync &peerAsync, const responseCallback_t& resultCb);
 			/// Send the request. The is no result callback method. Hence no jsonrpc id is being send and no json rpc response will return
 			void execute(PeerAsync& peerAsync);
 
-			/// find the request this reply belongs to!
-			static void handleResult(const Json::Value& params);
+			/// Wait for the response without sending the request. Used for requests that are send as part of a batch.
+			/// \return id of the request waiting for the response, 0 if there is no result callback
+			requestId_t prepare(PeerAsync& peerAsync, const responseCallback_t& resultCb);
 
-			/// Clear all open requests. Responses for those won't be recognized afterwards!
-			/// All request callbacks will be called with an error object stating that the request was canceled without response!
-			/// \return number of requests removed
-			static size_t clear();
+			const Json::Value& getRequestDoc() const
+			{
+				return m_requestDoc;
+			}
 
 		protected:
-			struct Request {
-				responseCallback_t responseCallback;
-				/// Since creating a notifier involves system calls, we do this only if needed.
-				std::unique_ptr<hbk::sys::Notifier> errorNotifier;
-			};
-			/// id of the request is the key
-			using openRequests_t = std::unordered_map < unsigned int, Request >;
-			
-			unsigned int m_id;
+			/// \return time to wait for the response, 0 for no limit
+			std::chrono::milliseconds getTimeout(const PeerAsync& peerAsync) const;
+
+			/// 0 if the request is not waiting for a response
+			PendingRequests::requestId_t m_id;
+			/// the pending requests of the peer that did execute the request
+			PendingRequests* m_pPendingRequests;
 			Json::Value m_requestDoc;
+		private:
+		};
+
+		/// Many requests send as json rpc batches. Each batch stays below MAX_MESSAGE_SIZE.
+		/// All requests are in flight at once, there is no round trip per request.
+		class AsyncRequestBatch
+		{
+		public:
+			explicit AsyncRequestBatch(PeerAsync& peerAsync);
+			AsyncRequestBatch(const AsyncRequestBatch&) = delete;
+			AsyncRequestBatch& operator=(const AsyncRequestBatch&) = delete;
+
+			/// the batch collected so far is send if adding this request would exceed MAX_MESSAGE_SIZE
+			/// @param resultCb nullptr if we are not interested in the response
+			void add(const char* pName, const Json::Value& params, const responseCallback_t& resultCb);
 
-			static unsigned int m_sid;
+			/// send the remaining requests
+			void execute();
 
-			static openRequests_t m_openRequestCbs;
-			static std::mutex m_mtx_openRequestCbs;
 		private:
+			PeerAsync& m_peerAsync;
+			Json::StreamWriterBuilder m_writerBuilder;
+			/// the serialized requests separated by ','
+			std::string m_batch;
+			/// ids of the requests in m_batch that wait for a response
+			std::vector < requestId_t > m_ids;
 		};
 	}
 }
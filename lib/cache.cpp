@@ -0,0 +1,711 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#define syslog fprintf
+#define LOG_WARNING stderr
+#define LOG_ERR stderr
+#else
+#include "syslog.h"
+#endif
+
+#include "json/reader.h"
+#include "json/value.h"
+#include "json/writer.h"
+
+#include "jet/cache.hpp"
+#include "jet/defines.h"
+#include "jet/peerasync.hpp"
+
+#include "callbackguard.h"
+#include "mappedfile.h"
+
+namespace hbk {
+	namespace jet {
+		/// a chunk of the path index is split when growing beyond
+		static const size_t MAX_CHUNK_SIZE = 256;
+
+		/// Snapshot file: header followed by the entries in ascending order of the path.
+		/// Header: magic, format version (uint32_t), byte order mark (uint32_t), number of entries (uint64_t)
+		/// Entry: length of path (uint32_t), length of value (uint32_t), version (uint64_t), path, value serialized as compact json
+		/// Numbers are in host byte order, a file written by a host with different byte order is rejected.
+		static const char SNAPSHOT_MAGIC[8] = { 'J', 'E', 'T', 'C', 'A', 'C', 'H', 'E' };
+		static const uint32_t SNAPSHOT_FORMAT = 1;
+		static const uint32_t SNAPSHOT_BYTE_ORDER_MARK = 0x01020304;
+		static const size_t SNAPSHOT_HEADER_SIZE = sizeof(SNAPSHOT_MAGIC) + 2 * sizeof(uint32_t) + sizeof(uint64_t);
+		static const size_t SNAPSHOT_ENTRY_HEADER_SIZE = 2 * sizeof(uint32_t) + sizeof(uint64_t);
+
+		/// values are compared with the ones restored from a snapshot file as written
+		static Json::StreamWriterBuilder createSnapshotWriterBuilder()
+		{
+			Json::StreamWriterBuilder builder;
+			builder.settings_["indentation"] = "";
+			return builder;
+		}
+		static const Json::StreamWriterBuilder snapshotWriterBuilder = createSnapshotWriterBuilder();
+
+		template < typename T >
+		static T readNumber(const char* pData)
+		{
+			T value;
+			std::memcpy(&value, pData, sizeof(value));
+			return value;
+		}
+
+		template < typename T >
+		static void writeNumber(std::ostream& stream, T value)
+		{
+			stream.write(reinterpret_cast < const char* > (&value), sizeof(value));
+		}
+
+		/// \return true if the path matches the glob pattern
+		static bool matchGlob(const char* pPattern, const char* pPath)
+		{
+			while (*pPattern!='\0') {
+				if (*pPattern=='*') {
+					bool crossLevels = (pPattern[1]=='*');
+					pPattern += crossLevels ? 2 : 1;
+					// try all lengths of the sequence matched by the wildcard
+					for (const char* pRest = pPath; ; ++pRest) {
+						if (matchGlob(pPattern, pRest)) {
+							return true;
+						}
+						if ((*pRest=='\0') || ((!crossLevels) && (*pRest=='/'))) {
+							return false;
+						}
+					}
+				}
+				if (*pPath=='\0') {
+					return false;
+				}
+				if (*pPattern=='?') {
+					if (*pPath=='/') {
+						return false;
+					}
+				} else if (*pPattern!=*pPath) {
+					return false;
+				}
+				++pPattern;
+				++pPath;
+			}
+			return *pPath=='\0';
+		}
+
+		static bool startsWith(const std::string& text, const std::string& prefix)
+		{
+			return text.compare(0, prefix.length(), prefix)==0;
+		}
+
+		cache::Entry::Entry(const Json::Value& v, uint64_t ver)
+			: value(v)
+			, version(ver)
+		{
+		}
+
+		cache::Slot::Slot(const std::string& p, size_t h, const entryPtr_t& e)
+			: path(p)
+			, hash(h)
+			, entry(e)
+			, pSnapshotValue(nullptr)
+			, snapshotValueLength(0)
+			, snapshotVersion(0)
+			, confirmed(true)
+		{
+		}
+
+		cache::Slot::Slot(const std::string& p, size_t h, const char* pValue, size_t valueLength, uint64_t ver)
+			: path(p)
+			, hash(h)
+			, entry()
+			, pSnapshotValue(pValue)
+			, snapshotValueLength(valueLength)
+			, snapshotVersion(ver)
+			, confirmed(false)
+		{
+		}
+
+		cache::Shard::Shard()
+			: slots(std::make_shared < slots_t > ())
+			, writeMtx()
+		{
+		}
+
+		cache::cache(hbk::jet::PeerAsync& peer, hbk::jet::matcher_t match, unsigned int shardCount)
+			: m_peer(peer)
+			, m_match(match)
+			, m_hash()
+			, m_shards(std::max(shardCount, 1u))
+			, m_size(0)
+			, m_index(std::make_shared < index_t > ())
+			, m_indexMtx()
+			, m_callbacks(std::make_shared < Callbacks > ())
+			, m_snapshotFile()
+			, m_guard(std::make_shared < CallbackGuard > ())
+			, m_fetchId(0)
+		{
+			addFetch();
+		}
+
+		cache::cache(hbk::jet::PeerAsync& peer, hbk::jet::matcher_t match, const std::string& snapshotFileName, Cb addCb, Cb changeCb, Cb removeCb, unsigned int shardCount)
+			: m_peer(peer)
+			, m_match(match)
+			, m_hash()
+			, m_shards(std::max(shardCount, 1u))
+			, m_size(0)
+			, m_index(std::make_shared < index_t > ())
+			, m_indexMtx()
+			, m_callbacks(std::make_shared < Callbacks > ())
+			, m_snapshotFile()
+			, m_guard(std::make_shared < CallbackGuard > ())
+			, m_fetchId(0)
+		{
+			// restored before the fetch delivers anything
+			setCbs(addCb, changeCb, removeCb);
+			loadSnapshotFile(snapshotFileName);
+			addFetch();
+		}
+
+		cache::~cache()
+		{
+			m_guard->close();
+			m_peer.removeFetchAsync(m_fetchId);
+		}
+
+		void cache::addFetch()
+		{
+			std::weak_ptr < CallbackGuard > weakGuard(m_guard);
+			auto resultCb = [this, weakGuard](const Json::Value& result)
+			{
+				CallbackGuard::call(weakGuard, [this, &result]()
+				{
+					fetchResultCb(result);
+				});
+			};
+			m_fetchId = m_peer.addFetchAsync(m_match, std::bind(&cache::fetchCb, this, std::placeholders::_1, std::placeholders::_2), resultCb);
+		}
+
+		void cache::setCbs(Cb addCb, Cb changeCb, Cb removeCb)
+		{
+			std::shared_ptr < Callbacks > callbacks = std::make_shared < Callbacks > ();
+			callbacks->addCb = addCb;
+			callbacks->changeCb = changeCb;
+			callbacks->removeCb = removeCb;
+			std::atomic_store(&m_callbacks, std::shared_ptr < const Callbacks > (callbacks));
+		}
+
+		size_t cache::findSlot(const slots_t& slots, size_t hash, const std::string& path)
+		{
+			slots_t::const_iterator iter = std::lower_bound(slots.begin(), slots.end(), hash, [](const slotPtr_t& slot, size_t value)
+			{
+				return slot->hash < value;
+			});
+			for (; (iter!=slots.end()) && ((*iter)->hash==hash); ++iter) {
+				if ((*iter)->path==path) {
+					return static_cast < size_t > (iter - slots.begin());
+				}
+			}
+			return slots.size();
+		}
+
+		cache::entryPtr_t cache::find(const std::string& path) const
+		{
+			size_t hash = m_hash(path);
+			snapshot_t slots = std::atomic_load(&m_shards[hash % m_shards.size()].slots);
+			size_t index = findSlot(*slots, hash, path);
+			if (index==slots->size()) {
+				return entryPtr_t();
+			}
+			return loadEntry(*(*slots)[index]);
+		}
+
+		cache::entryPtr_t cache::loadEntry(Slot& slot)
+		{
+			entryPtr_t entry = std::atomic_load(&slot.entry);
+			if ((entry) || (slot.pSnapshotValue==nullptr)) {
+				return entry;
+			}
+
+			Json::Value value;
+			Json::CharReaderBuilder builder;
+			std::unique_ptr < Json::CharReader > reader(builder.newCharReader());
+			std::string errors;
+			if (!reader->parse(slot.pSnapshotValue, slot.pSnapshotValue + slot.snapshotValueLength, &value, &errors)) {
+				::syslog(LOG_ERR, "jet cache: Value of '%s' in snapshot file is invalid (%s)!", slot.path.c_str(), errors.c_str());
+			}
+			entryPtr_t parsed = std::make_shared < Entry > (value, slot.snapshotVersion);
+			// another reader might have been faster
+			if (std::atomic_compare_exchange_strong(&slot.entry, &entry, parsed)) {
+				return parsed;
+			}
+			return entry;
+		}
+
+		Json::Value cache::getEntry(const std::string& path) const
+		{
+			entryPtr_t entry = find(path);
+			if (entry) {
+				return entry->value;
+			}
+			return Json::Value();
+		}
+
+		void cache::forEach(const visitor_t& visitor) const
+		{
+			for (const auto &shard: m_shards) {
+				snapshot_t slots = std::atomic_load(&shard.slots);
+				for (const auto &iter: *slots) {
+					visitor(iter->path, loadEntry(*iter));
+				}
+			}
+		}
+
+		void cache::visitFrom(const std::string& first, const std::function < bool (const std::string& path) >& proceed,
+			const std::function < bool (const std::string& path) >& filter, const visitor_t& visitor) const
+		{
+			indexPtr_t index = std::atomic_load(&m_index);
+			// the last chunk starting before first might contain it
+			index_t::const_iterator chunkIter = std::upper_bound(index->begin(), index->end(), first, [](const std::string& path, const chunkPtr_t& chunk)
+			{
+				return path < chunk->front()->path;
+			});
+			if (chunkIter!=index->begin()) {
+				--chunkIter;
+			}
+			for (; chunkIter!=index->end(); ++chunkIter) {
+				const chunk_t& chunk = **chunkIter;
+				chunk_t::const_iterator slotIter = std::lower_bound(chunk.begin(), chunk.end(), first, [](const slotPtr_t& slot, const std::string& path)
+				{
+					return slot->path < path;
+				});
+				for (; slotIter!=chunk.end(); ++slotIter) {
+					const std::string& path = (*slotIter)->path;
+					if (!proceed(path)) {
+						return;
+					}
+					if (filter(path)) {
+						visitor(path, loadEntry(**slotIter));
+					}
+				}
+			}
+		}
+
+		void cache::forEachWithPrefix(const std::string& prefix, const visitor_t& visitor) const
+		{
+			auto proceed = [&prefix](const std::string& path)
+			{
+				return startsWith(path, prefix);
+			};
+			visitFrom(prefix, proceed, [](const std::string&) { return true; }, visitor);
+		}
+
+		void cache::forEachInRange(const std::string& first, const std::string& last, const visitor_t& visitor) const
+		{
+			auto proceed = [&last](const std::string& path)
+			{
+				return (last.empty()) || (path < last);
+			};
+			visitFrom(first, proceed, [](const std::string&) { return true; }, visitor);
+		}
+
+		void cache::forEachMatching(const std::string& pattern, const visitor_t& visitor) const
+		{
+			// only paths starting with the literal part of the pattern are to be checked
+			std::string prefix = pattern.substr(0, pattern.find_first_of("*?"));
+			auto proceed = [&prefix](const std::string& path)
+			{
+				return startsWith(path, prefix);
+			};
+			auto filter = [&pattern](const std::string& path)
+			{
+				return matchGlob(pattern.c_str(), path.c_str());
+			};
+			visitFrom(prefix, proceed, filter, visitor);
+		}
+
+		void cache::addToIndex(const slotPtr_t& slot)
+		{
+			indexPtr_t index = std::atomic_load(&m_index);
+			std::shared_ptr < index_t > newIndex = std::make_shared < index_t > (*index);
+			if (newIndex->empty()) {
+				newIndex->push_back(std::make_shared < chunk_t > (1, slot));
+				std::atomic_store(&m_index, indexPtr_t(newIndex));
+				return;
+			}
+
+			index_t::iterator chunkIter = std::upper_bound(newIndex->begin(), newIndex->end(), slot->path, [](const std::string& path, const chunkPtr_t& chunk)
+			{
+				return path < chunk->front()->path;
+			});
+			if (chunkIter!=newIndex->begin()) {
+				--chunkIter;
+			}
+			std::shared_ptr < chunk_t > chunk = std::make_shared < chunk_t > ();
+			chunk->reserve((*chunkIter)->size() + 1);
+			chunk_t::const_iterator position = std::lower_bound((*chunkIter)->begin(), (*chunkIter)->end(), slot->path, [](const slotPtr_t& item, const std::string& path)
+			{
+				return item->path < path;
+			});
+			chunk->insert(chunk->end(), (*chunkIter)->begin(), position);
+			chunk->push_back(slot);
+			chunk->insert(chunk->end(), position, (*chunkIter)->end());
+
+			if (chunk->size() > MAX_CHUNK_SIZE) {
+				chunk_t::iterator middle = chunk->begin() + static_cast < std::ptrdiff_t > (chunk->size() / 2);
+				std::shared_ptr < chunk_t > upperChunk = std::make_shared < chunk_t > (middle, chunk->end());
+				chunk->erase(middle, chunk->end());
+				*chunkIter = chunk;
+				newIndex->insert(chunkIter + 1, upperChunk);
+			} else {
+				*chunkIter = chunk;
+			}
+			std::atomic_store(&m_index, indexPtr_t(newIndex));
+		}
+
+		void cache::removeFromIndex(const std::string& path)
+		{
+			indexPtr_t index = std::atomic_load(&m_index);
+			index_t::const_iterator chunkIter = std::upper_bound(index->begin(), index->end(), path, [](const std::string& value, const chunkPtr_t& chunk)
+			{
+				return value < chunk->front()->path;
+			});
+			if (chunkIter==index->begin()) {
+				return;
+			}
+			--chunkIter;
+			const chunk_t& chunk = **chunkIter;
+			chunk_t::const_iterator position = std::lower_bound(chunk.begin(), chunk.end(), path, [](const slotPtr_t& item, const std::string& value)
+			{
+				return item->path < value;
+			});
+			if ((position==chunk.end()) || ((*position)->path!=path)) {
+				return;
+			}
+
+			std::shared_ptr < index_t > newIndex = std::make_shared < index_t > (*index);
+			index_t::iterator newChunkIter = newIndex->begin() + (chunkIter - index->begin());
+			if (chunk.size()==1) {
+				newIndex->erase(newChunkIter);
+			} else {
+				std::shared_ptr < chunk_t > newChunk = std::make_shared < chunk_t > ();
+				newChunk->reserve(chunk.size() - 1);
+				newChunk->insert(newChunk->end(), chunk.begin(), position);
+				newChunk->insert(newChunk->end(), position + 1, chunk.end());
+				*newChunkIter = newChunk;
+			}
+			std::atomic_store(&m_index, indexPtr_t(newIndex));
+		}
+
+		size_t cache::size() const
+		{
+			return m_size;
+		}
+
+		cache::updateResult_t cache::update(const std::string& path, const Json::Value& value)
+		{
+			size_t hash = m_hash(path);
+			Shard& shard = m_shards[hash % m_shards.size()];
+			std::lock_guard < std::mutex > lock(shard.writeMtx);
+			snapshot_t slots = std::atomic_load(&shard.slots);
+			size_t index = findSlot(*slots, hash, path);
+			if (index!=slots->size()) {
+				// the snapshot stays as it is, only the entry is replaced
+				const slotPtr_t& slot = (*slots)[index];
+				if (!slot->confirmed) {
+					slot->confirmed = true;
+					std::string serialized = Json::writeString(snapshotWriterBuilder, value);
+					if ((serialized.length()==slot->snapshotValueLength) && (std::memcmp(serialized.data(), slot->pSnapshotValue, serialized.length())==0)) {
+						return CONFIRMED;
+					}
+				}
+				entryPtr_t entry = std::atomic_load(&slot->entry);
+				uint64_t version = entry ? entry->version : slot->snapshotVersion;
+				std::atomic_store(&slot->entry, entryPtr_t(std::make_shared < Entry > (value, version + 1)));
+				return CHANGED;
+			}
+
+			std::shared_ptr < slots_t > newSlots = std::make_shared < slots_t > ();
+			newSlots->reserve(slots->size() + 1);
+			slots_t::const_iterator position = std::upper_bound(slots->begin(), slots->end(), hash, [](size_t value, const slotPtr_t& slot)
+			{
+				return value < slot->hash;
+			});
+			newSlots->insert(newSlots->end(), slots->begin(), position);
+			slotPtr_t slot = std::make_shared < Slot > (path, hash, std::make_shared < Entry > (value, 1));
+			newSlots->push_back(slot);
+			newSlots->insert(newSlots->end(), position, slots->end());
+			std::atomic_store(&shard.slots, snapshot_t(newSlots));
+			{
+				std::lock_guard < std::mutex > indexLock(m_indexMtx);
+				addToIndex(slot);
+			}
+			++m_size;
+			return ADDED;
+		}
+
+		bool cache::remove(const std::string& path)
+		{
+			size_t hash = m_hash(path);
+			Shard& shard = m_shards[hash % m_shards.size()];
+			std::lock_guard < std::mutex > lock(shard.writeMtx);
+			snapshot_t slots = std::atomic_load(&shard.slots);
+			size_t index = findSlot(*slots, hash, path);
+			if (index==slots->size()) {
+				return false;
+			}
+			std::shared_ptr < slots_t > newSlots = std::make_shared < slots_t > ();
+			newSlots->reserve(slots->size() - 1);
+			newSlots->insert(newSlots->end(), slots->begin(), slots->begin() + static_cast < std::ptrdiff_t > (index));
+			newSlots->insert(newSlots->end(), slots->begin() + static_cast < std::ptrdiff_t > (index) + 1, slots->end());
+			std::atomic_store(&shard.slots, snapshot_t(newSlots));
+			{
+				std::lock_guard < std::mutex > indexLock(m_indexMtx);
+				removeFromIndex(path);
+			}
+			--m_size;
+			return true;
+		}
+
+		void cache::clear()
+		{
+			for (auto &shard: m_shards) {
+				std::lock_guard < std::mutex > lock(shard.writeMtx);
+				snapshot_t slots = std::atomic_load(&shard.slots);
+				m_size -= slots->size();
+				std::atomic_store(&shard.slots, snapshot_t(std::make_shared < slots_t > ()));
+			}
+			std::lock_guard < std::mutex > indexLock(m_indexMtx);
+			std::atomic_store(&m_index, indexPtr_t(std::make_shared < index_t > ()));
+		}
+
+		void cache::fetchCb( const Json::Value& params, int status)
+		{
+			if(status < 0) {
+				// Elements removed meanwhile won't be notified. All elements are notified again when the fetch gets restored.
+				::syslog(LOG_WARNING, "jet cache '%s': Lost connection to jet daemon!", m_match.print().c_str());
+				clear();
+				return;
+			}
+			if(!params.isObject()) {
+				return;
+			}
+
+			const std::string event = params[hbk::jet::EVENT].asString();
+			const std::string path = params[hbk::jet::PATH].asString();
+			const Json::Value& value = params[hbk::jet::VALUE];
+			std::shared_ptr < const Callbacks > callbacks = std::atomic_load(&m_callbacks);
+			if ((event==hbk::jet::CHANGE) || (event==hbk::jet::ADD)) {
+				updateResult_t result = update(path, value);
+				if (result==CONFIRMED) {
+					return;
+				}
+				const Cb& cb = (result==ADDED) ? callbacks->addCb : callbacks->changeCb;
+				if (cb) {
+					cb(path, value);
+				}
+			} else if (event==hbk::jet::REMOVE) {
+				remove(path);
+				if (callbacks->removeCb) {
+					callbacks->removeCb(path, value);
+				}
+			}
+		}
+	
+		void cache::fetchResultCb(const Json::Value& result)
+		{
+			if (result.isMember(jsonrpc::ERR)) {
+				::syslog(LOG_ERR, "jet cache '%s': Fetch failed!", m_match.print().c_str());
+				return;
+			}
+			// all matching elements got notified before the response
+			if (m_snapshotFile) {
+				removeUnconfirmed();
+			}
+		}
+
+		void cache::removeUnconfirmed()
+		{
+			std::vector < slotPtr_t > unconfirmed;
+			indexPtr_t index = std::atomic_load(&m_index);
+			for (const auto &chunk: *index) {
+				for (const auto &slot: *chunk) {
+					if (!slot->confirmed) {
+						unconfirmed.push_back(slot);
+					}
+				}
+			}
+
+			std::shared_ptr < const Callbacks > callbacks = std::atomic_load(&m_callbacks);
+			for (const auto &slot: unconfirmed) {
+				if (remove(slot->path)) {
+					if (callbacks->removeCb) {
+						callbacks->removeCb(slot->path, loadEntry(*slot)->value);
+					}
+				}
+			}
+		}
+
+		int cache::loadSnapshotFile(const std::string& fileName)
+		{
+			std::shared_ptr < MappedFile > file = std::make_shared < MappedFile > ();
+			if (file->open(fileName) < 0) {
+				::syslog(LOG_WARNING, "jet cache: Could not open snapshot file '%s'!", fileName.c_str());
+				return -1;
+			}
+			const char* pData = file->data();
+			const size_t size = file->size();
+			if ((size < SNAPSHOT_HEADER_SIZE)
+				|| (std::memcmp(pData, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC))!=0)
+				|| (readNumber < uint32_t > (pData + sizeof(SNAPSHOT_MAGIC))!=SNAPSHOT_FORMAT)
+				|| (readNumber < uint32_t > (pData + sizeof(SNAPSHOT_MAGIC) + sizeof(uint32_t))!=SNAPSHOT_BYTE_ORDER_MARK)) {
+				::syslog(LOG_ERR, "jet cache: '%s' is no snapshot file of this format!", fileName.c_str());
+				return -1;
+			}
+			uint64_t entryCount = readNumber < uint64_t > (pData + sizeof(SNAPSHOT_MAGIC) + 2 * sizeof(uint32_t));
+
+			// sorted by path as written
+			std::vector < slotPtr_t > slots;
+			size_t pos = SNAPSHOT_HEADER_SIZE;
+			for (uint64_t count = 0; count < entryCount; ++count) {
+				if (size - pos < SNAPSHOT_ENTRY_HEADER_SIZE) {
+					break;
+				}
+				size_t pathLength = readNumber < uint32_t > (pData + pos);
+				size_t valueLength = readNumber < uint32_t > (pData + pos + sizeof(uint32_t));
+				uint64_t version = readNumber < uint64_t > (pData + pos + 2 * sizeof(uint32_t));
+				pos += SNAPSHOT_ENTRY_HEADER_SIZE;
+				if (size - pos < pathLength + valueLength) {
+					break;
+				}
+				std::string path(pData + pos, pathLength);
+				pos += pathLength;
+				if ((!slots.empty()) && (!(slots.back()->path < path))) {
+					break;
+				}
+				slots.push_back(std::make_shared < Slot > (path, m_hash(path), pData + pos, valueLength, version));
+				pos += valueLength;
+			}
+			if ((slots.size()!=entryCount) || (pos!=size)) {
+				::syslog(LOG_ERR, "jet cache: Snapshot file '%s' is corrupted!", fileName.c_str());
+				return -1;
+			}
+
+			// Nobody else accesses the cache yet. Shards and index are composed at once.
+			std::vector < std::shared_ptr < slots_t > > shards(m_shards.size());
+			for (auto &iter: shards) {
+				iter = std::make_shared < slots_t > ();
+			}
+			for (const auto &slot: slots) {
+				shards[slot->hash % shards.size()]->push_back(slot);
+			}
+			for (size_t shardIndex = 0; shardIndex < shards.size(); ++shardIndex) {
+				std::stable_sort(shards[shardIndex]->begin(), shards[shardIndex]->end(), [](const slotPtr_t& lhs, const slotPtr_t& rhs)
+				{
+					return lhs->hash < rhs->hash;
+				});
+				std::atomic_store(&m_shards[shardIndex].slots, snapshot_t(shards[shardIndex]));
+			}
+
+			// half filled chunks leave room for adding
+			std::shared_ptr < index_t > index = std::make_shared < index_t > ();
+			for (size_t first = 0; first < slots.size(); first += MAX_CHUNK_SIZE / 2) {
+				size_t last = std::min(first + MAX_CHUNK_SIZE / 2, slots.size());
+				index->push_back(std::make_shared < chunk_t > (slots.begin() + static_cast < std::ptrdiff_t > (first), slots.begin() + static_cast < std::ptrdiff_t > (last)));
+			}
+			std::atomic_store(&m_index, indexPtr_t(index));
+			m_size = slots.size();
+			m_snapshotFile = file;
+			return 0;
+		}
+
+		int cache::saveSnapshotFile(const std::string& fileName) const
+		{
+			std::string tempFileName = fileName + ".tmp";
+			{
+				std::ofstream file(tempFileName, std::ios::binary | std::ios::trunc);
+				if (!file) {
+					::syslog(LOG_ERR, "jet cache: Could not create snapshot file '%s'!", tempFileName.c_str());
+					return -1;
+				}
+
+				// the number of entries is known after visiting them
+				std::vector < std::pair < const Slot*, entryPtr_t > > entries;
+				indexPtr_t index = std::atomic_load(&m_index);
+				for (const auto &chunk: *index) {
+					for (const auto &slot: *chunk) {
+						entries.push_back(std::make_pair(slot.get(), loadEntry(*slot)));
+					}
+				}
+
+				file.write(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+				writeNumber < uint32_t > (file, SNAPSHOT_FORMAT);
+				writeNumber < uint32_t > (file, SNAPSHOT_BYTE_ORDER_MARK);
+				writeNumber < uint64_t > (file, entries.size());
+				for (const auto &iter: entries) {
+					const std::string& path = iter.first->path;
+					std::string value = Json::writeString(snapshotWriterBuilder, iter.second->value);
+					writeNumber < uint32_t > (file, static_cast < uint32_t > (path.length()));
+					writeNumber < uint32_t > (file, static_cast < uint32_t > (value.length()));
+					writeNumber < uint64_t > (file, iter.second->version);
+					file.write(path.c_str(), static_cast < std::streamsize > (path.length()));
+					file.write(value.c_str(), static_cast < std::streamsize > (value.length()));
+				}
+				file.close();
+				if (!file) {
+					::syslog(LOG_ERR, "jet cache: Could not write snapshot file '%s'!", tempFileName.c_str());
+					std::remove(tempFileName.c_str());
+					return -1;
+				}
+			}
+#ifdef _WIN32
+			// std::rename does not replace an existing file on windows
+			if (!MoveFileExA(tempFileName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+#else
+			if (std::rename(tempFileName.c_str(), fileName.c_str())!=0) {
+#endif
+				::syslog(LOG_ERR, "jet cache: Could not rename '%s' to '%s'!", tempFileName.c_str(), fileName.c_str());
+				std::remove(tempFileName.c_str());
+				return -1;
+			}
+			return 0;
+		}
+	}
+}
@@ -0,0 +1,79 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef __HBK_JET_CALLBACKGUARD_H
+#define __HBK_JET_CALLBACKGUARD_H
+
+#include <memory>
+#include <mutex>
+
+namespace hbk
+{
+	namespace jet
+	{
+		/// Lets response callbacks reach an object that might be destroyed before the response arrives.
+		///
+		/// The object owns the guard, the callbacks hold a weak pointer to it. The destructor of the object closes the guard.
+		/// Calls through a closed guard are dropped. Closing waits for a call being executed right now.
+		/// \warning An object may not be destroyed from within a call through its own guard.
+		class CallbackGuard
+		{
+		public:
+			CallbackGuard()
+				: m_open(true)
+				, m_mtx()
+			{
+			}
+			CallbackGuard(const CallbackGuard&) = delete;
+			CallbackGuard& operator=(const CallbackGuard&) = delete;
+
+			/// \return true if function got called, false if the guard is gone or closed
+			template < typename Function >
+			static bool call(const std::weak_ptr < CallbackGuard >& weakGuard, Function function)
+			{
+				std::shared_ptr < CallbackGuard > guard = weakGuard.lock();
+				if (!guard) {
+					return false;
+				}
+				std::lock_guard < std::mutex > lock(guard->m_mtx);
+				if (!guard->m_open) {
+					return false;
+				}
+				function();
+				return true;
+			}
+
+			void close()
+			{
+				std::lock_guard < std::mutex > lock(m_mtx);
+				m_open = false;
+			}
+
+		private:
+			bool m_open;
+			std::mutex m_mtx;
+		};
+	}
+}
+#endif
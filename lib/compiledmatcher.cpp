@@ -0,0 +1,394 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define JET_MATCHER_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#include "jet/compiledmatcher.hpp"
+
+namespace hbk
+{
+	namespace jet
+	{
+		/// path folded to lower case. Short paths are folded into a buffer on the stack.
+		class FoldedPath
+		{
+		public:
+			FoldedPath()
+				: m_pText(m_buffer)
+				, m_heap()
+			{
+			}
+
+			FoldedPath(const FoldedPath&) = delete;
+			FoldedPath& operator=(const FoldedPath&) = delete;
+
+			const char* fold(const char* pPath, size_t length)
+			{
+				if (length > sizeof(m_buffer)) {
+					m_heap.resize(length);
+					m_pText = &m_heap[0];
+				}
+				CompiledMatcher::foldCase(pPath, length, m_pText);
+				return m_pText;
+			}
+
+		private:
+			char m_buffer[256];
+			char* m_pText;
+			std::string m_heap;
+		};
+
+		static inline char foldCharacter(char character)
+		{
+			return ((character >= 'A') && (character <= 'Z')) ? static_cast < char > (character + ('a' - 'A')) : character;
+		}
+
+		static inline bool equals(const char* pText, size_t length, const std::string& text)
+		{
+			return (length==text.length()) && (std::memcmp(pText, text.c_str(), length)==0);
+		}
+
+#ifdef JET_MATCHER_SSE2
+		static inline unsigned int countTrailingZeros(unsigned int mask)
+		{
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanForward(&index, mask);
+			return static_cast < unsigned int > (index);
+#else
+			return static_cast < unsigned int > (__builtin_ctz(mask));
+#endif
+		}
+#endif
+
+		void CompiledMatcher::foldCase(const char* pText, size_t length, char* pFolded)
+		{
+			size_t pos = 0;
+#ifdef JET_MATCHER_SSE2
+			// 'A' - 1 and 'Z' + 1 as signed bytes. Bytes >= 0x80 are negative and stay as they are.
+			const __m128i beforeA = _mm_set1_epi8('A' - 1);
+			const __m128i afterZ = _mm_set1_epi8('Z' + 1);
+			const __m128i caseBit = _mm_set1_epi8('a' - 'A');
+			for (; pos + 16 <= length; pos += 16) {
+				__m128i block = _mm_loadu_si128(reinterpret_cast < const __m128i* > (pText + pos));
+				__m128i isUpper = _mm_and_si128(_mm_cmpgt_epi8(block, beforeA), _mm_cmplt_epi8(block, afterZ));
+				block = _mm_or_si128(block, _mm_and_si128(isUpper, caseBit));
+				_mm_storeu_si128(reinterpret_cast < __m128i* > (pFolded + pos), block);
+			}
+#endif
+			for (; pos < length; ++pos) {
+				pFolded[pos] = foldCharacter(pText[pos]);
+			}
+		}
+
+		std::string CompiledMatcher::foldCase(const std::string& text)
+		{
+			std::string folded(text);
+			if (!folded.empty()) {
+				foldCase(text.c_str(), text.length(), &folded[0]);
+			}
+			return folded;
+		}
+
+		bool CompiledMatcher::startsWith(const char* pText, size_t length, const std::string& prefix)
+		{
+			return (length >= prefix.length()) && (std::memcmp(pText, prefix.c_str(), prefix.length())==0);
+		}
+
+		bool CompiledMatcher::endsWith(const char* pText, size_t length, const std::string& suffix)
+		{
+			return (length >= suffix.length()) && (std::memcmp(pText + length - suffix.length(), suffix.c_str(), suffix.length())==0);
+		}
+
+		bool CompiledMatcher::contains(const char* pText, size_t length, const std::string& needle)
+		{
+			const size_t needleLength = needle.length();
+			if (needleLength==0) {
+				return true;
+			}
+			if (needleLength > length) {
+				return false;
+			}
+			const char* pNeedle = needle.c_str();
+			if (needleLength==1) {
+				return std::memchr(pText, pNeedle[0], length)!=nullptr;
+			}
+
+			size_t pos = 0;
+			const size_t lastPos = length - needleLength;
+#ifdef JET_MATCHER_SSE2
+			// Compare the first and the last character of the needle at 16 positions at once.
+			// Only the positions where both fit are compared completely.
+			const __m128i first = _mm_set1_epi8(pNeedle[0]);
+			const __m128i last = _mm_set1_epi8(pNeedle[needleLength - 1]);
+			for (; pos + 16 <= lastPos + 1; pos += 16) {
+				__m128i blockFirst = _mm_loadu_si128(reinterpret_cast < const __m128i* > (pText + pos));
+				__m128i blockLast = _mm_loadu_si128(reinterpret_cast < const __m128i* > (pText + pos + needleLength - 1));
+				unsigned int mask = static_cast < unsigned int > (_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, blockFirst), _mm_cmpeq_epi8(last, blockLast))));
+				while (mask!=0) {
+					unsigned int bit = countTrailingZeros(mask);
+					if (std::memcmp(pText + pos + bit + 1, pNeedle + 1, needleLength - 2)==0) {
+						return true;
+					}
+					mask &= mask - 1;
+				}
+			}
+#endif
+			// remaining positions
+			while (pos <= lastPos) {
+				const void* pCandidate = std::memchr(pText + pos, pNeedle[0], lastPos - pos + 1);
+				if (pCandidate==nullptr) {
+					return false;
+				}
+				pos = static_cast < size_t > (static_cast < const char* > (pCandidate) - pText);
+				if (std::memcmp(pText + pos + 1, pNeedle + 1, needleLength - 1)==0) {
+					return true;
+				}
+				++pos;
+			}
+			return false;
+		}
+
+		CompiledMatcher::CompiledMatcher()
+			: m_matcher()
+			, m_contains()
+			, m_startsWith()
+			, m_endsWith()
+			, m_equals()
+			, m_equalsNot()
+			, m_containsAllOf()
+		{
+		}
+
+		CompiledMatcher::CompiledMatcher(const matcher_t& matcher)
+			: m_matcher(matcher)
+			, m_contains(matcher.contains)
+			, m_startsWith(matcher.startsWith)
+			, m_endsWith(matcher.endsWith)
+			, m_equals(matcher.equals)
+			, m_equalsNot(matcher.equalsNot)
+			, m_containsAllOf()
+		{
+			for (const auto &iter: matcher.containsAllOf) {
+				if (!iter.empty()) {
+					m_containsAllOf.push_back(iter);
+				}
+			}
+			if (matcher.caseInsensitive) {
+				m_contains = foldCase(m_contains);
+				m_startsWith = foldCase(m_startsWith);
+				m_endsWith = foldCase(m_endsWith);
+				m_equals = foldCase(m_equals);
+				m_equalsNot = foldCase(m_equalsNot);
+				for (auto &iter: m_containsAllOf) {
+					iter = foldCase(iter);
+				}
+			}
+			// long needles are less likely to be found. Those reject a path early.
+			std::sort(m_containsAllOf.begin(), m_containsAllOf.end(), [](const std::string& lhs, const std::string& rhs)
+			{
+				return lhs.length() > rhs.length();
+			});
+		}
+
+		bool CompiledMatcher::match(const std::string& path) const
+		{
+			return match(path.c_str(), path.length());
+		}
+
+		bool CompiledMatcher::match(const char* pPath, size_t length) const
+		{
+			if (!m_matcher.caseInsensitive) {
+				return matchPrepared(pPath, length);
+			}
+			FoldedPath foldedPath;
+			return matchPrepared(foldedPath.fold(pPath, length), length);
+		}
+
+		bool CompiledMatcher::matchPrepared(const char* pPath, size_t length) const
+		{
+			// cheapest conditions first
+			if ((!m_equals.empty()) && (!equals(pPath, length, m_equals))) {
+				return false;
+			}
+			if ((!m_equalsNot.empty()) && (equals(pPath, length, m_equalsNot))) {
+				return false;
+			}
+			if ((!m_startsWith.empty()) && (!startsWith(pPath, length, m_startsWith))) {
+				return false;
+			}
+			if ((!m_endsWith.empty()) && (!endsWith(pPath, length, m_endsWith))) {
+				return false;
+			}
+			if ((!m_contains.empty()) && (!contains(pPath, length, m_contains))) {
+				return false;
+			}
+			for (const auto &iter: m_containsAllOf) {
+				if (!contains(pPath, length, iter)) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		MatcherSet::MatcherSet()
+			: m_caseSensitiveEquals()
+			, m_caseInsensitiveEquals()
+			, m_caseSensitive()
+			, m_caseInsensitive()
+			, m_matchers()
+		{
+		}
+
+		size_t MatcherSet::add(const matcher_t& matcher)
+		{
+			size_t index = m_matchers.size();
+			m_matchers.push_back(CompiledMatcher(matcher));
+			const CompiledMatcher& compiled = m_matchers.back();
+			if (matcher.caseInsensitive) {
+				if (compiled.m_equals.empty()) {
+					m_caseInsensitive.push_back(index);
+				} else {
+					m_caseInsensitiveEquals[compiled.m_equals].push_back(index);
+				}
+			} else {
+				if (compiled.m_equals.empty()) {
+					m_caseSensitive.push_back(index);
+				} else {
+					m_caseSensitiveEquals[compiled.m_equals].push_back(index);
+				}
+			}
+			return index;
+		}
+
+		void MatcherSet::clear()
+		{
+			m_caseSensitiveEquals.clear();
+			m_caseInsensitiveEquals.clear();
+			m_caseSensitive.clear();
+			m_caseInsensitive.clear();
+			m_matchers.clear();
+		}
+
+		void MatcherSet::match(const std::string& path, std::vector < size_t >& matches) const
+		{
+			matches.clear();
+			const char* pPath = path.c_str();
+			size_t length = path.length();
+
+			for (size_t index: m_caseSensitive) {
+				if (m_matchers[index].matchPrepared(pPath, length)) {
+					matches.push_back(index);
+				}
+			}
+			if (!m_caseSensitiveEquals.empty()) {
+				equalsIndex_t::const_iterator iter = m_caseSensitiveEquals.find(path);
+				if (iter!=m_caseSensitiveEquals.end()) {
+					for (size_t index: iter->second) {
+						if (m_matchers[index].matchPrepared(pPath, length)) {
+							matches.push_back(index);
+						}
+					}
+				}
+			}
+
+			if ((!m_caseInsensitive.empty()) || (!m_caseInsensitiveEquals.empty())) {
+				FoldedPath foldedPath;
+				const char* pFolded = foldedPath.fold(pPath, length);
+				for (size_t index: m_caseInsensitive) {
+					if (m_matchers[index].matchPrepared(pFolded, length)) {
+						matches.push_back(index);
+					}
+				}
+				if (!m_caseInsensitiveEquals.empty()) {
+					equalsIndex_t::const_iterator iter = m_caseInsensitiveEquals.find(std::string(pFolded, length));
+					if (iter!=m_caseInsensitiveEquals.end()) {
+						for (size_t index: iter->second) {
+							if (m_matchers[index].matchPrepared(pFolded, length)) {
+								matches.push_back(index);
+							}
+						}
+					}
+				}
+			}
+			std::sort(matches.begin(), matches.end());
+		}
+
+		bool MatcherSet::matchAny(const std::string& path) const
+		{
+			const char* pPath = path.c_str();
+			size_t length = path.length();
+			if (!m_caseSensitiveEquals.empty()) {
+				equalsIndex_t::const_iterator iter = m_caseSensitiveEquals.find(path);
+				if (iter!=m_caseSensitiveEquals.end()) {
+					// the other conditions of those might still fail
+					for (size_t index: iter->second) {
+						if (m_matchers[index].matchPrepared(pPath, length)) {
+							return true;
+						}
+					}
+				}
+			}
+			for (size_t index: m_caseSensitive) {
+				if (m_matchers[index].matchPrepared(pPath, length)) {
+					return true;
+				}
+			}
+			if ((m_caseInsensitive.empty()) && (m_caseInsensitiveEquals.empty())) {
+				return false;
+			}
+
+			FoldedPath foldedPath;
+			const char* pFolded = foldedPath.fold(pPath, length);
+			if (!m_caseInsensitiveEquals.empty()) {
+				equalsIndex_t::const_iterator iter = m_caseInsensitiveEquals.find(std::string(pFolded, length));
+				if (iter!=m_caseInsensitiveEquals.end()) {
+					for (size_t index: iter->second) {
+						if (m_matchers[index].matchPrepared(pFolded, length)) {
+							return true;
+						}
+					}
+				}
+			}
+			for (size_t index: m_caseInsensitive) {
+				if (m_matchers[index].matchPrepared(pFolded, length)) {
+					return true;
+				}
+			}
+			return false;
+		}
+	}
+}
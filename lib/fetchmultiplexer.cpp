@@ -0,0 +1,318 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define syslog fprintf
+#define LOG_ERR stderr
+#else
+#include "syslog.h"
+#endif
+
+#include "hbk/jsonrpc/jsonrpc_defines.h"
+
+#include "jet/fetchmultiplexer.hpp"
+
+#include "callbackguard.h"
+
+namespace hbk
+{
+	namespace jet
+	{
+		/// \return true if one of the parts contains the needle
+		static bool isContained(const std::vector < std::string >& parts, const std::string& needle)
+		{
+			for (const auto &iter: parts) {
+				if (CompiledMatcher::contains(iter.data(), iter.length(), needle)) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		FetchMultiplexer::Subscription::Subscription(subscriptionId_t subscriptionId, const matcher_t& match, fetchCallback_t cb)
+			: id(subscriptionId)
+			, matcher(match)
+			, callback(std::move(cb))
+		{
+		}
+
+		FetchMultiplexer::Upstream::Upstream(const matcher_t& match)
+			: matcher(match)
+			, fetchId(0)
+			, subscriptions(std::make_shared < SubscriptionList > ())
+			, elements()
+		{
+		}
+
+		FetchMultiplexer::subscriptions_t FetchMultiplexer::makeSubscriptionList(std::vector < subscriptionPtr_t > subscriptions)
+		{
+			std::shared_ptr < SubscriptionList > list = std::make_shared < SubscriptionList > ();
+			for (const auto &iter: subscriptions) {
+				list->matchers.add(iter->matcher.getMatcher());
+			}
+			list->subscriptions = std::move(subscriptions);
+			return list;
+		}
+
+		FetchMultiplexer::FetchMultiplexer(PeerAsync& peer)
+			: m_peer(peer)
+			, m_upstreams()
+			, m_subscriptions()
+			, m_lastSubscriptionId(0)
+			, m_guard(std::make_shared < CallbackGuard > ())
+			, m_mtx()
+		{
+		}
+
+		FetchMultiplexer::~FetchMultiplexer()
+		{
+			m_guard->close();
+			std::lock_guard < std::recursive_mutex > lock(m_mtx);
+			for (const auto &iter: m_upstreams) {
+				try {
+					m_peer.removeFetchAsync(iter->fetchId);
+				} catch(...) {
+					// the connection might be gone already
+				}
+			}
+		}
+
+		bool FetchMultiplexer::covers(const matcher_t& outer, const matcher_t& inner)
+		{
+			if ((inner.caseInsensitive) && (!outer.caseInsensitive)) {
+				return false;
+			}
+			// Conditions of outer are evaluated on the strings each path matching inner is known to have.
+			// If outer is case insensitive, those are folded.
+			bool fold = outer.caseInsensitive;
+			// folded the same way as by CompiledMatcher, ASCII only
+			auto foldCase = [fold](const std::string& text)
+			{
+				return fold ? CompiledMatcher::foldCase(text) : text;
+			};
+			std::string equals = foldCase(inner.equals);
+			std::string prefix = equals.empty() ? foldCase(inner.startsWith) : equals;
+			std::string suffix = equals.empty() ? foldCase(inner.endsWith) : equals;
+			std::vector < std::string > parts;
+			parts.push_back(prefix);
+			parts.push_back(suffix);
+			parts.push_back(foldCase(inner.contains));
+			for (const auto &iter: inner.containsAllOf) {
+				parts.push_back(foldCase(iter));
+			}
+
+			if (!outer.equals.empty()) {
+				if ((equals.empty()) || (equals!=foldCase(outer.equals))) {
+					return false;
+				}
+			}
+			if (!outer.startsWith.empty()) {
+				if (!CompiledMatcher::startsWith(prefix.data(), prefix.length(), foldCase(outer.startsWith))) {
+					return false;
+				}
+			}
+			if (!outer.endsWith.empty()) {
+				if (!CompiledMatcher::endsWith(suffix.data(), suffix.length(), foldCase(outer.endsWith))) {
+					return false;
+				}
+			}
+			if (!outer.contains.empty()) {
+				if (!isContained(parts, foldCase(outer.contains))) {
+					return false;
+				}
+			}
+			for (const auto &iter: outer.containsAllOf) {
+				if ((!iter.empty()) && (!isContained(parts, foldCase(iter)))) {
+					return false;
+				}
+			}
+			if (!outer.equalsNot.empty()) {
+				if (!equals.empty()) {
+					if (equals==foldCase(outer.equalsNot)) {
+						return false;
+					}
+				} else if ((inner.caseInsensitive!=outer.caseInsensitive) || (inner.equalsNot.empty()) || (foldCase(inner.equalsNot)!=foldCase(outer.equalsNot))) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		FetchMultiplexer::upstreamPtr_t FetchMultiplexer::findUpstream(const matcher_t& match) const
+		{
+			for (const auto &iter: m_upstreams) {
+				if (covers(iter->matcher, match)) {
+					return iter;
+				}
+			}
+			return upstreamPtr_t();
+		}
+
+		FetchMultiplexer::subscriptionId_t FetchMultiplexer::subscribe(const matcher_t& match, fetchCallback_t callback)
+		{
+			std::lock_guard < std::recursive_mutex > lock(m_mtx);
+			do {
+				++m_lastSubscriptionId;
+			} while ((m_lastSubscriptionId==0) || (m_subscriptions.find(m_lastSubscriptionId)!=m_subscriptions.end()));
+			subscriptionPtr_t subscription = std::make_shared < Subscription > (m_lastSubscriptionId, match, std::move(callback));
+
+			upstreamPtr_t upstream = findUpstream(match);
+			if (upstream) {
+				// The elements known so far are notified to the new subscription only.
+				// Notifications of the daemon wait until we are done.
+				for (const auto &iter: upstream->elements) {
+					if (subscription->matcher.match(iter.first)) {
+						Json::Value notification = iter.second;
+						notification[EVENT] = ADD;
+						callSubscription(*subscription, notification, 0);
+					}
+				}
+			} else {
+				upstream = std::make_shared < Upstream > (match);
+				std::weak_ptr < Upstream > weakUpstream(upstream);
+				auto fetchCb = [this, weakUpstream](const Json::Value& notification, int status)
+				{
+					notify(weakUpstream, notification, status);
+				};
+				std::weak_ptr < CallbackGuard > weakGuard(m_guard);
+				auto resultCb = [this, weakUpstream, weakGuard](const Json::Value& result)
+				{
+					if (result.isMember(jsonrpc::ERR)) {
+						CallbackGuard::call(weakGuard, [this, &weakUpstream, &result]()
+						{
+							notify(weakUpstream, result, -1);
+						});
+					}
+				};
+				upstream->fetchId = m_peer.addFetchAsync(match, fetchCb, resultCb);
+				m_upstreams.push_back(upstream);
+			}
+
+			std::vector < subscriptionPtr_t > subscriptions = upstream->subscriptions->subscriptions;
+			subscriptions.push_back(subscription);
+			upstream->subscriptions = makeSubscriptionList(std::move(subscriptions));
+			m_subscriptions[subscription->id] = upstream;
+			return subscription->id;
+		}
+
+		int FetchMultiplexer::unsubscribe(subscriptionId_t subscriptionId)
+		{
+			std::lock_guard < std::recursive_mutex > lock(m_mtx);
+			auto subscriptionIter = m_subscriptions.find(subscriptionId);
+			if (subscriptionIter==m_subscriptions.end()) {
+				return -1;
+			}
+			upstreamPtr_t upstream = subscriptionIter->second;
+			m_subscriptions.erase(subscriptionIter);
+
+			std::vector < subscriptionPtr_t > subscriptions = upstream->subscriptions->subscriptions;
+			subscriptions.erase(std::remove_if(subscriptions.begin(), subscriptions.end(), [subscriptionId](const subscriptionPtr_t& subscription)
+			{
+				return subscription->id==subscriptionId;
+			}), subscriptions.end());
+			upstream->subscriptions = makeSubscriptionList(std::move(subscriptions));
+			if (upstream->subscriptions->subscriptions.empty()) {
+				eraseUpstream(upstream);
+				m_peer.removeFetchAsync(upstream->fetchId);
+			}
+			return 0;
+		}
+
+		void FetchMultiplexer::eraseUpstream(const upstreamPtr_t& upstream)
+		{
+			for (const auto &iter: upstream->subscriptions->subscriptions) {
+				m_subscriptions.erase(iter->id);
+			}
+			m_upstreams.erase(std::remove(m_upstreams.begin(), m_upstreams.end(), upstream), m_upstreams.end());
+		}
+
+		void FetchMultiplexer::notify(const std::weak_ptr < Upstream >& weakUpstream, const Json::Value& notification, int status)
+		{
+			std::lock_guard < std::recursive_mutex > lock(m_mtx);
+			upstreamPtr_t upstream = weakUpstream.lock();
+			if (!upstream) {
+				return;
+			}
+			subscriptions_t subscriptions = upstream->subscriptions;
+
+			if (status < 0) {
+				// The daemon notifies all elements again after reconnecting
+				upstream->elements.clear();
+				if (notification.isMember(jsonrpc::ERR)) {
+					// the daemon fetch is gone for good, so are its subscriptions
+					::syslog(LOG_ERR, "jet fetch multiplexer: fetch '%s' failed!", upstream->matcher.print().c_str());
+					eraseUpstream(upstream);
+				}
+				for (const auto &iter: subscriptions->subscriptions) {
+					callSubscription(*iter, notification, status);
+				}
+				return;
+			}
+
+			const std::string path = notification[PATH].asString();
+			if (notification[EVENT].asString()==REMOVE) {
+				upstream->elements.erase(path);
+			} else {
+				upstream->elements[path] = notification;
+			}
+			std::vector < size_t > matches;
+			subscriptions->matchers.match(path, matches);
+			for (size_t index: matches) {
+				callSubscription(*subscriptions->subscriptions[index], notification, status);
+			}
+		}
+
+		void FetchMultiplexer::callSubscription(const Subscription& subscription, const Json::Value& notification, int status)
+		{
+			try {
+				subscription.callback(notification, status);
+			} catch(const std::runtime_error &e) {
+				::syslog(LOG_ERR, "Subscription callback '%s' threw exception '%s'!", subscription.matcher.getMatcher().print().c_str(), e.what());
+			} catch(...) {
+				::syslog(LOG_ERR, "Subscription callback '%s' threw exception!", subscription.matcher.getMatcher().print().c_str());
+			}
+		}
+
+		size_t FetchMultiplexer::getFetchCount() const
+		{
+			std::lock_guard < std::recursive_mutex > lock(m_mtx);
+			return m_upstreams.size();
+		}
+
+		size_t FetchMultiplexer::getSubscriptionCount() const
+		{
+			std::lock_guard < std::recursive_mutex > lock(m_mtx);
+			return m_subscriptions.size();
+		}
+	}
+}
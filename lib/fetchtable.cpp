@@ -0,0 +1,137 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include "hbk/exception/jsonrpc_exception.h"
+
+#include "fetchtable.h"
+
+namespace hbk
+{
+	namespace jet
+	{
+		/// lower bits of the fetch id: index of the slot
+		static const unsigned int SLOT_INDEX_BITS = 20;
+		static const unsigned int SLOT_INDEX_MASK = (1u << SLOT_INDEX_BITS) - 1;
+		/// upper bits of the fetch id: generation. Together with the index bits this stays a positive int.
+		static const unsigned int GENERATION_MASK = (1u << (31 - SLOT_INDEX_BITS)) - 1;
+
+		FetchTable::Slot::Slot()
+			: id(0)
+			, fetcher()
+		{
+		}
+
+		FetchTable::FetchTable()
+			: m_slots(std::make_shared < slots_t > ())
+			, m_writeMtx()
+			, m_generations()
+			, m_freeSlots()
+		{
+		}
+
+		fetchId_t FetchTable::add(const fetcher_t& fetcher)
+		{
+			std::lock_guard < std::mutex > lock(m_writeMtx);
+			std::shared_ptr < slots_t > slots = std::make_shared < slots_t > (*std::atomic_load(&m_slots));
+			size_t index;
+			if (m_freeSlots.empty()) {
+				index = slots->size();
+				if (index > SLOT_INDEX_MASK) {
+					throw hbk::exception::jsonrpcException(-1, "too many jet fetches!");
+				}
+				slots->push_back(Slot());
+				m_generations.push_back(0);
+			} else {
+				index = m_freeSlots.back();
+				m_freeSlots.pop_back();
+			}
+
+			// generation starts with 1, hence id 0 is never used
+			unsigned int& generation = m_generations[index];
+			generation = (generation % GENERATION_MASK) + 1;
+			fetchId_t fetchId = static_cast < fetchId_t > ((generation << SLOT_INDEX_BITS) | static_cast < unsigned int > (index));
+
+			Slot& slot = (*slots)[index];
+			slot.id = fetchId;
+			slot.fetcher = std::make_shared < const fetcher_t > (fetcher);
+			publish(slots);
+			return fetchId;
+		}
+
+		void FetchTable::erase(fetchId_t fetchId)
+		{
+			std::lock_guard < std::mutex > lock(m_writeMtx);
+			snapshot_t current = std::atomic_load(&m_slots);
+			size_t index = static_cast < size_t > (static_cast < unsigned int > (fetchId) & SLOT_INDEX_MASK);
+			if ((fetchId <= 0) || (index >= current->size()) || ((*current)[index].id != fetchId)) {
+				return;
+			}
+			std::shared_ptr < slots_t > slots = std::make_shared < slots_t > (*current);
+			(*slots)[index] = Slot();
+			m_freeSlots.push_back(index);
+			publish(slots);
+		}
+
+		FetchTable::fetcherPtr_t FetchTable::find(fetchId_t fetchId) const
+		{
+			snapshot_t current = std::atomic_load(&m_slots);
+			size_t index = static_cast < size_t > (static_cast < unsigned int > (fetchId) & SLOT_INDEX_MASK);
+			if ((fetchId <= 0) || (index >= current->size())) {
+				return fetcherPtr_t();
+			}
+			const Slot& slot = (*current)[index];
+			if (slot.id != fetchId) {
+				return fetcherPtr_t();
+			}
+			return slot.fetcher;
+		}
+
+		FetchTable::snapshot_t FetchTable::snapshot() const
+		{
+			return std::atomic_load(&m_slots);
+		}
+
+		FetchTable::snapshot_t FetchTable::clear()
+		{
+			std::lock_guard < std::mutex > lock(m_writeMtx);
+			snapshot_t current = std::atomic_load(&m_slots);
+			// generations are kept. Late notifications of cleared fetches are not to hit new ones.
+			m_freeSlots.clear();
+			for (size_t index = current->size(); index > 0; --index) {
+				m_freeSlots.push_back(index-1);
+			}
+			publish(std::make_shared < slots_t > (current->size()));
+			return current;
+		}
+
+		void FetchTable::publish(const std::shared_ptr < slots_t >& slots)
+		{
+			std::atomic_store(&m_slots, snapshot_t(slots));
+		}
+	}
+}
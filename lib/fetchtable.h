@@ -0,0 +1,98 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef __HBK_JET_FETCHTABLE_H
+#define __HBK_JET_FETCHTABLE_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "jet/defines.h"
+
+namespace hbk
+{
+	namespace jet
+	{
+		/// All fetches of one jet peer.
+		///
+		/// The id of a fetch carries the index of its slot in the lower bits and a generation in the upper bits.
+		/// Hence finding the fetch a notification belongs to is an array access.
+		/// The generation makes sure that a late notification of a removed fetch does not hit a fetch that reuses the slot.
+		///
+		/// The table is read-mostly. Readers work on an immutable snapshot that is replaced as a whole when adding or removing a fetch (read-copy-update).
+		/// The receive path does not wait while a writer copies the slots, but taking the snapshot with std::atomic_load is not lock-free.
+		/// With libstdc++ it briefly locks a mutex from a process-wide pool that add() and erase() lock as well when publishing.
+		/// Adding or removing a fetch copies all slots. This costs far less than the request to the jet daemon that goes with it.
+		/// A fetcher stays alive as long as a reader uses it, even if it was removed meanwhile.
+		class FetchTable
+		{
+		public:
+			using fetcherPtr_t = std::shared_ptr < const fetcher_t >;
+
+			struct Slot {
+				Slot();
+				/// 0 if the slot is not in use
+				fetchId_t id;
+				fetcherPtr_t fetcher;
+			};
+			using slots_t = std::vector < Slot >;
+			using snapshot_t = std::shared_ptr < const slots_t >;
+
+			FetchTable();
+			FetchTable(const FetchTable&) = delete;
+			FetchTable& operator=(const FetchTable&) = delete;
+
+			/// \return the id of the new fetch
+			fetchId_t add(const fetcher_t& fetcher);
+
+			void erase(fetchId_t fetchId);
+
+			/// \return fetcher or empty pointer if the fetch is not known
+			fetcherPtr_t find(fetchId_t fetchId) const;
+
+			/// \return all slots, unused ones have id 0
+			snapshot_t snapshot() const;
+
+			/// remove all fetches
+			/// \return the fetches removed
+			snapshot_t clear();
+
+		private:
+			/// replaces the current snapshot. m_writeMtx needs to be locked by the caller!
+			void publish(const std::shared_ptr < slots_t >& slots);
+
+			/// current snapshot, accessed by std::atomic_load and std::atomic_store only
+			snapshot_t m_slots;
+
+			/// Everything below is used by writers only
+			std::mutex m_writeMtx;
+			/// generation of each slot, incremented on each use
+			std::vector < unsigned int > m_generations;
+			/// indices of unused slots
+			std::vector < size_t > m_freeSlots;
+		};
+	}
+}
+#endif
@@ -0,0 +1,273 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <climits>
+#include <cstring>
+#include <string>
+
+#include <json/reader.h>
+#include <json/value.h>
+
+#include "hbk/jsonrpc/jsonrpc_defines.h"
+
+#include "jet/framedecoder.hpp"
+
+namespace hbk {
+	namespace jet {
+		static Json::CharReaderBuilder rBuilder;
+
+		/// \return first character that is no white space
+		static const char* skipWhiteSpace(const char* pPos, const char* pEnd)
+		{
+			while ((pPos < pEnd) && ((*pPos==' ') || (*pPos=='\t') || (*pPos=='\n') || (*pPos=='\r'))) {
+				++pPos;
+			}
+			return pPos;
+		}
+
+		/// @param pPos points to the opening quote
+		/// @param[out] hasEscape true if the string contains escape sequences
+		/// \return behind the closing quote, nullptr if the string is not terminated
+		static const char* skipString(const char* pPos, const char* pEnd, bool& hasEscape)
+		{
+			hasEscape = false;
+			for (++pPos; pPos < pEnd; ++pPos) {
+				if (*pPos=='"') {
+					return pPos+1;
+				} else if (*pPos=='\\') {
+					hasEscape = true;
+					++pPos;
+				}
+			}
+			return nullptr;
+		}
+
+		/// Only the structure is checked, not the content. Content is checked when parsing it.
+		/// \return behind the value starting at pPos, nullptr if the value is not terminated
+		static const char* skipValue(const char* pPos, const char* pEnd)
+		{
+			bool hasEscape;
+			if (pPos==pEnd) {
+				return nullptr;
+			}
+			if (*pPos=='"') {
+				return skipString(pPos, pEnd, hasEscape);
+			}
+			if ((*pPos=='{') || (*pPos=='[')) {
+				unsigned int depth = 0;
+				while (pPos < pEnd) {
+					switch (*pPos) {
+					case '"':
+						pPos = skipString(pPos, pEnd, hasEscape);
+						if (pPos==nullptr) {
+							return nullptr;
+						}
+						continue;
+					case '{':
+					case '[':
+						++depth;
+						break;
+					case '}':
+					case ']':
+						if (--depth==0) {
+							return pPos+1;
+						}
+						break;
+					default:
+						break;
+					}
+					++pPos;
+				}
+				return nullptr;
+			}
+			// number, true, false or null
+			const char* pStart = pPos;
+			while ((pPos < pEnd) && (*pPos!=',') && (*pPos!='}') && (*pPos!=']') && (*pPos!=' ') && (*pPos!='\t') && (*pPos!='\n') && (*pPos!='\r')) {
+				++pPos;
+			}
+			if (pPos==pStart) {
+				return nullptr;
+			}
+			return pPos;
+		}
+
+		/// \return true if the range is an integer that fits into fetchId_t
+		static bool parseFetchId(const char* pPos, const char* pEnd, fetchId_t& fetchId)
+		{
+			bool negative = false;
+			if ((pPos < pEnd) && (*pPos=='-')) {
+				negative = true;
+				++pPos;
+			}
+			if (pPos==pEnd) {
+				return false;
+			}
+			long long value = 0;
+			for (; pPos < pEnd; ++pPos) {
+				if ((*pPos < '0') || (*pPos > '9')) {
+					return false;
+				}
+				value = value*10 + (*pPos-'0');
+				if (value > static_cast < long long > (INT_MAX)+1) {
+					return false;
+				}
+			}
+			if (negative) {
+				value = -value;
+			}
+			if ((value < INT_MIN) || (value > INT_MAX)) {
+				return false;
+			}
+			fetchId = static_cast < fetchId_t > (value);
+			return true;
+		}
+
+		static bool isKey(const char* pKey, size_t keyLen, const char* pName)
+		{
+			return (keyLen==strlen(pName)) && (memcmp(pKey, pName, keyLen)==0);
+		}
+
+		JsonFrameDecoder::JsonFrameDecoder()
+			: m_reader(rBuilder.newCharReader())
+		{
+		}
+
+		JsonFrameDecoder::~JsonFrameDecoder()
+		{
+		}
+
+		bool JsonFrameDecoder::decode(const char* pTelegram, size_t len, FrameConsumer& consumer, std::string& errorMessage)
+		{
+			Json::Value data;
+			if (!parse(pTelegram, pTelegram+len, data, errorMessage)) {
+				return false;
+			}
+			consumer.consumeMessage(data);
+			return true;
+		}
+
+		bool JsonFrameDecoder::parse(const char* pBegin, const char* pEnd, Json::Value& value, std::string& errorMessage)
+		{
+			return m_reader->parse(pBegin, pEnd, &value, &errorMessage);
+		}
+
+		bool ScanningFrameDecoder::decode(const char* pTelegram, size_t len, FrameConsumer& consumer, std::string& errorMessage)
+		{
+			const char* pEnd = pTelegram+len;
+			const char* pPos = skipWhiteSpace(pTelegram, pEnd);
+			if ((pPos==pEnd) || (*pPos!='{')) {
+				// batch or invalid
+				return JsonFrameDecoder::decode(pTelegram, len, consumer, errorMessage);
+			}
+
+			const char* pMethod = nullptr;
+			const char* pMethodEnd = nullptr;
+			const char* pParams = nullptr;
+			const char* pParamsEnd = nullptr;
+			bool hasId = false;
+
+			pPos = skipWhiteSpace(pPos+1, pEnd);
+			while (true) {
+				if ((pPos==pEnd) || (*pPos!='"')) {
+					// empty object or invalid
+					return JsonFrameDecoder::decode(pTelegram, len, consumer, errorMessage);
+				}
+				bool hasEscape;
+				const char* pKey = pPos+1;
+				pPos = skipString(pPos, pEnd, hasEscape);
+				if ((pPos==nullptr) || (hasEscape)) {
+					return JsonFrameDecoder::decode(pTelegram, len, consumer, errorMessage);
+				}
+				size_t keyLen = static_cast < size_t > (pPos-1-pKey);
+
+				pPos = skipWhiteSpace(pPos, pEnd);
+				if ((pPos==pEnd) || (*pPos!=':')) {
+					return JsonFrameDecoder::decode(pTelegram, len, consumer, errorMessage);
+				}
+				const char* pValue = skipWhiteSpace(pPos+1, pEnd);
+				pPos = skipValue(pValue, pEnd);
+				if (pPos==nullptr) {
+					return JsonFrameDecoder::decode(pTelegram, len, consumer, errorMessage);
+				}
+
+				if (isKey(pKey, keyLen, jsonrpc::METHOD)) {
+					pMethod = pValue;
+					pMethodEnd = pPos;
+				} else if (isKey(pKey, keyLen, jsonrpc::PARAMS)) {
+					pParams = pValue;
+					pParamsEnd = pPos;
+				} else if (isKey(pKey, keyLen, jsonrpc::ID)) {
+					hasId = true;
+				}
+
+				pPos = skipWhiteSpace(pPos, pEnd);
+				if ((pPos < pEnd) && (*pPos==',')) {
+					pPos = skipWhiteSpace(pPos+1, pEnd);
+				} else if ((pPos < pEnd) && (*pPos=='}')) {
+					break;
+				} else {
+					return JsonFrameDecoder::decode(pTelegram, len, consumer, errorMessage);
+				}
+			}
+			if (skipWhiteSpace(pPos+1, pEnd)!=pEnd) {
+				// trailing garbage
+				return JsonFrameDecoder::decode(pTelegram, len, consumer, errorMessage);
+			}
+
+			if (pMethod==nullptr) {
+				// response
+				return JsonFrameDecoder::decode(pTelegram, len, consumer, errorMessage);
+			}
+
+			if (*pMethod=='"') {
+				// request for a state or method, the path is the method
+				bool hasEscape;
+				skipString(pMethod, pMethodEnd, hasEscape);
+				if (!hasEscape) {
+					m_path.assign(pMethod+1, pMethodEnd-1);
+					if (!consumer.isRequestConsumed(m_path)) {
+						return true;
+					}
+				}
+				return JsonFrameDecoder::decode(pTelegram, len, consumer, errorMessage);
+			}
+
+			// Fetch notifications carry the fetch id as method. They are no requests, hence they have no id.
+			fetchId_t fetchId;
+			if ((hasId) || (pParams==nullptr) || (!parseFetchId(pMethod, pMethodEnd, fetchId))) {
+				return JsonFrameDecoder::decode(pTelegram, len, consumer, errorMessage);
+			}
+
+			if (!consumer.isFetchConsumed(fetchId)) {
+				return true;
+			}
+			Json::Value params;
+			if (!parse(pParams, pParamsEnd, params, errorMessage)) {
+				return false;
+			}
+			consumer.consumeFetchNotification(fetchId, params);
+			return true;
+		}
+	}
+}
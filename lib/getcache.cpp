@@ -0,0 +1,332 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define syslog fprintf
+#define LOG_ERR stderr
+#else
+#include "syslog.h"
+#endif
+
+#include "hbk/jsonrpc/jsonrpc_defines.h"
+
+#include "jet/compiledmatcher.hpp"
+#include "jet/getcache.hpp"
+
+#include "callbackguard.h"
+
+namespace hbk
+{
+	namespace jet
+	{
+		/// length prefix keeps conditions apart whatever characters they contain
+		static void appendCondition(std::string& key, const std::string& condition)
+		{
+			key += std::to_string(condition.length());
+			key += ':';
+			key += condition;
+		}
+
+		static JsonRpcResponseObject createErrorResponse(const char* pMessage)
+		{
+			JsonRpcResponseObject response;
+			response[jsonrpc::ERR][jsonrpc::CODE] = -1;
+			response[jsonrpc::ERR][jsonrpc::MESSAGE] = pMessage;
+			return response;
+		}
+
+		GetCache::Entry::Entry(const matcher_t& match, const std::string& normalizedKey)
+			: matcher(match)
+			, key(normalizedKey)
+			, fetchId(0)
+			, complete(false)
+			, values()
+			, waiting()
+			, lruPosition()
+		{
+		}
+
+		GetCache::GetCache(PeerAsync& peer, size_t maxMatcherCount, size_t maxStateCount)
+			: m_peer(peer)
+			, m_maxMatcherCount(std::max(maxMatcherCount, static_cast < size_t > (1)))
+			, m_maxStateCount(maxStateCount)
+			, m_entries()
+			, m_lru()
+			, m_stateCount(0)
+			, m_guard(std::make_shared < CallbackGuard > ())
+			, m_mtx()
+		{
+		}
+
+		GetCache::~GetCache()
+		{
+			m_guard->close();
+			clear();
+		}
+
+		std::string GetCache::normalize(const matcher_t& match)
+		{
+			bool fold = match.caseInsensitive;
+			auto foldCase = [fold](const std::string& text)
+			{
+				return fold ? CompiledMatcher::foldCase(text) : text;
+			};
+			// contains is one more condition of containsAllOf. Order and duplicates do not matter.
+			std::set < std::string > contained;
+			if (!match.contains.empty()) {
+				contained.insert(foldCase(match.contains));
+			}
+			for (const auto &iter: match.containsAllOf) {
+				if (!iter.empty()) {
+					contained.insert(foldCase(iter));
+				}
+			}
+
+			std::string key(fold ? "i" : "s");
+			appendCondition(key, foldCase(match.startsWith));
+			appendCondition(key, foldCase(match.endsWith));
+			appendCondition(key, foldCase(match.equals));
+			appendCondition(key, foldCase(match.equalsNot));
+			for (const auto &iter: contained) {
+				appendCondition(key, iter);
+			}
+			return key;
+		}
+
+		void GetCache::getAsync(const matcher_t& match, responseCallback_t resultCallback)
+		{
+			std::string key = normalize(match);
+			JsonRpcResponseObject response;
+			{
+				std::lock_guard < std::mutex > lock(m_mtx);
+				auto entryIter = m_entries.find(key);
+				if (entryIter==m_entries.end()) {
+					entryPtr_t entry = std::make_shared < Entry > (match, key);
+					entry->waiting.push_back(std::move(resultCallback));
+					m_lru.push_front(entry);
+					entry->lruPosition = m_lru.begin();
+					m_entries[key] = entry;
+
+					std::weak_ptr < Entry > weakEntry(entry);
+					auto fetchCallback = [this, weakEntry](const Json::Value& notification, int status)
+					{
+						fetchCb(weakEntry, notification, status);
+					};
+					std::weak_ptr < CallbackGuard > weakGuard(m_guard);
+					auto fetchResultCallback = [this, weakEntry, weakGuard](const JsonRpcResponseObject& result)
+					{
+						CallbackGuard::call(weakGuard, [this, &weakEntry, &result]()
+						{
+							fetchResultCb(weakEntry, result);
+						});
+					};
+					entry->fetchId = m_peer.addFetchAsync(match, fetchCallback, fetchResultCallback);
+					enforceLimits();
+					return;
+				}
+
+				const entryPtr_t& entry = entryIter->second;
+				m_lru.splice(m_lru.begin(), m_lru, entry->lruPosition);
+				if (!entry->complete) {
+					entry->waiting.push_back(std::move(resultCallback));
+					return;
+				}
+				response = composeResponse(*entry);
+			}
+			callResultCallback(resultCallback, response);
+		}
+
+		ResponseFuture GetCache::get(const matcher_t& match)
+		{
+			Promise < JsonRpcResponseObject > promise;
+			getAsync(match, [promise](const JsonRpcResponseObject& response) mutable
+			{
+				promise.setValue(response);
+			});
+			return promise.getFuture();
+		}
+
+		JsonRpcResponseObject GetCache::composeResponse(const Entry& entry)
+		{
+			JsonRpcResponseObject response;
+			Json::Value& result = response[jsonrpc::RESULT];
+			result = Json::Value(Json::arrayValue);
+			for (const auto &iter: entry.values) {
+				Json::Value& element = result.append(Json::Value(Json::objectValue));
+				element[PATH] = iter.first;
+				element[VALUE] = iter.second;
+			}
+			return response;
+		}
+
+		void GetCache::callResultCallback(const responseCallback_t& resultCallback, const JsonRpcResponseObject& response)
+		{
+			if (!resultCallback) {
+				return;
+			}
+			try {
+				resultCallback(response);
+			} catch(const std::runtime_error &e) {
+				::syslog(LOG_ERR, "jet get cache: result callback threw exception '%s'!", e.what());
+			} catch(...) {
+				::syslog(LOG_ERR, "jet get cache: result callback threw exception!");
+			}
+		}
+
+		void GetCache::fetchCb(const std::weak_ptr < Entry >& weakEntry, const Json::Value& notification, int status)
+		{
+			std::vector < responseCallback_t > waiting;
+			{
+				std::lock_guard < std::mutex > lock(m_mtx);
+				entryPtr_t entry = weakEntry.lock();
+				if (!entry) {
+					return;
+				}
+
+				if (status < 0) {
+					// Elements removed while disconnected would not be notified. Start over with the next get.
+					waiting.swap(entry->waiting);
+					erase(entry);
+				} else {
+					const std::string path = notification[PATH].asString();
+					if (notification[EVENT].asString()==REMOVE) {
+						m_stateCount -= entry->values.erase(path);
+					} else if (notification.isMember(VALUE)) {
+						// methods are not delivered by get
+						auto result = entry->values.insert(std::make_pair(path, notification[VALUE]));
+						if (result.second) {
+							++m_stateCount;
+							// a busy fetch grows the cache without any get
+							enforceLimits();
+						} else {
+							result.first->second = notification[VALUE];
+						}
+					}
+					return;
+				}
+			}
+
+			JsonRpcResponseObject response = createErrorResponse("connection to jet daemon got lost!");
+			for (const auto &iter: waiting) {
+				callResultCallback(iter, response);
+			}
+		}
+
+		void GetCache::fetchResultCb(const std::weak_ptr < Entry >& weakEntry, const JsonRpcResponseObject& result)
+		{
+			std::vector < responseCallback_t > waiting;
+			JsonRpcResponseObject response;
+			{
+				std::lock_guard < std::mutex > lock(m_mtx);
+				entryPtr_t entry = weakEntry.lock();
+				if (!entry) {
+					return;
+				}
+				waiting.swap(entry->waiting);
+				if (result.isMember(jsonrpc::ERR)) {
+					::syslog(LOG_ERR, "jet get cache: fetch '%s' failed!", entry->matcher.print().c_str());
+					// the peer did forget the fetch already
+					entry->fetchId = 0;
+					erase(entry);
+					response = result;
+				} else {
+					entry->complete = true;
+					response = composeResponse(*entry);
+					enforceLimits();
+				}
+			}
+
+			for (const auto &iter: waiting) {
+				callResultCallback(iter, response);
+			}
+		}
+
+		void GetCache::erase(const entryPtr_t& entry)
+		{
+			m_stateCount -= entry->values.size();
+			m_lru.erase(entry->lruPosition);
+			m_entries.erase(entry->key);
+			if (entry->fetchId!=0) {
+				try {
+					m_peer.removeFetchAsync(entry->fetchId);
+				} catch(...) {
+					// the connection might be gone already
+				}
+			}
+		}
+
+		void GetCache::enforceLimits()
+		{
+			auto lruIter = m_lru.end();
+			while ((lruIter!=m_lru.begin()) && ((m_entries.size() > m_maxMatcherCount) || (m_stateCount > m_maxStateCount))) {
+				--lruIter;
+				entryPtr_t entry = *lruIter;
+				if (entry->complete) {
+					// iterators to other elements of the list stay valid
+					++lruIter;
+					erase(entry);
+				}
+			}
+		}
+
+		void GetCache::clear()
+		{
+			std::vector < responseCallback_t > waiting;
+			{
+				std::lock_guard < std::mutex > lock(m_mtx);
+				while (!m_lru.empty()) {
+					entryPtr_t entry = m_lru.front();
+					waiting.insert(waiting.end(), entry->waiting.begin(), entry->waiting.end());
+					erase(entry);
+				}
+			}
+
+			JsonRpcResponseObject response = createErrorResponse("jet get cache got cleared!");
+			for (const auto &iter: waiting) {
+				callResultCallback(iter, response);
+			}
+		}
+
+		size_t GetCache::getMatcherCount() const
+		{
+			std::lock_guard < std::mutex > lock(m_mtx);
+			return m_entries.size();
+		}
+
+		size_t GetCache::getStateCount() const
+		{
+			std::lock_guard < std::mutex > lock(m_mtx);
+			return m_stateCount;
+		}
+	}
+}
@@ -0,0 +1,113 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#include <string>
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "mappedfile.h"
+
+namespace hbk
+{
+	namespace jet
+	{
+		MappedFile::MappedFile()
+			: m_pData(nullptr)
+			, m_size(0)
+#ifdef _WIN32
+			, m_buffer()
+#endif
+		{
+		}
+
+		MappedFile::~MappedFile()
+		{
+			close();
+		}
+
+#ifdef _WIN32
+		int MappedFile::open(const std::string& fileName)
+		{
+			close();
+			std::ifstream file(fileName, std::ios::binary);
+			if (!file) {
+				return -1;
+			}
+			m_buffer.assign(std::istreambuf_iterator < char > (file), std::istreambuf_iterator < char > ());
+			m_pData = m_buffer.data();
+			m_size = m_buffer.size();
+			return 0;
+		}
+
+		void MappedFile::close()
+		{
+			m_buffer.clear();
+			m_pData = nullptr;
+			m_size = 0;
+		}
+#else
+		int MappedFile::open(const std::string& fileName)
+		{
+			close();
+			int fd = ::open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+			if (fd < 0) {
+				return -1;
+			}
+			struct stat fileStat;
+			if ((::fstat(fd, &fileStat) < 0) || (fileStat.st_size <= 0)) {
+				::close(fd);
+				return -1;
+			}
+			size_t size = static_cast < size_t > (fileStat.st_size);
+			void* pData = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			// the mapping stays valid after closing the file
+			::close(fd);
+			if (pData==MAP_FAILED) {
+				return -1;
+			}
+			m_pData = static_cast < const char* > (pData);
+			m_size = size;
+			return 0;
+		}
+
+		void MappedFile::close()
+		{
+			if (m_pData) {
+				::munmap(const_cast < char* > (m_pData), m_size);
+			}
+			m_pData = nullptr;
+			m_size = 0;
+		}
+#endif
+	}
+}
@@ -0,0 +1,69 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef __HBK_JET_MAPPEDFILE_H
+#define __HBK_JET_MAPPEDFILE_H
+
+#include <string>
+#include <vector>
+
+namespace hbk
+{
+	namespace jet
+	{
+		/// A file mapped read-only into memory. The mapping lives as long as the object.
+		/// \note Windows reads the file into memory instead
+		class MappedFile
+		{
+		public:
+			MappedFile();
+			MappedFile(const MappedFile&) = delete;
+			MappedFile& operator=(const MappedFile&) = delete;
+			virtual ~MappedFile();
+
+			/// \return 0 on success, -1 on error
+			int open(const std::string& fileName);
+
+			const char* data() const
+			{
+				return m_pData;
+			}
+
+			size_t size() const
+			{
+				return m_size;
+			}
+
+		private:
+			void close();
+
+			const char* m_pData;
+			size_t m_size;
+#ifdef _WIN32
+			std::vector < char > m_buffer;
+#endif
+		};
+	}
+}
+#endif
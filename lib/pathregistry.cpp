@@ -0,0 +1,337 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "pathregistry.h"
+
+namespace hbk
+{
+	namespace jet
+	{
+		static const size_t INITIAL_BUCKET_COUNT = 16;
+
+		PathRegistry::Element::Element(const std::string& elementPath)
+			: path(elementPath)
+			, state()
+			, method()
+			, deferredMethod()
+			, methodParams()
+		{
+		}
+
+		PathRegistry::Table::Table(size_t bucketCount)
+			: buckets(bucketCount)
+			, mask(bucketCount-1)
+		{
+		}
+
+		PathRegistry::PathRegistry()
+			: m_table(std::make_shared < Table > (INITIAL_BUCKET_COUNT))
+			, m_writeMtx()
+			, m_count(0)
+		{
+		}
+
+		size_t PathRegistry::hashPath(const char* path, size_t length)
+		{
+			// FNV-1a
+			uint64_t hash = 14695981039346656037ull;
+			for (size_t index = 0; index < length; ++index) {
+				hash ^= static_cast < unsigned char > (path[index]);
+				hash *= 1099511628211ull;
+			}
+			return static_cast < size_t > (hash ^ (hash >> 32));
+		}
+
+		PathRegistry::elementPtr_t PathRegistry::find(const char* path, size_t length) const
+		{
+			size_t hash = hashPath(path, length);
+			tablePtr_t table = std::atomic_load(&m_table);
+			for (nodePtr_t node = std::atomic_load(&table->buckets[hash & table->mask]); node; node = node->next) {
+				const std::string& elementPath = node->element->path;
+				if ((node->hash == hash) && (elementPath.length() == length) && (memcmp(elementPath.data(), path, length) == 0)) {
+					return node->element;
+				}
+			}
+			return elementPtr_t();
+		}
+
+		PathRegistry::elementPtr_t PathRegistry::find(const std::string& path) const
+		{
+			return find(path.data(), path.length());
+		}
+
+		void PathRegistry::addState(const std::shared_ptr < detail::stateEntry >& state)
+		{
+			const std::string& path = state->path;
+			size_t hash = hashPath(path.data(), path.length());
+			std::lock_guard < std::mutex > lock(m_writeMtx);
+			elementPtr_t current = findLocked(path, hash);
+			std::shared_ptr < Element > element = std::make_shared < Element > (path);
+			if (current) {
+				if (current->state) {
+					current->state->registered = false;
+				}
+				element->method = current->method;
+				element->deferredMethod = current->deferredMethod;
+				element->methodParams = current->methodParams;
+			}
+			element->state = state;
+			replace(path, hash, element);
+		}
+
+		void PathRegistry::eraseState(const std::string& path)
+		{
+			size_t hash = hashPath(path.data(), path.length());
+			std::lock_guard < std::mutex > lock(m_writeMtx);
+			elementPtr_t current = findLocked(path, hash);
+			if ((!current) || (!current->state)) {
+				return;
+			}
+			current->state->registered = false;
+			if (current->isMethod()) {
+				std::shared_ptr < Element > element = std::make_shared < Element > (path);
+				element->method = current->method;
+				element->deferredMethod = current->deferredMethod;
+				element->methodParams = current->methodParams;
+				replace(path, hash, element);
+			} else {
+				replace(path, hash, elementPtr_t());
+			}
+		}
+
+		void PathRegistry::addMethod(const std::string& path, const methodCallback_t& callback, const deferredMethodCallback_t& deferredCallback, const Json::Value& params)
+		{
+			size_t hash = hashPath(path.data(), path.length());
+			std::lock_guard < std::mutex > lock(m_writeMtx);
+			elementPtr_t current = findLocked(path, hash);
+			std::shared_ptr < Element > element = std::make_shared < Element > (path);
+			if (current) {
+				element->state = current->state;
+			}
+			element->method = callback;
+			element->deferredMethod = deferredCallback;
+			element->methodParams = params;
+			replace(path, hash, element);
+		}
+
+		void PathRegistry::eraseMethod(const std::string& path)
+		{
+			size_t hash = hashPath(path.data(), path.length());
+			std::lock_guard < std::mutex > lock(m_writeMtx);
+			elementPtr_t current = findLocked(path, hash);
+			if ((!current) || (!current->isMethod())) {
+				return;
+			}
+			if (current->state) {
+				std::shared_ptr < Element > element = std::make_shared < Element > (path);
+				element->state = current->state;
+				replace(path, hash, element);
+			} else {
+				replace(path, hash, elementPtr_t());
+			}
+		}
+
+		void PathRegistry::add(const std::vector < std::shared_ptr < detail::stateEntry > >& states, const std::vector < MethodEntry >& methods)
+		{
+			if (states.empty() && methods.empty()) {
+				return;
+			}
+
+			std::lock_guard < std::mutex > lock(m_writeMtx);
+			// elements to be published by path. Each one is merged with the element currently registered.
+			std::unordered_map < std::string, std::shared_ptr < Element > > added;
+			auto compose = [this, &added](const std::string& path) -> Element&
+			{
+				std::shared_ptr < Element >& element = added[path];
+				if (!element) {
+					element = std::make_shared < Element > (path);
+					elementPtr_t current = findLocked(path, hashPath(path.data(), path.length()));
+					if (current) {
+						element->state = current->state;
+						element->method = current->method;
+						element->deferredMethod = current->deferredMethod;
+						element->methodParams = current->methodParams;
+					}
+				}
+				return *element;
+			};
+			for (const auto &state: states) {
+				Element& element = compose(state->path);
+				if (element.state) {
+					element.state->registered = false;
+				}
+				element.state = state;
+			}
+			for (const auto &method: methods) {
+				Element& element = compose(method.path);
+				element.method = method.callback;
+				element.deferredMethod = method.deferredCallback;
+				element.methodParams = method.params;
+			}
+
+			tablePtr_t current = std::atomic_load(&m_table);
+			size_t bucketCount = current->buckets.size();
+			while (bucketCount < m_count + added.size()) {
+				bucketCount *= 2;
+			}
+			// the new table is not published yet, no need for atomic access to its buckets
+			tablePtr_t table = std::make_shared < Table > (bucketCount);
+			size_t count = 0;
+			for (auto &bucket: current->buckets) {
+				for (nodePtr_t node = std::atomic_load(&bucket); node; node = node->next) {
+					if (added.find(node->element->path) != added.end()) {
+						continue;
+					}
+					nodePtr_t& newBucket = table->buckets[node->hash & table->mask];
+					std::shared_ptr < Node > newNode = std::make_shared < Node > (*node);
+					newNode->next = newBucket;
+					newBucket = newNode;
+					++count;
+				}
+			}
+			for (const auto &iter: added) {
+				std::shared_ptr < Node > newNode = std::make_shared < Node > ();
+				newNode->hash = hashPath(iter.first.data(), iter.first.length());
+				newNode->element = iter.second;
+				nodePtr_t& newBucket = table->buckets[newNode->hash & table->mask];
+				newNode->next = newBucket;
+				newBucket = newNode;
+				++count;
+			}
+			m_count = count;
+			std::atomic_store(&m_table, table);
+		}
+
+		void PathRegistry::clear()
+		{
+			std::lock_guard < std::mutex > lock(m_writeMtx);
+			tablePtr_t table = std::atomic_load(&m_table);
+			for (auto &bucket: table->buckets) {
+				for (nodePtr_t node = std::atomic_load(&bucket); node; node = node->next) {
+					if (node->element->state) {
+						node->element->state->registered = false;
+					}
+				}
+			}
+			std::atomic_store(&m_table, std::make_shared < Table > (INITIAL_BUCKET_COUNT));
+			m_count = 0;
+		}
+
+		size_t PathRegistry::size() const
+		{
+			std::lock_guard < std::mutex > lock(m_writeMtx);
+			return m_count;
+		}
+
+		std::vector < PathRegistry::elementPtr_t > PathRegistry::elements() const
+		{
+			std::vector < elementPtr_t > result;
+			tablePtr_t table = std::atomic_load(&m_table);
+			for (const auto &bucket: table->buckets) {
+				for (nodePtr_t node = std::atomic_load(&bucket); node; node = node->next) {
+					result.push_back(node->element);
+				}
+			}
+			return result;
+		}
+
+		PathRegistry::elementPtr_t PathRegistry::findLocked(const std::string& path, size_t hash) const
+		{
+			tablePtr_t table = std::atomic_load(&m_table);
+			for (nodePtr_t node = std::atomic_load(&table->buckets[hash & table->mask]); node; node = node->next) {
+				if ((node->hash == hash) && (node->element->path == path)) {
+					return node->element;
+				}
+			}
+			return elementPtr_t();
+		}
+
+		void PathRegistry::replace(const std::string& path, size_t hash, const elementPtr_t& element)
+		{
+			tablePtr_t table = std::atomic_load(&m_table);
+			nodePtr_t& bucket = table->buckets[hash & table->mask];
+			nodePtr_t head = std::atomic_load(&bucket);
+
+			// nodes in front of the replaced one are copied, the ones behind it are shared by the new chain
+			std::vector < nodePtr_t > front;
+			nodePtr_t chain = head;
+			bool found = false;
+			for (nodePtr_t node = head; node; node = node->next) {
+				if ((node->hash == hash) && (node->element->path == path)) {
+					chain = node->next;
+					found = true;
+					break;
+				}
+				front.push_back(node);
+			}
+			if (!found) {
+				front.clear();
+			}
+			for (auto iter = front.rbegin(); iter != front.rend(); ++iter) {
+				std::shared_ptr < Node > node = std::make_shared < Node > (**iter);
+				node->next = chain;
+				chain = node;
+			}
+			if (element) {
+				std::shared_ptr < Node > node = std::make_shared < Node > ();
+				node->hash = hash;
+				node->element = element;
+				node->next = chain;
+				chain = node;
+			}
+			std::atomic_store(&bucket, chain);
+
+			if (found && !element) {
+				--m_count;
+			} else if (!found && element) {
+				++m_count;
+				if (m_count > table->buckets.size()) {
+					grow();
+				}
+			}
+		}
+
+		void PathRegistry::grow()
+		{
+			tablePtr_t current = std::atomic_load(&m_table);
+			tablePtr_t table = std::make_shared < Table > (current->buckets.size() * 2);
+			// the new table is not published yet, no need for atomic access to its buckets
+			for (auto &bucket: current->buckets) {
+				for (nodePtr_t node = std::atomic_load(&bucket); node; node = node->next) {
+					nodePtr_t& newBucket = table->buckets[node->hash & table->mask];
+					std::shared_ptr < Node > newNode = std::make_shared < Node > (*node);
+					newNode->next = newBucket;
+					newBucket = newNode;
+				}
+			}
+			std::atomic_store(&m_table, table);
+		}
+	}
+}
@@ -0,0 +1,151 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef __HBK_JET_PATHREGISTRY_H
+#define __HBK_JET_PATHREGISTRY_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "jet/defines.h"
+#include "jet/peerasync.hpp"
+
+namespace hbk
+{
+	namespace jet
+	{
+		/// All states and methods registered by one jet peer.
+		///
+		/// Each path is stored once in an immutable element. Requests are dispatched on that element: lookups compare the received
+		/// path in place (no std::string is composed) and callbacks get the registered path.
+		///
+		/// Each bucket of the hash table is an immutable chain that is replaced as a whole when adding or removing an element (read-copy-update).
+		/// Readers do not wait while a writer composes the new table or chain. They are not lock-free though: a lookup copies the table
+		/// and the bucket pointer with std::atomic_load. With libstdc++ this locks a mutex from a process-wide pool for the duration
+		/// of the reference count update. std::atomic_store of the writer and all other shared_ptr atomics of the process use the same pool.
+		/// An element stays alive as long as a reader uses it, even if it was removed meanwhile. Hence callbacks are executed without holding any lock.
+		class PathRegistry
+		{
+		public:
+			/// a state or a method. Never changed after being published.
+			struct Element
+			{
+				Element(const std::string& elementPath);
+
+				const std::string path;
+				/// set if the path is a state
+				std::shared_ptr < detail::stateEntry > state;
+				/// set if the path is a method
+				methodCallback_t method;
+				/// set if the path is a method that is completed later
+				deferredMethodCallback_t deferredMethod;
+				/// parameters of the request adding the method. Used to add it again after reconnecting.
+				Json::Value methodParams;
+
+				bool isMethod() const
+				{
+					return method || deferredMethod;
+				}
+			};
+			using elementPtr_t = std::shared_ptr < const Element >;
+
+			/// a method to be added by add()
+			struct MethodEntry
+			{
+				std::string path;
+				methodCallback_t callback;
+				deferredMethodCallback_t deferredCallback;
+				Json::Value params;
+			};
+
+			PathRegistry();
+			PathRegistry(const PathRegistry&) = delete;
+			PathRegistry& operator=(const PathRegistry&) = delete;
+
+			/// \return element or empty pointer if the path is not registered
+			elementPtr_t find(const char* path, size_t length) const;
+			elementPtr_t find(const std::string& path) const;
+
+			/// a state already registered with this path is marked as not being registered anymore
+			void addState(const std::shared_ptr < detail::stateEntry >& state);
+			void eraseState(const std::string& path);
+
+			/// @param callback or deferredCallback is to be set
+			/// @param params parameters of the request adding the method
+			void addMethod(const std::string& path, const methodCallback_t& callback, const deferredMethodCallback_t& deferredCallback, const Json::Value& params);
+			void eraseMethod(const std::string& path);
+
+			/// Add many states and methods at once. Readers see all of them or none of them.
+			/// The table is rebuild once instead of replacing one bucket chain per path.
+			/// A state already registered with the same path is marked as not being registered anymore.
+			void add(const std::vector < std::shared_ptr < detail::stateEntry > >& states, const std::vector < MethodEntry >& methods);
+
+			/// remove all states and methods. States are marked as not being registered anymore.
+			void clear();
+
+			/// \return number of registered paths
+			size_t size() const;
+
+			/// \return all elements currently registered
+			std::vector < elementPtr_t > elements() const;
+
+		private:
+			struct Node
+			{
+				size_t hash;
+				elementPtr_t element;
+				std::shared_ptr < const Node > next;
+			};
+			using nodePtr_t = std::shared_ptr < const Node >;
+
+			struct Table
+			{
+				explicit Table(size_t bucketCount);
+				/// accessed by std::atomic_load and std::atomic_store only
+				std::vector < nodePtr_t > buckets;
+				size_t mask;
+			};
+			using tablePtr_t = std::shared_ptr < Table >;
+
+			static size_t hashPath(const char* path, size_t length);
+
+			/// \return element currently registered with the path. m_writeMtx needs to be locked by the caller!
+			elementPtr_t findLocked(const std::string& path, size_t hash) const;
+			/// Replace the element registered with the path. An empty element removes it. m_writeMtx needs to be locked by the caller!
+			void replace(const std::string& path, size_t hash, const elementPtr_t& element);
+			/// Double the number of buckets. m_writeMtx needs to be locked by the caller!
+			void grow();
+
+			/// current table, accessed by std::atomic_load and std::atomic_store only
+			tablePtr_t m_table;
+
+			/// Everything below is used by writers only
+			mutable std::mutex m_writeMtx;
+			size_t m_count;
+		};
+	}
+}
+#endif
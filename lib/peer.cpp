@@ -21,6 +21,7 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <future>
 #include <thread>
 
 #include "json/value.h"
@@ -80,6 +81,11 @@ namespace hbk
 			return m_peerAsync.resume();
 		}
 
+		void Peer::setAutoReconnect(std::chrono::milliseconds minDelay, std::chrono::milliseconds maxDelay, connectionCallback_t callback)
+		{
+			m_peerAsync.setAutoReconnect(minDelay, maxDelay, std::move(callback));
+		}
+
 		Json::Value Peer::authenticate(const std::string& user, const std::string& password)
 		{
 			Json::Value params;
@@ -195,7 +201,7 @@ namespace hbk
 		{
 			params[PATH] = path;
 
-			m_peerAsync.registerMethod(path, callback);
+			m_peerAsync.registerMethod(path, params, callback);
 			SyncRequest request(ADD, params);
 
 			Json::Value retVal = request.executeSync(m_peerAsync);
@@ -216,23 +222,50 @@ namespace hbk
 			m_peerAsync.addMethodAsync(path, fetchGroups, callGroups, callback, timeout_s, resultCallback);
 		}
 
-		void Peer::addState(const std::string& path, const Json::Value& value, stateCallback_t callback)
+		std::vector < JsonRpcResponseObject > Peer::addStates(const std::vector < StateSpec >& states, std::vector < StateHandle >* pStates)
+		{
+			std::promise < std::vector < JsonRpcResponseObject > > promise;
+			std::future < std::vector < JsonRpcResponseObject > > results = promise.get_future();
+			auto lambda = [&promise](const std::vector < JsonRpcResponseObject >& responses)
+			{
+				promise.set_value(responses);
+			};
+			std::vector < StateHandle > handles = m_peerAsync.addStatesAsync(states, lambda);
+			if (pStates) {
+				pStates->swap(handles);
+			}
+			return results.get();
+		}
+
+		std::vector < JsonRpcResponseObject > Peer::addMethods(const std::vector < MethodSpec >& methods)
+		{
+			std::promise < std::vector < JsonRpcResponseObject > > promise;
+			std::future < std::vector < JsonRpcResponseObject > > results = promise.get_future();
+			auto lambda = [&promise](const std::vector < JsonRpcResponseObject >& responses)
+			{
+				promise.set_value(responses);
+			};
+			m_peerAsync.addMethodsAsync(methods, lambda);
+			return results.get();
+		}
+
+		StateHandle Peer::addState(const std::string& path, const Json::Value& value, stateCallback_t callback)
 		{
 			Json::Value params;
-			addStatePrivate(path, value, params, callback);
+			return addStatePrivate(path, value, params, callback);
 		}
 
-		void Peer::addState(const std::string& path, const Json::Value& value, double timeout_s, stateCallback_t callback)
+		StateHandle Peer::addState(const std::string& path, const Json::Value& value, double timeout_s, stateCallback_t callback)
 		{
 			Json::Value params;
 			params[TIMEOUT] = timeout_s;
 
-			addStatePrivate(path, value, params, callback);
+			return addStatePrivate(path, value, params, callback);
 		}
 
-		void Peer::addState(const std::string& path, const userGroups_t& fetchGroups,
-		                    const userGroups_t& setGroups, const Json::Value& value,
-		                    double timeout_s, stateCallback_t callback)
+		StateHandle Peer::addState(const std::string& path, const userGroups_t& fetchGroups,
+		                           const userGroups_t& setGroups, const Json::Value& value,
+		                           double timeout_s, stateCallback_t callback)
 		{
 			Json::Value params;
 			params[TIMEOUT] = timeout_s;
@@ -254,15 +287,15 @@ namespace hbk
 				params[ACCESS][SET_GROUPS] = groups;
 			}
 
-			addStatePrivate(path, value, params, callback);
+			return addStatePrivate(path, value, params, callback);
 		}
 
-		void Peer::addStatePrivate(const std::string& path, const Json::Value& value, Json::Value& params, stateCallback_t callback)
+		StateHandle Peer::addStatePrivate(const std::string& path, const Json::Value& value, Json::Value& params, stateCallback_t callback)
 		{
 			params[PATH] = path;
 			params[VALUE] = value;
 
-			m_peerAsync.registerState(path, callback);
+			StateHandle state(m_peerAsync.registerState(path, params, callback));
 			SyncRequest method(ADD, params);
 			Json::Value retVal = method.executeSync(m_peerAsync);
 
@@ -270,27 +303,28 @@ namespace hbk
 				m_peerAsync.unregisterState(path);
 				throw jsoncpprpcException(retVal);
 			}
+			return state;
 		}
 
 		/// @param resultCallback called on completion providing the result
 		/// @param callback function to be called when state is set via jet. leave empty for read only states
 		/// \throws hbk::exception::jsonrpcException on error
-		void Peer::addStateAsync(const std::string& path, const Json::Value& value, responseCallback_t resultCallback, stateCallback_t callback)
+		StateHandle Peer::addStateAsync(const std::string& path, const Json::Value& value, responseCallback_t resultCallback, stateCallback_t callback)
 		{
-			m_peerAsync.addStateAsync(path, value, resultCallback, callback);
+			return m_peerAsync.addStateAsync(path, value, resultCallback, callback);
 		}
 
-		void Peer::addStateAsync(const std::string& path, const Json::Value& value, double timeout_s, responseCallback_t resultCallback, stateCallback_t callback)
+		StateHandle Peer::addStateAsync(const std::string& path, const Json::Value& value, double timeout_s, responseCallback_t resultCallback, stateCallback_t callback)
 		{
-			m_peerAsync.addStateAsync(path, value, timeout_s, resultCallback, callback);
+			return m_peerAsync.addStateAsync(path, value, timeout_s, resultCallback, callback);
 		}
 
-		void Peer::addStateAsync(const std::string& path, const Json::Value& value,
-		                         const userGroups_t& fetchGroups, const userGroups_t& setGroups,
-		                         double timeout_s, responseCallback_t resultCallback,
-		                         stateCallback_t callback)
+		StateHandle Peer::addStateAsync(const std::string& path, const Json::Value& value,
+		                                const userGroups_t& fetchGroups, const userGroups_t& setGroups,
+		                                double timeout_s, responseCallback_t resultCallback,
+		                                stateCallback_t callback)
 		{
-			m_peerAsync.addStateAsync(path, fetchGroups, setGroups, value, timeout_s, resultCallback, callback);
+			return m_peerAsync.addStateAsync(path, fetchGroups, setGroups, value, timeout_s, resultCallback, callback);
 		}
 
 		void Peer::removeFetchAsync(fetchId_t fetchId, responseCallback_t resultCb)
@@ -322,13 +356,12 @@ namespace hbk
 
 		fetchId_t Peer::addFetch(const matcher_t &match, fetchCallback_t callback)
 		{
-			fetchId_t fetchId = PeerAsync::createFetchId();
+			fetchId_t fetchId = m_peerAsync.registerFetch(fetcher_t(callback, match));
 
 			Json::Value params;
 			params[jsonrpc::ID] = fetchId;
 			PeerAsync::addPathInformation(params, match);
 
-			m_peerAsync.registerFetch(fetchId, fetcher_t(callback, match));
 			SyncRequest method(FETCH, params);
 
 			Json::Value result = method.executeSync(m_peerAsync);
@@ -21,10 +21,13 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <algorithm>
 #include <cstring>
+#include <deque>
 #include <stdexcept>
 #include <functional>
 #include <mutex>
+#include <unordered_set>
 
 
 #include <json/reader.h>
@@ -34,6 +37,8 @@
 #ifndef _WIN32
 #include <arpa/inet.h>
 #include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <syslog.h>
 #else
 #include <WinSock2.h>
@@ -52,6 +57,12 @@
 #include "jet/peerasync.hpp"
 #include "jet/defines.h"
 #include "asyncrequest.h"
+#include "fetchtable.h"
+#include "pathregistry.h"
+#include "pendingrequests.h"
+#include "receivebuffer.h"
+#include "telegramwriter.h"
+#include "workerpool.h"
 
 
 
@@ -66,10 +77,11 @@
 
 namespace hbk {
 	namespace jet {
-		static Json::CharReaderBuilder rBuilder;
 		static Json::StreamWriterBuilder wBuilder;
 
-		std::atomic <fetchId_t > PeerAsync::m_sfetchId(0);
+		/// minimum number of bytes read from the socket at once
+		static const size_t RECEIVE_CHUNK_SIZE = 65536;
+
 
 
 		fetcher_t::fetcher_t()
@@ -84,6 +96,363 @@ namespace hbk {
 		{
 		}
 
+		receiveStatus_t::receiveStatus_t()
+			: telegramCount(0)
+			, decodeErrorCount(0)
+			, droppedFetchNotificationCount(0)
+			, droppedRequestCount(0)
+		{
+		}
+
+		sendQueueStatus_t::sendQueueStatus_t()
+			: queuedBytes(0)
+			, maxQueuedBytes(0)
+			, totalQueuedBytes(0)
+			, congestionCount(0)
+			, congested(false)
+		{
+		}
+
+
+		detail::stateEntry::stateEntry(const std::string& statePath, const Json::Value& params, stateCallback_t stateCallback, deferredStateCallback_t deferredStateCallback)
+			: path(statePath)
+			, addParams(params)
+			, changePrefix(telegramWriter::composeChangePrefix(statePath))
+			, callback(std::move(stateCallback))
+			, deferredCallback(std::move(deferredStateCallback))
+			, registered(true)
+			, conflated(false)
+			, value()
+			, valueMtx()
+		{
+		}
+
+		Json::Value detail::stateEntry::getAddParams() const
+		{
+			Json::Value params = addParams;
+			std::string latestValue;
+			{
+				std::lock_guard < std::mutex > lock(valueMtx);
+				latestValue = value;
+			}
+			if (!latestValue.empty()) {
+				Json::CharReaderBuilder builder;
+				std::unique_ptr < Json::CharReader > reader(builder.newCharReader());
+				std::string errors;
+				if (!reader->parse(latestValue.data(), latestValue.data() + latestValue.length(), &params[VALUE], &errors)) {
+					syslog(LOG_ERR, "jet peer: Latest value of state '%s' is invalid (%s)!", path.c_str(), errors.c_str());
+					params[VALUE] = addParams[VALUE];
+				}
+			}
+			return params;
+		}
+
+		StateHandle::StateHandle()
+			: m_entry()
+		{
+		}
+
+		StateHandle::StateHandle(std::shared_ptr < const detail::stateEntry > entry)
+			: m_entry(std::move(entry))
+		{
+		}
+
+		bool StateHandle::isRegistered() const
+		{
+			return m_entry && m_entry->registered;
+		}
+
+		const std::string& StateHandle::getPath() const
+		{
+			static const std::string noPath;
+			if (!m_entry) {
+				return noPath;
+			}
+			return m_entry->path;
+		}
+
+		StateSpec::StateSpec(const std::string& statePath, const Json::Value& stateValue, stateCallback_t stateCallback, double timeout)
+			: path(statePath)
+			, value(stateValue)
+			, callback(std::move(stateCallback))
+			, timeout_s(timeout)
+			, fetchGroups()
+			, setGroups()
+		{
+		}
+
+		MethodSpec::MethodSpec(const std::string& methodPath, methodCallback_t methodCallback, double timeout)
+			: path(methodPath)
+			, callback(std::move(methodCallback))
+			, timeout_s(timeout)
+			, fetchGroups()
+			, callGroups()
+		{
+		}
+
+		/// collects the responses of a batch of requests
+		struct batchResponses
+		{
+			batchResponses(size_t count, batchResponseCallback_t batchCallback)
+				: mtx()
+				, results(count)
+				, remaining(count)
+				, callback(std::move(batchCallback))
+			{
+			}
+
+			/// the callback is called with all results when the last one arrived
+			void complete(size_t index, const JsonRpcResponseObject& result)
+			{
+				{
+					std::lock_guard < std::mutex > lock(mtx);
+					results[index] = result;
+					if (--remaining > 0) {
+						return;
+					}
+				}
+				try {
+					callback(results);
+				} catch(...) {
+				}
+			}
+
+			std::mutex mtx;
+			std::vector < JsonRpcResponseObject > results;
+			size_t remaining;
+			batchResponseCallback_t callback;
+		};
+
+		/// \return error response of a request that is not send because its path is contained in the batch before
+		static JsonRpcResponseObject duplicatePathError(const std::string& path)
+		{
+			JsonRpcResponseObject error;
+			error[jsonrpc::ERR][jsonrpc::CODE] = -32602;
+			error[jsonrpc::ERR][jsonrpc::MESSAGE] = "path '" + path + "' is contained in the batch more than once";
+			PendingRequests::markLocalError(error);
+			return error;
+		}
+
+		/// add the access groups to the parameters of an add request
+		static void addGroups(Json::Value& params, const char* pKey, const userGroups_t& groups)
+		{
+			if (groups.empty()) {
+				return;
+			}
+			Json::Value& groupsNode = params[ACCESS][pKey];
+			groupsNode = Json::Value(Json::arrayValue);
+			for (const std::string& it: groups) {
+				groupsNode.append(it);
+			}
+		}
+
+		/// compose the error response for the exception currently handled. To be called from within a catch block only!
+		static Json::Value composeErrorResponse()
+		{
+			Json::Value response;
+			try {
+				throw;
+			} catch (const jsoncpprpcException& e) {
+				response = e.json();
+			} catch (const hbk::exception::jsonrpcException& e) {
+				response[jsonrpc::ERR][jsonrpc::CODE] = e.code();
+				response[jsonrpc::ERR][jsonrpc::MESSAGE] = e.message();
+			} catch (const std::exception& e) {
+				response[jsonrpc::ERR][jsonrpc::CODE] = jsonrpc::internalError;
+				response[jsonrpc::ERR][jsonrpc::MESSAGE] = e.what();
+			} catch (...) {
+				response[jsonrpc::ERR][jsonrpc::CODE] = jsonrpc::internalError;
+				response[jsonrpc::ERR][jsonrpc::MESSAGE] = "caught exception!";
+			}
+			return response;
+		}
+
+		/// the response to a request setting a state
+		static Json::Value composeStateResponse(const SetStateCbResult& stateCallbackResult)
+		{
+			static const Json::Value SUCCESS_RESPONSE = Json::Value(Json::objectValue);
+			Json::Value response;
+			if (stateCallbackResult.result.code) {
+				response[jsonrpc::RESULT][WARNING][jsonrpc::CODE] = stateCallbackResult.result.code;
+				if (!stateCallbackResult.result.message.empty()) {
+					response[jsonrpc::RESULT][WARNING][jsonrpc::MESSAGE] = stateCallbackResult.result.message;
+				}
+			} else {
+				response[jsonrpc::RESULT] = SUCCESS_RESPONSE;
+			}
+			return response;
+		}
+
+		/// notification of the value of a state changed by a set request
+		static Json::Value composeSetChange(const std::string& path, const Json::Value& value)
+		{
+			Json::Value notification;
+			notification[jsonrpc::METHOD] = CHANGE;
+			Json::Value& params = notification[jsonrpc::PARAMS];
+			params[PATH] = path;
+			params[VALUE] = value;
+			return notification;
+		}
+
+		namespace detail
+		{
+			/// Responders outlive their peer. They send via this link which is cut on destruction of the peer.
+			struct responderLink
+			{
+				explicit responderLink(PeerAsync* pOwner)
+					: mtx()
+					, pPeer(pOwner)
+				{
+				}
+
+				std::mutex mtx;
+				/// nullptr after destruction of the peer
+				PeerAsync* pPeer;
+			};
+
+			/// Jobs posted to the eventloop of a peer. Promises handed out by the peer outlive it.
+			struct resumeQueue
+			{
+				explicit resumeQueue(hbk::sys::Notifier* pResumeNotifier)
+					: mtx()
+					, jobs()
+					, pNotifier(pResumeNotifier)
+				{
+				}
+
+				/// the job is executed in eventloop context. After destruction of the peer it is executed right away.
+				void post(std::function < void() > job)
+				{
+					{
+						std::lock_guard < std::mutex > lck(mtx);
+						if (pNotifier) {
+							jobs.push_back(std::move(job));
+							pNotifier->notify();
+							return;
+						}
+					}
+					job();
+				}
+
+				/// \return all jobs posted so far
+				std::deque < std::function < void() > > take()
+				{
+					std::deque < std::function < void() > > posted;
+					std::lock_guard < std::mutex > lck(mtx);
+					posted.swap(jobs);
+					return posted;
+				}
+
+				std::mutex mtx;
+				std::deque < std::function < void() > > jobs;
+				/// nullptr after destruction of the peer
+				hbk::sys::Notifier* pNotifier;
+			};
+
+			/// a request of a deferred state or method that is not completed yet
+			struct pendingResponse
+			{
+				pendingResponse(const std::shared_ptr < responderLink >& peerLink, const Json::Value& requestId, const std::string& statePath)
+					: link(peerLink)
+					, id(requestId)
+					, path(statePath)
+					, completed(false)
+				{
+				}
+
+				pendingResponse(const pendingResponse&) = delete;
+				pendingResponse& operator=(const pendingResponse&) = delete;
+
+				~pendingResponse()
+				{
+					if (!completed) {
+						Json::Value response;
+						response[jsonrpc::ERR][jsonrpc::CODE] = jsonrpc::internalError;
+						response[jsonrpc::ERR][jsonrpc::MESSAGE] = "request was not completed!";
+						send(response, Json::Value());
+					}
+				}
+
+				/// send the change notification if the value is not null, then the response
+				/// \return 0 on success, -1 if already completed or on error
+				int send(Json::Value& response, const Json::Value& changedValue)
+				{
+					if (completed.exchange(true)) {
+						return -1;
+					}
+					std::lock_guard < std::mutex > lock(link->mtx);
+					if (link->pPeer == nullptr) {
+						return -1;
+					}
+					try {
+						if (!changedValue.isNull()) {
+							link->pPeer->keepStateValue(path, changedValue);
+							link->pPeer->sendMessage(composeSetChange(path, changedValue));
+						}
+						if (id) {
+							// requests without id are notifications, they get no response
+							response[jsonrpc::ID] = id;
+							link->pPeer->sendMessage(response);
+						}
+					} catch (const hbk::exception::jsonrpcException& e) {
+						syslog(LOG_ERR, "jet peer: Unable to send %s", e.message().c_str());
+						return -1;
+					}
+					return 0;
+				}
+
+				const std::shared_ptr < responderLink > link;
+				const Json::Value id;
+				/// path of the state, empty for methods
+				const std::string path;
+				std::atomic < bool > completed;
+			};
+		}
+
+		Responder::Responder()
+			: m_response()
+		{
+		}
+
+		Responder::Responder(std::shared_ptr < detail::pendingResponse > response)
+			: m_response(std::move(response))
+		{
+		}
+
+		int Responder::complete(const Json::Value& result)
+		{
+			if (!m_response) {
+				return -1;
+			}
+			Json::Value response;
+			response[jsonrpc::RESULT] = result;
+			return m_response->send(response, Json::Value());
+		}
+
+		int Responder::complete(const SetStateCbResult& stateResult)
+		{
+			if (!m_response) {
+				return -1;
+			}
+			Json::Value response = composeStateResponse(stateResult);
+			return m_response->send(response, stateResult.value);
+		}
+
+		int Responder::fail(int code, const std::string& message)
+		{
+			if (!m_response) {
+				return -1;
+			}
+			Json::Value response;
+			response[jsonrpc::ERR][jsonrpc::CODE] = code;
+			response[jsonrpc::ERR][jsonrpc::MESSAGE] = message;
+			return m_response->send(response, Json::Value());
+		}
+
+		bool Responder::isCompleted() const
+		{
+			return (!m_response) || m_response->completed;
+		}
 
 		PeerAsync::PeerAsync(sys::EventLoop& eventloop, const std::string &address, unsigned int port, const std::string& name, bool debug)
 			: m_address(address)
@@ -93,11 +462,60 @@ namespace hbk {
 			, m_eventLoop(eventloop)
 			, m_socket(eventloop)
 			, m_stopped(false)
-			, m_lengthBufferLevel(0)
-			, m_dataBuffer()
-			, m_dataBufferLevel(0)
-			, m_reader(rBuilder.newCharReader())
+			, m_connectionGeneration(0)
+			, m_sendQueue()
+			, m_sendQueuePos(0)
+			, m_lowWatermark(MAX_MESSAGE_SIZE)
+			, m_highWatermark(4*MAX_MESSAGE_SIZE)
+			, m_sendQueueStatus()
+			, m_backpressureCallback()
+			, m_reportedCongestion(false)
+			, m_backpressureNotifier(eventloop)
+			, m_corked(false)
+			, m_corkWindow(0)
+			, m_sendBuffer()
+			, m_flushScheduled(false)
+			, m_flushNotifier(eventloop)
+			, m_flushTimer(eventloop)
+			, m_conflateMutex()
+			, m_conflateAll(false)
+			, m_conflateInterval(0)
+			, m_conflatedChanges()
+			, m_conflatedCount(0)
+			, m_conflatedIndex()
+			, m_conflatedFrames()
+			, m_conflateScheduled(false)
+			, m_conflateNotifier(eventloop)
+			, m_conflateTimer(eventloop)
+			, m_receiveBuffer(new ReceiveBuffer(MAX_MESSAGE_SIZE, RECEIVE_CHUNK_SIZE))
+			, m_pathRegistry(new PathRegistry())
+			, m_callbackWorkers()
+			, m_responderLink(std::make_shared < detail::responderLink > (this))
+			, m_fetchTable(new FetchTable())
+			, m_frameDecoder(new ScanningFrameDecoder())
+			, m_telegramCount(0)
+			, m_decodeErrorCount(0)
+			, m_droppedFetchNotificationCount(0)
+			, m_droppedRequestCount(0)
+			, m_pendingRequests(new PendingRequests(eventloop))
+			, m_requestTimeout(0)
+			, m_connected(false)
+			, m_autoReconnect(false)
+			, m_reconnectMutex()
+			, m_reconnectMinDelay(0)
+			, m_reconnectMaxDelay(0)
+			, m_reconnectDelay(0)
+			, m_connectionCallback()
+			, m_reconnectNotifier(eventloop)
+			, m_reconnectTimer(eventloop)
+			, m_resumeQueue(std::make_shared < detail::resumeQueue > (&m_resumeNotifier))
+			, m_resumeNotifier(eventloop)
 		{
+			m_reconnectNotifier.set(std::bind(&PeerAsync::startReconnectTimer, this));
+			m_backpressureNotifier.set(std::bind(&PeerAsync::reportCongestion, this));
+			m_flushNotifier.set(std::bind(&PeerAsync::flushScheduled, this));
+			m_conflateNotifier.set(std::bind(&PeerAsync::sendConflatedScheduled, this));
+			m_resumeNotifier.set(std::bind(&PeerAsync::resumeScheduled, this));
 			// Compose json without indentation. This saves lots of bandwidth and time!
 			wBuilder.settings_["indentation"] = "";
 			start();
@@ -105,20 +523,41 @@ namespace hbk {
 
 		PeerAsync::~PeerAsync()
 		{
+			{
+				// Responders of deferred requests might outlive the peer. They must not use it anymore.
+				std::lock_guard < std::mutex > lck(m_responderLink->mtx);
+				m_responderLink->pPeer = nullptr;
+			}
 			stop();
+			std::unique_ptr < WorkerPool > workers;
+			{
+				// The eventloop might be processing received data right now. Wait for it before destructing the members used there.
+				std::lock_guard < std::mutex > lck(m_receiveMutex);
+				m_callbackWorkers.swap(workers);
+			}
+			if (workers) {
+				// Responses of callbacks queued can not be send anymore. Callbacks being executed are waited for without holding the lock.
+				workers->discard();
+				workers.reset();
+			}
 			{
 				// jet daemon automatically unregisters all fetches on disconnect we simply forget all known fetches
-				std::lock_guard < std::recursive_mutex > lock(m_mtx_fetchers);
-				m_fetchers.clear();
+				m_fetchTable->clear();
+			}
+			{
+				// Coroutines resumed from now on are resumed in the context completing their future.
+				std::lock_guard < std::mutex > lck(m_resumeQueue->mtx);
+				m_resumeQueue->pNotifier = nullptr;
 			}
+			// Coroutines posted but not resumed by the eventloop yet are not leaked.
+			resumeScheduled();
 		}
 
 		void PeerAsync::start()
 		{
 			// clear all buffers. Important for reconnect.
-			m_lengthBufferLevel = 0;
-			m_dataBuffer.clear();
-			m_dataBufferLevel = 0;
+			m_receiveBuffer->clear();
+			m_stopped = false;
 
 
 
@@ -152,39 +591,61 @@ namespace hbk {
 #endif
 			}
 			m_socket.setDataCb(std::bind(&PeerAsync::receive, this));
+			m_connected = true;
 
 			configAsync(m_name, m_debug);
-			{
-				// restore all known fetches
-				std::lock_guard < std::recursive_mutex > lock(m_mtx_fetchers);
-				for (const auto &iter: m_fetchers) {
-					const fetcher_t& fetcher = iter.second;
-					try {
-						restoreFetch(fetcher.matcher, iter.first);
-					} catch(const std::runtime_error& e) {
-						::syslog(LOG_ERR, "restoration of previous fetches failed ('%s')!", e.what());
-					} catch(...) {
-						::syslog(LOG_ERR, "restoration of previous fetches failed");
-					}
-				}
-			}
+			restoreRegistrations();
+			restoreFetches();
 		}
 
 		void PeerAsync::stop()
 		{
 			syslog(LOG_DEBUG, "jet peer '%s' %s:%u: Stopping...", m_name.c_str(), m_address.c_str(), m_port);
-			m_stopped = true;
+			{
+				std::lock_guard < std::mutex > lock(m_reconnectMutex);
+				m_stopped = true;
+				m_reconnectTimer.cancel();
+			}
 
-			m_socket.disconnect();
+			disconnect();
+
+			// all states and methods registered are to be removed!
+			m_pathRegistry->clear();
+		}
+
+		void PeerAsync::disconnect()
+		{
+			m_connected = false;
+			++m_connectionGeneration;
+			{
+				// Pending change notifications are lost with the connection
+				std::lock_guard < std::mutex > lock(m_conflateMutex);
+				m_conflatedCount = 0;
+				m_conflatedIndex.clear();
+				m_conflateScheduled = false;
+				m_conflateTimer.cancel();
+			}
+			{
+				// Collected and queued messages are lost with the connection.
+				// Nothing is to be queued between clearing the queue and closing the socket.
+				std::lock_guard < std::mutex > lock(m_sendMutex);
+				clearSendQueue();
+				m_socket.disconnect();
+				m_sendBuffer.clear();
+				m_flushScheduled = false;
+				m_flushTimer.cancel();
+			}
 
 			// Notify all fetchers
 			Json::Value empty;
 			{
-				std::lock_guard < std::recursive_mutex > lock(m_mtx_fetchers);
-				for (auto &iter: m_fetchers) {
-					fetchCallback_t& callback = iter.second.callback;
+				FetchTable::snapshot_t fetches = m_fetchTable->snapshot();
+				for (const auto &iter: *fetches) {
+					if (iter.id==0) {
+						continue;
+					}
 					try {
-						callback(empty, -1);
+						iter.fetcher->callback(empty, -1);
 					} catch(...)
 					{
 						// catch and ignore all exceptions
@@ -192,18 +653,7 @@ namespace hbk {
 				}
 			}
 
-			// all states and methods registered are to be removed!
-			{
-				std::lock_guard < std::recursive_mutex > lock(m_mtx_stateCallbacks);
-				m_stateCallbacks.clear();
-			}
-
-			{
-				std::lock_guard < std::recursive_mutex > lock(m_mtx_methodCallbacks);
-				m_methodCallbacks.clear();
-			}
-
-			size_t clearedRequestCount = AsyncRequest::clear();
+			size_t clearedRequestCount = m_pendingRequests->clear();
 			if (clearedRequestCount>0) {
 				::syslog(LOG_WARNING, "%zu open request(s) left on destruction of jet peer %s. All open requests have been canceled!", clearedRequestCount, m_address.c_str());
 			}
@@ -219,100 +669,278 @@ namespace hbk {
 			}
 		}
 
+		void PeerAsync::setAutoReconnect(std::chrono::milliseconds minDelay, std::chrono::milliseconds maxDelay, connectionCallback_t callback)
+		{
+			std::lock_guard < std::mutex > lock(m_reconnectMutex);
+			m_reconnectMinDelay = minDelay;
+			m_reconnectMaxDelay = std::max(minDelay, maxDelay);
+			m_connectionCallback = std::move(callback);
+			m_autoReconnect = (minDelay.count() > 0);
+		}
+
+		void PeerAsync::connectionLost()
+		{
+			if (!m_autoReconnect) {
+				stop();
+				return;
+			}
+
+			syslog(LOG_WARNING, "jet peer '%s' %s:%u: Lost connection, reconnecting...", m_name.c_str(), m_address.c_str(), m_port);
+			disconnect();
+			connectionCallback_t callback;
+			{
+				std::lock_guard < std::mutex > lock(m_reconnectMutex);
+				if (m_stopped) {
+					return;
+				}
+				m_reconnectDelay = m_reconnectMinDelay;
+				callback = m_connectionCallback;
+			}
+			m_reconnectNotifier.notify();
+			if (callback) {
+				try {
+					callback(false);
+				} catch(...) {
+				}
+			}
+		}
+
+		void PeerAsync::startReconnectTimer()
+		{
+			std::lock_guard < std::mutex > lock(m_reconnectMutex);
+			if (m_stopped) {
+				return;
+			}
+			m_reconnectTimer.set(m_reconnectDelay, false, std::bind(&PeerAsync::reconnect, this, std::placeholders::_1));
+		}
+
+		void PeerAsync::reconnect(bool fired)
+		{
+			if (!fired) {
+				return;
+			}
+
+			connectionCallback_t callback;
+			{
+				std::lock_guard < std::mutex > lock(m_reconnectMutex);
+				if (m_stopped) {
+					return;
+				}
+				try {
+					start();
+				} catch(const std::runtime_error& e) {
+					// try again later
+					syslog(LOG_DEBUG, "%s", e.what());
+					m_reconnectDelay = std::min(m_reconnectDelay * 2, m_reconnectMaxDelay);
+					m_reconnectNotifier.notify();
+					return;
+				}
+				callback = m_connectionCallback;
+			}
+			syslog(LOG_INFO, "jet peer '%s' %s:%u: Reconnected", m_name.c_str(), m_address.c_str(), m_port);
+			if (callback) {
+				try {
+					callback(true);
+				} catch(...) {
+				}
+			}
+		}
+
+		void PeerAsync::restoreRegistrations()
+		{
+			std::vector < PathRegistry::elementPtr_t > elements = m_pathRegistry->elements();
+			if (elements.empty()) {
+				return;
+			}
+
+			AsyncRequestBatch batch(*this);
+			for (const auto &element: elements) {
+				const std::string& path = element->path;
+				if (element->state) {
+					auto lambda = [this, path](const Json::Value& result)
+					{
+						if (result.isMember(jsonrpc::ERR)) {
+							syslog(LOG_ERR, "jet peer: Restoring state '%s' failed!", path.c_str());
+						}
+						addStateResultCb(result, path);
+					};
+					batch.add(ADD, element->state->getAddParams(), lambda);
+				}
+				if (element->isMethod()) {
+					auto lambda = [this, path](const Json::Value& result)
+					{
+						if (result.isMember(jsonrpc::ERR)) {
+							syslog(LOG_ERR, "jet peer: Restoring method '%s' failed!", path.c_str());
+						}
+						addMethodResultCb(result, path);
+					};
+					batch.add(ADD, element->methodParams, lambda);
+				}
+			}
+			batch.execute();
+		}
+
+		void PeerAsync::keepStateValue(const std::string& path, const Json::Value& value)
+		{
+			if (!m_autoReconnect) {
+				return;
+			}
+			PathRegistry::elementPtr_t element = m_pathRegistry->find(path);
+			if ((!element) || (!element->state)) {
+				return;
+			}
+			std::string serialized = Json::writeString(wBuilder, value);
+			std::lock_guard < std::mutex > lock(element->state->valueMtx);
+			element->state->value.swap(serialized);
+		}
+
+		void PeerAsync::keepChangedValue(const std::string& path, const std::string& telegram)
+		{
+			if (!m_autoReconnect) {
+				return;
+			}
+			PathRegistry::elementPtr_t element = m_pathRegistry->find(path);
+			if ((!element) || (!element->state)) {
+				return;
+			}
+			// the value follows the prefix composed when adding the state
+			size_t prefixLength = element->state->changePrefix.length();
+			if (telegram.length() <= prefixLength) {
+				return;
+			}
+			std::lock_guard < std::mutex > lock(element->state->valueMtx);
+			element->state->value.assign(telegram, prefixLength, std::string::npos);
+		}
+
 		int PeerAsync::receive()
 		{
 
 			std::lock_guard < std::mutex > lck(m_receiveMutex);
+			const ReceiveBuffer::telegramCallback_t telegramCallback = std::bind(&PeerAsync::processTelegram, this, std::placeholders::_1, std::placeholders::_2);
 
 			while (true) {
 				// Receive until error or EWOULDBLOCK. It is important to read from jet damon as fast possible.
-				while (m_lengthBufferLevel < sizeof(m_bigEndianLengthBuffer)) {
-					// read length information
-					uint8_t* plengthBuffer = reinterpret_cast < uint8_t* > (&m_bigEndianLengthBuffer);
-					ssize_t retVal = m_socket.receive(plengthBuffer+m_lengthBufferLevel, sizeof(m_bigEndianLengthBuffer)-m_lengthBufferLevel);
-					if (retVal<0) {
+				// Read as much as fits into the buffer. There is always room for at least RECEIVE_CHUNK_SIZE bytes.
+				ssize_t retVal = m_socket.receive(m_receiveBuffer->writePosition(), m_receiveBuffer->space());
+				if (retVal<0) {
 #ifdef _WIN32
-						int lastError = WSAGetLastError();
-						if ((lastError == WSAEWOULDBLOCK) || (lastError == ERROR_IO_PENDING)) {
+					int lastError = WSAGetLastError();
+					if ((lastError == WSAEWOULDBLOCK) || (lastError == ERROR_IO_PENDING)) {
 #else
-						if(errno == EWOULDBLOCK || errno == EAGAIN) {
+					if(errno == EWOULDBLOCK || errno == EAGAIN) {
 #endif
-							return 0;
-						}
-						syslog(LOG_ERR, "jet peer %s:%u: Error on receive '%s'", m_address.c_str(), m_port, strerror(errno));
-						stop();
-						return -1;
-					} else if (retVal == 0) {
-						syslog(LOG_DEBUG, "jet peer %s:%u: Connection closed", m_address.c_str(), m_port);
-						stop();
 						return 0;
 					}
-					m_lengthBufferLevel += static_cast < size_t > (retVal);
-
-					if (m_lengthBufferLevel == sizeof(m_bigEndianLengthBuffer)) {
-						// length information is complete: Prepare data buffer
-						size_t len = ntohl(m_bigEndianLengthBuffer);
-						if (len>MAX_MESSAGE_SIZE) {
-							syslog(LOG_ERR, "jet peer %s:%u: Received message size (%zu) exceeds maximum message size (%zu). Closing connection!", m_address.c_str(), m_port, len, MAX_MESSAGE_SIZE);
-							stop();
-							return -1;
-						}
-
-						m_dataBuffer.resize(len);
-					}
+					syslog(LOG_ERR, "jet peer %s:%u: Error on receive '%s'", m_address.c_str(), m_port, strerror(errno));
+					connectionLost();
+					return -1;
+				} else if (retVal == 0) {
+					syslog(LOG_DEBUG, "jet peer %s:%u: Connection closed", m_address.c_str(), m_port);
+					connectionLost();
+					return 0;
 				}
+				if (m_receiveBuffer->commit(static_cast < size_t > (retVal), telegramCallback)<0) {
+					syslog(LOG_ERR, "jet peer %s:%u: Received message size (%zu) exceeds maximum message size (%zu). Closing connection!", m_address.c_str(), m_port, m_receiveBuffer->announcedLength(), MAX_MESSAGE_SIZE);
+					connectionLost();
+					return -1;
+				}
+			}
+		}
 
-				while(m_dataBufferLevel<m_dataBuffer.size()) {
-					// length information is complete, proceed reading data
-					ssize_t retVal = m_socket.receive(m_dataBuffer.data()+m_dataBufferLevel, m_dataBuffer.size()-m_dataBufferLevel);
-					if(retVal<0) {
-#ifdef _WIN32
-						int lastError = WSAGetLastError();
-						if ((lastError == WSAEWOULDBLOCK) || (lastError == ERROR_IO_PENDING)) {
-#else
-						if(errno == EWOULDBLOCK || errno == EAGAIN) {
-#endif
-							return 0;
-						}
-						syslog(LOG_ERR, "jet peer %s:%u: Error on receive '%s'", m_address.c_str(), m_port, strerror(errno));
-						stop();
-						return -1;
-					} else if (retVal == 0) {
-						stop();
-						return 0;
+		void PeerAsync::processTelegram(const char* pTelegram, size_t len)
+		{
+			++m_telegramCount;
+			if (!m_frameDecoder->decode(pTelegram, len, *this, parseErrors)) {
+				++m_decodeErrorCount;
+				if (len <= 2048 ) {
+					// Don't put more into syslog!
+					// Most likely we are somewhat lost in the stream. Have also a binary dump to allow forensic analysis
+					std::stringstream binaryDump;
+					binaryDump << std::hex;
+					int binaryCharacter;
+
+					for(size_t index = 0; index<len; ++index) {
+						binaryCharacter = pTelegram[index];
+						binaryDump << binaryCharacter; //+= std::to_string(character);
+						binaryDump << " ";
 					}
-					m_dataBufferLevel += static_cast < size_t > (retVal);
+					syslog(LOG_ERR, "jet peer %s:%u: Error '%s' while parsing received telegram (%zu byte) %s", m_address.c_str(), m_port, parseErrors.c_str(), len, binaryDump.str().c_str());
+					syslog(LOG_ERR, "jet peer %s:%u: Error '%s' while parsing received telegram (%zu byte) '%.*s'", m_address.c_str(), m_port, parseErrors.c_str(), len, static_cast< int > (len), pTelegram);
+				} else {
+					syslog(LOG_ERR, "jet peer %s:%u: Error '%s' while parsing received telegram (%zu byte)", m_address.c_str(), m_port, parseErrors.c_str(), len);
 				}
+			}
+		}
 
-				// data package is complete. Process data and clear buffers.
-				Json::Value data;
-				// add space for the end to point to.
-				m_dataBuffer.push_back('\0');
-				if (m_reader->parse(m_dataBuffer.data(), &m_dataBuffer[m_dataBuffer.size()-1], &data, &parseErrors)) {
-					receiveCallback(data);
-				} else {
-					if (m_dataBuffer.size() <= 2048 ) {
-						// Don't put more into syslog!
-						// Most likely we are somewhat lost in the stream. Have also a binary dump to allow forensic analysis
-						std::stringstream binaryDump;
-						binaryDump << std::hex;
-						int binaryCharacter;
-
-						for(auto iter : m_dataBuffer) {
-							binaryCharacter = iter;
-							binaryDump << binaryCharacter; //+= std::to_string(character);
-							binaryDump << " ";
-						}
-						syslog(LOG_ERR, "jet peer %s:%u: Error '%s' while parsing received telegram (%zu byte) %s", m_address.c_str(), m_port, parseErrors.c_str(), m_dataBuffer.size(), binaryDump.str().c_str());
-						syslog(LOG_ERR, "jet peer %s:%u: Error '%s' while parsing received telegram (%zu byte) '%.*s'", m_address.c_str(), m_port, parseErrors.c_str(), m_dataBuffer.size(), static_cast< int > (m_dataBuffer.size()), m_dataBuffer.data());
-					} else {
-						syslog(LOG_ERR, "jet peer %s:%u: Error '%s' while parsing received telegram (%zu byte)", m_address.c_str(), m_port, parseErrors.c_str(), m_dataBuffer.size());
-					}
+		void PeerAsync::consumeMessage(const Json::Value& message)
+		{
+			receiveCallback(message);
+		}
+
+		bool PeerAsync::isFetchConsumed(fetchId_t fetchId)
+		{
+			if (!m_fetchTable->find(fetchId)) {
+				++m_droppedFetchNotificationCount;
+				return false;
+			}
+			return true;
+		}
+
+		bool PeerAsync::isRequestConsumed(const std::string& path)
+		{
+			if (m_pathRegistry->find(path)) {
+				return true;
+			}
+			++m_droppedRequestCount;
+			syslog(LOG_ERR, "jet peer: unknown request or notification '%s'", path.c_str());
+			return false;
+		}
+
+		receiveStatus_t PeerAsync::getReceiveStatus() const
+		{
+			receiveStatus_t status;
+			status.telegramCount = m_telegramCount;
+			status.decodeErrorCount = m_decodeErrorCount;
+			status.droppedFetchNotificationCount = m_droppedFetchNotificationCount;
+			status.droppedRequestCount = m_droppedRequestCount;
+			return status;
+		}
+
+		void PeerAsync::consumeFetchNotification(fetchId_t fetchId, const Json::Value& params)
+		{
+			// keeps the fetcher alive even if the fetch gets removed by the callback or by another thread
+			FetchTable::fetcherPtr_t fetcher = m_fetchTable->find(fetchId);
+			if (fetcher) {
+				try {
+					fetcher->callback(params, 0);
+				} catch(const std::runtime_error &e) {
+					syslog(LOG_ERR, "Fetch callback '%s' threw exception '%s'!", fetcher->matcher.print().c_str(), e.what());
+				} catch(...) {
+					syslog(LOG_ERR, "Fetch callback '%s' threw exception!", fetcher->matcher.print().c_str());
 				}
-				m_dataBuffer.clear();
-				m_lengthBufferLevel = 0;
-				m_dataBufferLevel = 0;
+			} else {
+				++m_droppedFetchNotificationCount;
+			}
+		}
+
+		void PeerAsync::setFrameDecoder(std::unique_ptr < FrameDecoder > frameDecoder)
+		{
+			std::lock_guard < std::mutex > lck(m_receiveMutex);
+			m_frameDecoder = std::move(frameDecoder);
+		}
+
+		void PeerAsync::setCallbackWorkers(unsigned int workerCount)
+		{
+			std::unique_ptr < WorkerPool > workers;
+			if (workerCount > 0) {
+				workers.reset(new WorkerPool(workerCount));
+			}
+			{
+				std::lock_guard < std::mutex > lck(m_receiveMutex);
+				m_callbackWorkers.swap(workers);
 			}
+			// Requests already queued are finished without holding the lock. A callback might issue a synchronous request, its response is received meanwhile.
+			workers.reset();
 		}
 
 		void PeerAsync::infoAsync(responseCallback_t resultCallback)
@@ -331,20 +959,20 @@ namespace hbk {
 			method.execute(*this, resultCallback);
 		}
 
-		void PeerAsync::callMethodAsync(const std::string& path, const Json::Value& args, responseCallback_t resultCb)
+		requestId_t PeerAsync::callMethodAsync(const std::string& path, const Json::Value& args, responseCallback_t resultCb)
 		{
 			Json::Value params;
-			callMethodAsyncPrivate(path, args, params, resultCb);
+			return callMethodAsyncPrivate(path, args, params, resultCb);
 		}
 
-		void PeerAsync::callMethodAsync(const std::string& path, const Json::Value& args, double timeout_s, responseCallback_t resultCb)
+		requestId_t PeerAsync::callMethodAsync(const std::string& path, const Json::Value& args, double timeout_s, responseCallback_t resultCb)
 		{
 			Json::Value params;
 			params[TIMEOUT] = timeout_s;
-			callMethodAsyncPrivate(path, args, params, resultCb);
+			return callMethodAsyncPrivate(path, args, params, resultCb);
 		}
 
-		void PeerAsync::callMethodAsyncPrivate(const std::string& path, const Json::Value& args, Json::Value& params, responseCallback_t resultCb)
+		requestId_t PeerAsync::callMethodAsyncPrivate(const std::string& path, const Json::Value& args, Json::Value& params, responseCallback_t resultCb)
 		{
 			params[PATH] = path;
 
@@ -352,7 +980,7 @@ namespace hbk {
 				params[ARGS] = args;
 			}
 			AsyncRequest method(CALL, params);
-			method.execute(*this, resultCb);
+			return method.execute(*this, resultCb);
 		}
 
 		void PeerAsync::addMethodAsync(const std::string& path, responseCallback_t resultCallback, methodCallback_t callback)
@@ -394,11 +1022,18 @@ namespace hbk {
 			addMethodAsyncPrivate(path, params, std::move(resultCallback), std::move(callback));
 		}
 
-		void PeerAsync::addMethodAsyncPrivate(const std::string& path, Json::Value& params, responseCallback_t resultCallback, methodCallback_t callback)
+		void PeerAsync::addDeferredMethodAsync(const std::string& path, double timeout_s, responseCallback_t resultCallback, deferredMethodCallback_t callback)
+		{
+			Json::Value params;
+			params[TIMEOUT] = timeout_s;
+			addMethodAsyncPrivate(path, params, std::move(resultCallback), methodCallback_t(), std::move(callback));
+		}
+
+		void PeerAsync::addMethodAsyncPrivate(const std::string& path, Json::Value& params, responseCallback_t resultCallback, methodCallback_t callback, deferredMethodCallback_t deferredCallback)
 		{
 			params[PATH] = path;
 
-			registerMethod(path, callback);
+			registerMethod(path, params, std::move(callback), std::move(deferredCallback));
 			AsyncRequest request(ADD, params);
 			if (!resultCallback) {
 				request.execute(*this);
@@ -431,22 +1066,22 @@ namespace hbk {
 			method.execute(*this, resultCallback);
 		}
 
-		void PeerAsync::addStateAsync(const std::string& path, const Json::Value& value, responseCallback_t resultCallback, stateCallback_t callback)
+		StateHandle PeerAsync::addStateAsync(const std::string& path, const Json::Value& value, responseCallback_t resultCallback, stateCallback_t callback)
 		{
 			Json::Value params;
-			addStateAsyncPrivate(path, value, params, resultCallback, callback);
+			return addStateAsyncPrivate(path, value, params, resultCallback, callback);
 		}
 
 
-		void PeerAsync::addStateAsync(const std::string& path, const Json::Value& value, double timeout_s, responseCallback_t resultCallback, stateCallback_t callback)
+		StateHandle PeerAsync::addStateAsync(const std::string& path, const Json::Value& value, double timeout_s, responseCallback_t resultCallback, stateCallback_t callback)
 		{
 			Json::Value params;
 			params[TIMEOUT] = timeout_s;
-			addStateAsyncPrivate(path, value, params, resultCallback, callback);
+			return addStateAsyncPrivate(path, value, params, resultCallback, callback);
 		}
 
-		void PeerAsync::addStateAsync(const std::string& path, const userGroups_t& fetchGroups, const userGroups_t& setGroups,
-		                              const Json::Value& value, double timeout_s, responseCallback_t resultCallback, stateCallback_t callback)
+		StateHandle PeerAsync::addStateAsync(const std::string& path, const userGroups_t& fetchGroups, const userGroups_t& setGroups,
+		                                     const Json::Value& value, double timeout_s, responseCallback_t resultCallback, stateCallback_t callback)
 		{
 			Json::Value params;
 			params[TIMEOUT] = timeout_s;
@@ -468,19 +1103,26 @@ namespace hbk {
 				params[ACCESS][SET_GROUPS] = groups;
 			}
 
-			addStateAsyncPrivate(path, value, params, resultCallback, callback);
+			return addStateAsyncPrivate(path, value, params, resultCallback, callback);
+		}
+
+		StateHandle PeerAsync::addDeferredStateAsync(const std::string& path, const Json::Value& value, double timeout_s, responseCallback_t resultCallback, deferredStateCallback_t callback)
+		{
+			Json::Value params;
+			params[TIMEOUT] = timeout_s;
+			return addStateAsyncPrivate(path, value, params, std::move(resultCallback), stateCallback_t(), std::move(callback));
 		}
 
-		void PeerAsync::addStateAsyncPrivate(const std::string& path, const Json::Value& value, Json::Value& params, responseCallback_t resultCallback, stateCallback_t callback)
+		StateHandle PeerAsync::addStateAsyncPrivate(const std::string& path, const Json::Value& value, Json::Value& params, responseCallback_t resultCallback, stateCallback_t callback, deferredStateCallback_t deferredCallback)
 		{
 			params[PATH] = path;
 			params[VALUE] = value;
-			if (!callback) {
+			if ((!callback) && (!deferredCallback)) {
 				params[FETCHONLY] = true;
 			}
 
 			AsyncRequest request(ADD, params);
-			registerState(path, std::move(callback));
+			StateHandle state(registerState(path, params, std::move(callback), std::move(deferredCallback)));
 			if (!resultCallback) {
 				request.execute(*this);
 			} else {
@@ -494,6 +1136,136 @@ namespace hbk {
 				};
 				request.execute(*this, lambda);
 			}
+			return state;
+		}
+
+		std::vector < StateHandle > PeerAsync::addStatesAsync(const std::vector < StateSpec >& states, batchResponseCallback_t resultCallback)
+		{
+			std::vector < std::shared_ptr < detail::stateEntry > > entries;
+			std::vector < StateHandle > handles;
+			// a path contained more than once is registered by its first occurrence only
+			std::vector < std::shared_ptr < detail::stateEntry > > registered;
+			std::vector < bool > duplicates;
+			std::unordered_set < std::string > paths;
+			entries.reserve(states.size());
+			handles.reserve(states.size());
+			registered.reserve(states.size());
+			duplicates.reserve(states.size());
+			for (const StateSpec& spec: states) {
+				Json::Value params;
+				params[PATH] = spec.path;
+				params[VALUE] = spec.value;
+				if (spec.timeout_s > 0.0) {
+					params[TIMEOUT] = spec.timeout_s;
+				}
+				if (!spec.callback) {
+					params[FETCHONLY] = true;
+				}
+				addGroups(params, FETCH_GROUPS, spec.fetchGroups);
+				addGroups(params, SET_GROUPS, spec.setGroups);
+				// escaping the path is done once here and not on each notification
+				entries.push_back(std::make_shared < detail::stateEntry > (spec.path, params, spec.callback));
+				handles.push_back(StateHandle(entries.back()));
+				duplicates.push_back(!paths.insert(spec.path).second);
+				if (duplicates.back()) {
+					entries.back()->registered = false;
+				} else {
+					registered.push_back(entries.back());
+				}
+			}
+			m_pathRegistry->add(registered, std::vector < PathRegistry::MethodEntry > ());
+
+			if ((states.empty()) && (resultCallback)) {
+				post(std::bind(resultCallback, std::vector < JsonRpcResponseObject > ()));
+				return handles;
+			}
+
+			std::shared_ptr < batchResponses > responses;
+			if (resultCallback) {
+				responses = std::make_shared < batchResponses > (states.size(), std::move(resultCallback));
+			}
+			AsyncRequestBatch batch(*this);
+			for (size_t index = 0; index < entries.size(); ++index) {
+				if (duplicates[index]) {
+					if (responses) {
+						post(std::bind(&batchResponses::complete, responses, index, duplicatePathError(entries[index]->path)));
+					}
+					continue;
+				}
+				responseCallback_t lambda;
+				if (responses) {
+					const std::string& path = entries[index]->path;
+					lambda = [this, path, responses, index](const Json::Value& result)
+					{
+						addStateResultCb(result, path);
+						responses->complete(index, result);
+					};
+				}
+				batch.add(ADD, entries[index]->addParams, lambda);
+			}
+			batch.execute();
+			return handles;
+		}
+
+		void PeerAsync::addMethodsAsync(const std::vector < MethodSpec >& methods, batchResponseCallback_t resultCallback)
+		{
+			std::vector < PathRegistry::MethodEntry > entries;
+			// a path contained more than once is registered by its first occurrence only
+			std::vector < bool > duplicates;
+			std::unordered_set < std::string > paths;
+			entries.reserve(methods.size());
+			duplicates.reserve(methods.size());
+			for (const MethodSpec& spec: methods) {
+				PathRegistry::MethodEntry entry;
+				entry.path = spec.path;
+				entry.callback = spec.callback;
+				entry.params[PATH] = spec.path;
+				if (spec.timeout_s > 0.0) {
+					entry.params[TIMEOUT] = spec.timeout_s;
+				}
+				addGroups(entry.params, FETCH_GROUPS, spec.fetchGroups);
+				addGroups(entry.params, CALL_GROUPS, spec.callGroups);
+				entries.push_back(std::move(entry));
+				duplicates.push_back(!paths.insert(spec.path).second);
+			}
+			std::vector < PathRegistry::MethodEntry > registered;
+			registered.reserve(entries.size());
+			for (size_t index = 0; index < entries.size(); ++index) {
+				if (!duplicates[index]) {
+					registered.push_back(entries[index]);
+				}
+			}
+			m_pathRegistry->add(std::vector < std::shared_ptr < detail::stateEntry > > (), registered);
+
+			if ((methods.empty()) && (resultCallback)) {
+				post(std::bind(resultCallback, std::vector < JsonRpcResponseObject > ()));
+				return;
+			}
+
+			std::shared_ptr < batchResponses > responses;
+			if (resultCallback) {
+				responses = std::make_shared < batchResponses > (methods.size(), std::move(resultCallback));
+			}
+			AsyncRequestBatch batch(*this);
+			for (size_t index = 0; index < entries.size(); ++index) {
+				if (duplicates[index]) {
+					if (responses) {
+						post(std::bind(&batchResponses::complete, responses, index, duplicatePathError(entries[index].path)));
+					}
+					continue;
+				}
+				responseCallback_t lambda;
+				if (responses) {
+					const std::string& path = entries[index].path;
+					lambda = [this, path, responses, index](const Json::Value& result)
+					{
+						addMethodResultCb(result, path);
+						responses->complete(index, result);
+					};
+				}
+				batch.add(ADD, entries[index].params, lambda);
+			}
+			batch.execute();
 		}
 
 		void PeerAsync::removeStateAsync(const std::string& path, responseCallback_t resultCb)
@@ -511,16 +1283,22 @@ namespace hbk {
 			method.execute(*this, std::move(resultCb));
 		}
 
+		bool PeerAsync::isRestoredLater() const
+		{
+			// requests failing due to the lost connection. The element is added again after reconnecting.
+			return m_autoReconnect && (!m_connected);
+		}
+
 		void PeerAsync::addMethodResultCb(const Json::Value& result, const std::string& path)
 		{
-			if (result.isMember(jsonrpc::ERR)) {
+			if ((result.isMember(jsonrpc::ERR)) && (!isRestoredLater())) {
 				unregisterMethod(path);
 			}
 		}
 
 		void PeerAsync::addStateResultCb(const Json::Value& result, const std::string& path)
 		{
-			if (result.isMember(jsonrpc::ERR)) {
+			if ((result.isMember(jsonrpc::ERR)) && (!isRestoredLater())) {
 				unregisterState(path);
 			}
 		}
@@ -532,69 +1310,137 @@ namespace hbk {
 			}
 		}
 
-
-		void PeerAsync::registerFetch(fetchId_t fetchId, const fetcher_t& fetcher)
+
+		fetchId_t PeerAsync::registerFetch(const fetcher_t& fetcher)
+		{
+			return m_fetchTable->add(fetcher);
+		}
+
+		void PeerAsync::registerMethod(const std::string& path, const Json::Value& params, methodCallback_t callback, deferredMethodCallback_t deferredCallback)
+		{
+			m_pathRegistry->addMethod(path, callback, deferredCallback, params);
+		}
+
+		std::shared_ptr < const detail::stateEntry > PeerAsync::registerState(const std::string& path, const Json::Value& params, stateCallback_t callback, deferredStateCallback_t deferredCallback)
+		{
+			// escaping the path is done once here and not on each notification
+			std::shared_ptr < detail::stateEntry > entry = std::make_shared < detail::stateEntry > (path, params, std::move(callback), std::move(deferredCallback));
+			m_pathRegistry->addState(entry);
+			return entry;
+		}
+
+		void PeerAsync::unregisterFetch(fetchId_t fetchId)
+		{
+			m_fetchTable->erase(fetchId);
+		}
+
+		void PeerAsync::unregisterMethod(const std::string& path)
+		{
+			m_pathRegistry->eraseMethod(path);
+		}
+
+		void PeerAsync::unregisterState(const std::string& path)
+		{
+			m_pathRegistry->eraseState(path);
+			// a change notification must not follow the removal of the state
+			dropConflated(path);
+		}
+
+
+		requestId_t PeerAsync::setStateValueAsync(const std::string& path, const Json::Value& value, responseCallback_t resultCallback)
+		{
+			Json::Value params;
+			return setStateValueAsyncPrivate(path, value, params, std::move(resultCallback));
+		}
+
+		requestId_t PeerAsync::setStateValueAsync(const std::string& path, const Json::Value& value, double timeout_s, responseCallback_t resultCallback)
+		{
+			Json::Value params;
+			params[TIMEOUT] = timeout_s;
+			return setStateValueAsyncPrivate(path, value, params, std::move(resultCallback));
+		}
+
+		requestId_t PeerAsync::setStateValueAsyncPrivate(const std::string& path, const Json::Value& value, Json::Value& params, responseCallback_t resultCallback)
+		{
+			params[PATH] = path;
+			params[VALUE] = value;
+
+			AsyncRequest method(SET, params);
+			return method.execute(*this, resultCallback);
+		}
+
+		void PeerAsync::resumeScheduled()
 		{
-			std::lock_guard < std::recursive_mutex > lock(m_mtx_fetchers);
-			m_fetchers[fetchId] = fetcher;
+			std::deque < std::function < void() > > jobs = m_resumeQueue->take();
+			for (std::function < void() >& job : jobs) {
+				job();
+			}
 		}
 
-		void PeerAsync::registerMethod(const std::string& path, methodCallback_t callback)
+		void PeerAsync::post(std::function < void() > job)
 		{
-			std::lock_guard < std::recursive_mutex > lock(m_mtx_methodCallbacks);
-			m_methodCallbacks[path] = callback;
+			m_resumeQueue->post(std::move(job));
 		}
 
-		void PeerAsync::registerState(const std::string& path, stateCallback_t callback)
+		Promise < JsonRpcResponseObject > PeerAsync::createPromise() const
 		{
-			std::lock_guard < std::recursive_mutex > lock(m_mtx_stateCallbacks);
-			m_stateCallbacks[path] = callback;
+			Promise < JsonRpcResponseObject > promise;
+			std::shared_ptr < detail::resumeQueue > queue = m_resumeQueue;
+			promise.setExecutor([queue](std::function < void() > job)
+			{
+				queue->post(std::move(job));
+			});
+			return promise;
 		}
 
-		void PeerAsync::unregisterFetch(fetchId_t fetchId)
+		/// \return response callback that delivers the response to the future of the promise
+		static responseCallback_t fulfill(Promise < JsonRpcResponseObject > promise)
 		{
-			std::lock_guard < std::recursive_mutex > lock(m_mtx_fetchers);
-			m_fetchers.erase(fetchId);
+			return [promise](const JsonRpcResponseObject& response) mutable
+			{
+				promise.setValue(response);
+			};
 		}
 
-		void PeerAsync::unregisterMethod(const std::string& path)
+		ResponseFuture PeerAsync::callMethod(const std::string& path, const Json::Value& args, double timeout_s)
 		{
-			std::lock_guard < std::recursive_mutex > lock(m_mtx_methodCallbacks);
-			m_methodCallbacks.erase(path);
+			Promise < JsonRpcResponseObject > promise = createPromise();
+			callMethodAsync(path, args, timeout_s, fulfill(promise));
+			return promise.getFuture();
 		}
 
-		void PeerAsync::unregisterState(const std::string& path)
+		ResponseFuture PeerAsync::setStateValue(const std::string& path, const Json::Value& value, double timeout_s)
 		{
-			std::lock_guard < std::recursive_mutex > lock(m_mtx_stateCallbacks);
-			m_stateCallbacks.erase(path);
+			Promise < JsonRpcResponseObject > promise = createPromise();
+			setStateValueAsync(path, value, timeout_s, fulfill(promise));
+			return promise.getFuture();
 		}
 
-
-		void PeerAsync::setStateValueAsync(const std::string& path, const Json::Value& value, responseCallback_t resultCallback)
+		ResponseFuture PeerAsync::get(const matcher_t& match)
 		{
-			Json::Value params;
-			setStateValueAsyncPrivate(path, value, params, std::move(resultCallback));
+			Promise < JsonRpcResponseObject > promise = createPromise();
+			getAsync(match, fulfill(promise));
+			return promise.getFuture();
 		}
 
-		void PeerAsync::setStateValueAsync(const std::string& path, const Json::Value& value, double timeout_s, responseCallback_t resultCallback)
+		ResponseFuture PeerAsync::addFetch(const matcher_t& match, fetchCallback_t callback, fetchId_t* pFetchId)
 		{
-			Json::Value params;
-			params[TIMEOUT] = timeout_s;
-			setStateValueAsyncPrivate(path, value, params, std::move(resultCallback));
+			Promise < JsonRpcResponseObject > promise = createPromise();
+			fetchId_t fetchId = addFetchAsync(match, std::move(callback), fulfill(promise));
+			if (pFetchId) {
+				*pFetchId = fetchId;
+			}
+			return promise.getFuture();
 		}
 
-		void PeerAsync::setStateValueAsyncPrivate(const std::string& path, const Json::Value& value, Json::Value& params, responseCallback_t resultCallback)
+		void PeerAsync::setRequestTimeout(std::chrono::milliseconds timeout)
 		{
-			params[PATH] = path;
-			params[VALUE] = value;
-
-			AsyncRequest method(SET, params);
-			method.execute(*this, resultCallback);
+			m_requestTimeout = timeout.count();
 		}
 
-		fetchId_t PeerAsync::createFetchId()
+		int PeerAsync::cancelRequest(requestId_t requestId)
 		{
-			return ++m_sfetchId;
+			return m_pendingRequests->cancel(requestId);
 		}
 
 		void PeerAsync::authenticateAsync(const std::string& user, const std::string& password, responseCallback_t resultCallback)
@@ -635,23 +1481,22 @@ namespace hbk {
 			}
 		}
 
-		void PeerAsync::getAsync(const matcher_t& match, responseCallback_t resultCallback)
+		requestId_t PeerAsync::getAsync(const matcher_t& match, responseCallback_t resultCallback)
 		{
 			Json::Value params;
 			addPathInformation(params, match);
 
 			AsyncRequest request(GET, params);
-			request.execute(*this, resultCallback);
+			return request.execute(*this, resultCallback);
 		}
 
 		fetchId_t PeerAsync::addFetchAsync(const matcher_t& match, fetchCallback_t callback, responseCallback_t resultCb)
 		{
 			Json::Value params;
-			fetchId_t fetchId = createFetchId();
+			fetchId_t fetchId = registerFetch(fetcher_t(std::move(callback), match));
 			params[jsonrpc::ID] = fetchId;
 			addPathInformation(params, match);
 
-			registerFetch(fetchId, fetcher_t(std::move(callback), match));
 			AsyncRequest request(FETCH, params);
 			if (!resultCb) {
 				request.execute(*this);
@@ -672,14 +1517,37 @@ namespace hbk {
 			return fetchId;
 		}
 
-		void PeerAsync::restoreFetch(const matcher_t& match, fetchId_t fetchId)
+		void PeerAsync::restoreFetches()
 		{
-			Json::Value params;
-			params[jsonrpc::ID] = fetchId;
-			addPathInformation(params, match);
+			FetchTable::snapshot_t fetches = m_fetchTable->snapshot();
+			AsyncRequestBatch batch(*this);
+			for (const auto &iter: *fetches) {
+				if (iter.id==0) {
+					continue;
+				}
+				fetchId_t fetchId = iter.id;
+				fetchCallback_t callback = iter.fetcher->callback;
+				auto lambda = [this, fetchId, callback](const Json::Value& result)
+				{
+					// Timeouts, stop() and a lost connection keep the fetch. It is restored again when resuming or reconnecting.
+					if ((!result.isMember(jsonrpc::ERR)) || (PendingRequests::isLocalError(result))) {
+						return;
+					}
+					::syslog(LOG_ERR, "jet peer: Restoring fetch %d failed!", fetchId);
+					unregisterFetch(fetchId);
+					// the fetch is gone for good, the fetcher gets the error response
+					try {
+						callback(result, -1);
+					} catch(...) {
+					}
+				};
 
-			AsyncRequest request(FETCH, params);
-			request.execute(*this, responseCallback_t());
+				Json::Value params;
+				params[jsonrpc::ID] = fetchId;
+				addPathInformation(params, iter.fetcher->matcher);
+				batch.add(FETCH, params, lambda);
+			}
+			batch.execute();
 		}
 
 		void PeerAsync::removeFetchAsync(fetchId_t fetchId, responseCallback_t resultCb)
@@ -695,11 +1563,14 @@ namespace hbk {
 
 		void PeerAsync::sendMessage(const Json::Value& value)
 		{
-			int result;
-			
-			
 			std::string msg = Json::writeString(wBuilder, value);
-			size_t len = msg.length();
+			sendPayload(msg.c_str(), msg.length());
+		}
+
+		void PeerAsync::sendPayload(const char* pPayload, size_t len)
+		{
+			int result;
+
 			if (len>MAX_MESSAGE_SIZE) {
 				std::string errorMsg;
 				errorMsg = "Message size " + std::to_string(len) + " exceeds maximum message size (" + std::to_string(MAX_MESSAGE_SIZE) + ") and will not be send!";
@@ -707,15 +1578,21 @@ namespace hbk {
 				throw hbk::exception::jsonrpcException(-1, errorMsg);
 			}
 			uint32_t lenBig = htonl(static_cast < uint32_t > (len));
-			communication::dataBlock_t dataBlocks[] = {
-				{ &lenBig, sizeof(lenBig) },
-				{ msg.c_str(), msg.length()},
-			};
 
 			{
 				// synchronize sending complete message!!!
 				std::lock_guard < std::mutex > lock(m_sendMutex);
-				result = static_cast < int > (m_socket.sendBlocks(dataBlocks, sizeof(dataBlocks)/sizeof(communication::dataBlock_t), false));
+				if (m_corked) {
+					m_sendBuffer.append(reinterpret_cast < const char* > (&lenBig), sizeof(lenBig));
+					m_sendBuffer.append(pPayload, len);
+					result = collect();
+				} else {
+					communication::dataBlock_t dataBlocks[] = {
+						{ &lenBig, sizeof(lenBig) },
+						{ pPayload, len},
+					};
+					result = writeBlocks(dataBlocks, sizeof(dataBlocks)/sizeof(communication::dataBlock_t));
+				}
 			}
 			if (result < 0) {
 				std::string msg;
@@ -725,6 +1602,440 @@ namespace hbk {
 			}
 		}
 
+		/// reused for all notifications of this thread. Capacity is kept, hence there is no allocation after warming up.
+		static thread_local std::string changeTelegram;
+
+		std::string& PeerAsync::startChangeNotification(const std::string& path, bool& conflated)
+		{
+			PathRegistry::elementPtr_t element = m_pathRegistry->find(path);
+			if ((element) && (element->state)) {
+				return startChangeNotification(*element->state, conflated);
+			}
+			// not registered by this peer
+			conflated = m_conflateAll;
+			changeTelegram = telegramWriter::composeChangePrefix(path);
+			return changeTelegram;
+		}
+
+		std::string& PeerAsync::startChangeNotification(const detail::stateEntry& state, bool& conflated)
+		{
+			conflated = m_conflateAll || state.conflated;
+			changeTelegram = state.changePrefix;
+			return changeTelegram;
+		}
+
+		int PeerAsync::finishChangeNotification(std::string& telegram, const std::string& path, bool conflated)
+		{
+			keepChangedValue(path, telegram);
+			telegram += "}}";
+			try {
+				if (conflated) {
+					conflateChange(path, telegram);
+				} else {
+					sendPayload(telegram.c_str(), telegram.length());
+				}
+			} catch(...) {
+				return -1;
+			}
+			return 0;
+		}
+
+		void PeerAsync::conflateChange(const std::string& path, std::string& telegram)
+		{
+			if (telegram.length()>MAX_MESSAGE_SIZE) {
+				// refused with the usual error
+				sendPayload(telegram.c_str(), telegram.length());
+			}
+
+			std::lock_guard < std::mutex > lock(m_conflateMutex);
+			auto result = m_conflatedIndex.emplace(path, m_conflatedCount);
+			if (result.second) {
+				if (m_conflatedCount==m_conflatedChanges.size()) {
+					m_conflatedChanges.emplace_back();
+				}
+				++m_conflatedCount;
+			}
+			// no copy, the caller keeps the buffer of the replaced change notification
+			m_conflatedChanges[result.first->second].swap(telegram);
+
+			if (!m_conflateScheduled) {
+				m_conflateScheduled = true;
+				if (m_conflateInterval.count()==0) {
+					m_conflateNotifier.notify();
+				} else {
+					m_conflateTimer.set(m_conflateInterval, false, [this](bool fired) {
+						if (fired) {
+							sendConflatedScheduled();
+						}
+					});
+				}
+			}
+		}
+
+		void PeerAsync::dropConflated(const std::string& path)
+		{
+			std::lock_guard < std::mutex > lock(m_conflateMutex);
+			const auto iter = m_conflatedIndex.find(path);
+			if (iter != m_conflatedIndex.cend()) {
+				m_conflatedChanges[iter->second].clear();
+			}
+		}
+
+		int PeerAsync::sendConflated()
+		{
+			std::lock_guard < std::mutex > conflateLock(m_conflateMutex);
+			if (m_conflateScheduled) {
+				// sent now, following change notifications need to schedule again
+				m_conflateScheduled = false;
+				m_conflateTimer.cancel();
+			}
+			if (m_conflatedCount==0) {
+				return 0;
+			}
+
+			m_conflatedFrames.clear();
+			for (size_t index = 0; index < m_conflatedCount; ++index) {
+				const std::string& telegram = m_conflatedChanges[index];
+				if (telegram.empty()) {
+					// dropped
+					continue;
+				}
+				uint32_t lenBig = htonl(static_cast < uint32_t > (telegram.length()));
+				m_conflatedFrames.append(reinterpret_cast < const char* > (&lenBig), sizeof(lenBig));
+				m_conflatedFrames.append(telegram);
+			}
+			m_conflatedCount = 0;
+			m_conflatedIndex.clear();
+			if (m_conflatedFrames.empty()) {
+				return 0;
+			}
+
+			// Still holding m_conflateMutex. Otherwise a later value of a state might overtake this one.
+			std::lock_guard < std::mutex > sendLock(m_sendMutex);
+			if (m_corked) {
+				m_sendBuffer.append(m_conflatedFrames);
+				return collect();
+			}
+			communication::dataBlock_t dataBlock = { m_conflatedFrames.data(), m_conflatedFrames.size() };
+			return writeBlocks(&dataBlock, 1);
+		}
+
+		void PeerAsync::sendConflatedScheduled()
+		{
+			if (sendConflated() < 0) {
+				syslog(LOG_ERR, "jet peer %s:%u: could not send conflated change notifications: '%s'", m_address.c_str(), m_port, strerror(errno));
+			}
+		}
+
+		void PeerAsync::conflate(std::chrono::milliseconds interval)
+		{
+			{
+				std::lock_guard < std::mutex > lock(m_conflateMutex);
+				m_conflateInterval = interval;
+			}
+			m_conflateAll = true;
+		}
+
+		void PeerAsync::unconflate()
+		{
+			m_conflateAll = false;
+			{
+				std::lock_guard < std::mutex > lock(m_conflateMutex);
+				m_conflateInterval = std::chrono::milliseconds(0);
+			}
+			if (sendConflated() < 0) {
+				syslog(LOG_ERR, "jet peer %s:%u: could not send conflated change notifications: '%s'", m_address.c_str(), m_port, strerror(errno));
+			}
+		}
+
+		int PeerAsync::conflate(const StateHandle& state, bool enable)
+		{
+			if (!state.isRegistered()) {
+				return -1;
+			}
+			PathRegistry::elementPtr_t element = m_pathRegistry->find(state.m_entry->path);
+			if ((!element) || (element->state != state.m_entry)) {
+				return -1;
+			}
+			element->state->conflated = enable;
+			if ((!enable) && (sendConflated() < 0)) {
+				syslog(LOG_ERR, "jet peer %s:%u: could not send conflated change notifications: '%s'", m_address.c_str(), m_port, strerror(errno));
+			}
+			return 0;
+		}
+
+		void PeerAsync::appendChangeValue(std::string& telegram, bool value)
+		{
+			telegramWriter::appendBool(telegram, value);
+		}
+
+		void PeerAsync::appendChangeValue(std::string& telegram, int64_t value)
+		{
+			telegramWriter::appendInt(telegram, value);
+		}
+
+		void PeerAsync::appendChangeValue(std::string& telegram, uint64_t value)
+		{
+			telegramWriter::appendUInt(telegram, value);
+		}
+
+		void PeerAsync::appendChangeValue(std::string& telegram, double value)
+		{
+			telegramWriter::appendDouble(telegram, value);
+		}
+
+		void PeerAsync::appendChangeValue(std::string& telegram, const char* pString, size_t len)
+		{
+			telegramWriter::appendString(telegram, pString, len);
+		}
+
+		void PeerAsync::appendChangeValue(std::string& telegram, const Json::Value& value)
+		{
+			telegram += Json::writeString(wBuilder, value);
+		}
+
+		int PeerAsync::sendCollected()
+		{
+			if (m_flushScheduled) {
+				// sent now, following messages need to schedule again
+				m_flushScheduled = false;
+				m_flushTimer.cancel();
+			}
+			if (m_sendBuffer.empty()) {
+				return 0;
+			}
+			communication::dataBlock_t dataBlock = { m_sendBuffer.data(), m_sendBuffer.size() };
+			int result = writeBlocks(&dataBlock, 1);
+			// keep the capacity for the next messages to collect
+			m_sendBuffer.clear();
+			return result;
+		}
+
+		void PeerAsync::cork(std::chrono::microseconds window)
+		{
+			std::lock_guard < std::mutex > lock(m_sendMutex);
+			m_corkWindow = std::chrono::duration_cast < std::chrono::milliseconds > (window + std::chrono::microseconds(999));
+			m_corked = true;
+		}
+
+		void PeerAsync::uncork()
+		{
+			std::lock_guard < std::mutex > lock(m_sendMutex);
+			m_corked = false;
+			if (sendCollected() < 0) {
+				syslog(LOG_ERR, "jet peer %s:%u: could not send collected messages: '%s'", m_address.c_str(), m_port, strerror(errno));
+			}
+		}
+
+		int PeerAsync::writeBlocks(const communication::dataBlock_t* pBlocks, size_t blockCount)
+		{
+			size_t written = 0;
+			if (m_sendQueuePos==m_sendQueue.size()) {
+				// Nothing queued, try to write directly. Otherwise we would overtake the queued messages.
+#ifdef _WIN32
+				// No way to write without blocking here. hbk writes everything, hence nothing is queued.
+				if (m_socket.sendBlocks(pBlocks, blockCount, false) < 0) {
+					return -1;
+				}
+				return 0;
+#else
+				static const size_t MAX_BLOCK_COUNT = 4;
+				struct iovec iovs[MAX_BLOCK_COUNT];
+				size_t iovCount = 0;
+				for (; (iovCount < blockCount) && (iovCount < MAX_BLOCK_COUNT); ++iovCount) {
+					iovs[iovCount].iov_base = const_cast < void* > (pBlocks[iovCount].pData);
+					iovs[iovCount].iov_len = pBlocks[iovCount].size;
+				}
+				struct msghdr message;
+				memset(&message, 0, sizeof(message));
+				message.msg_iov = iovs;
+				message.msg_iovlen = iovCount;
+				ssize_t result = ::sendmsg(m_socket.getEvent(), &message, MSG_DONTWAIT | MSG_NOSIGNAL);
+				if (result < 0) {
+					if ((errno!=EAGAIN) && (errno!=EWOULDBLOCK) && (errno!=EINTR)) {
+						return -1;
+					}
+					result = 0;
+				}
+				written = static_cast < size_t > (result);
+#endif
+			}
+
+			// queue the rest
+			size_t queued = 0;
+			for (size_t blockIndex = 0; blockIndex < blockCount; ++blockIndex) {
+				const communication::dataBlock_t& block = pBlocks[blockIndex];
+				if (written >= block.size) {
+					written -= block.size;
+					continue;
+				}
+				m_sendQueue.append(static_cast < const char* > (block.pData) + written, block.size - written);
+				queued += block.size - written;
+				written = 0;
+			}
+			if (queued==0) {
+				return 0;
+			}
+
+			size_t queuedBytes = m_sendQueue.size() - m_sendQueuePos;
+			if (queuedBytes==queued) {
+				// queue was empty before
+				m_eventLoop.addOutEvent(m_socket.getEvent(), std::bind(&PeerAsync::drainSendQueue, this));
+			}
+			m_sendQueueStatus.queuedBytes = queuedBytes;
+			m_sendQueueStatus.totalQueuedBytes += queued;
+			if (queuedBytes > m_sendQueueStatus.maxQueuedBytes) {
+				m_sendQueueStatus.maxQueuedBytes = queuedBytes;
+			}
+			if ((!m_sendQueueStatus.congested) && (queuedBytes > m_highWatermark)) {
+				m_sendQueueStatus.congested = true;
+				++m_sendQueueStatus.congestionCount;
+				// Not called here, the sender might hold locks the callback needs.
+				m_backpressureNotifier.notify();
+			}
+			return 0;
+		}
+
+		int PeerAsync::drainSendQueue()
+		{
+			std::lock_guard < std::mutex > lock(m_sendMutex);
+			size_t queuedBytes = m_sendQueue.size() - m_sendQueuePos;
+			if (queuedBytes==0) {
+				return 0;
+			}
+#ifdef _WIN32
+			ssize_t result = m_socket.sendBlock(m_sendQueue.data() + m_sendQueuePos, queuedBytes, false);
+#else
+			ssize_t result = ::send(m_socket.getEvent(), m_sendQueue.data() + m_sendQueuePos, queuedBytes, MSG_DONTWAIT | MSG_NOSIGNAL);
+#endif
+			if (result < 0) {
+				if ((errno==EAGAIN) || (errno==EWOULDBLOCK) || (errno==EINTR)) {
+					return 0;
+				}
+				syslog(LOG_ERR, "jet peer %s:%u: could not send queued messages: '%s'", m_address.c_str(), m_port, strerror(errno));
+				clearSendQueue();
+				return 0;
+			}
+
+			m_sendQueuePos += static_cast < size_t > (result);
+			queuedBytes -= static_cast < size_t > (result);
+			if (queuedBytes==0) {
+				clearSendQueue();
+				return 0;
+			}
+			if (m_sendQueuePos >= queuedBytes) {
+				// Sent part is larger than the rest. Moving the rest to the front is cheap enough.
+				m_sendQueue.erase(0, m_sendQueuePos);
+				m_sendQueuePos = 0;
+			}
+			m_sendQueueStatus.queuedBytes = queuedBytes;
+			if ((m_sendQueueStatus.congested) && (queuedBytes <= m_lowWatermark)) {
+				m_sendQueueStatus.congested = false;
+				m_backpressureNotifier.notify();
+			}
+			return 0;
+		}
+
+		void PeerAsync::clearSendQueue()
+		{
+			if (m_sendQueuePos!=m_sendQueue.size()) {
+				m_eventLoop.eraseOutEvent(m_socket.getEvent());
+			}
+			// keep the capacity for the next messages to queue
+			m_sendQueue.clear();
+			m_sendQueuePos = 0;
+			m_sendQueueStatus.queuedBytes = 0;
+			if (m_sendQueueStatus.congested) {
+				m_sendQueueStatus.congested = false;
+				m_backpressureNotifier.notify();
+			}
+		}
+
+		void PeerAsync::reportCongestion()
+		{
+			bool congested;
+			backpressureCallback_t callback;
+			{
+				std::lock_guard < std::mutex > lock(m_sendMutex);
+				congested = m_sendQueueStatus.congested;
+				if (congested==m_reportedCongestion) {
+					return;
+				}
+				m_reportedCongestion = congested;
+				callback = m_backpressureCallback;
+			}
+			if (callback) {
+				try {
+					callback(congested);
+				} catch(...) {
+					// catch and ignore everything!
+				}
+			}
+		}
+
+		void PeerAsync::setSendQueueWatermarks(size_t lowWatermark, size_t highWatermark, backpressureCallback_t callback)
+		{
+			std::lock_guard < std::mutex > lock(m_sendMutex);
+			m_lowWatermark = lowWatermark;
+			m_highWatermark = highWatermark;
+			m_backpressureCallback = std::move(callback);
+		}
+
+		bool PeerAsync::isCongested() const
+		{
+			std::lock_guard < std::mutex > lock(m_sendMutex);
+			return m_sendQueueStatus.congested;
+		}
+
+		sendQueueStatus_t PeerAsync::getSendQueueStatus() const
+		{
+			std::lock_guard < std::mutex > lock(m_sendMutex);
+			return m_sendQueueStatus;
+		}
+
+		int PeerAsync::collect()
+		{
+			if (m_sendBuffer.size() >= MAX_MESSAGE_SIZE) {
+				return sendCollected();
+			}
+			if (!m_flushScheduled) {
+				m_flushScheduled = true;
+				if (m_corkWindow.count()==0) {
+					m_flushNotifier.notify();
+				} else {
+					m_flushTimer.set(m_corkWindow, false, [this](bool fired) {
+						if (fired) {
+							flushScheduled();
+						}
+					});
+				}
+			}
+			return 0;
+		}
+
+		void PeerAsync::flush()
+		{
+			int result = sendConflated();
+			if (result >= 0) {
+				std::lock_guard < std::mutex > lock(m_sendMutex);
+				result = sendCollected();
+			}
+			if (result < 0) {
+				std::string msg;
+				msg = std::string("could not send collected messages: '") + strerror(errno) + "'";
+				syslog(LOG_ERR, "%s", msg.c_str());
+				throw hbk::exception::jsonrpcException(-1, msg);
+			}
+		}
+
+		void PeerAsync::flushScheduled()
+		{
+			std::lock_guard < std::mutex > lock(m_sendMutex);
+			if (sendCollected() < 0) {
+				syslog(LOG_ERR, "jet peer %s:%u: could not send collected messages: '%s'", m_address.c_str(), m_port, strerror(errno));
+			}
+		}
+
 		void PeerAsync::receiveCallback(const Json::Value &data)
 		{
 			Json::ValueType type = data.type();
@@ -752,135 +2063,143 @@ namespace hbk {
 			switch (valueType) {
 			case Json::nullValue:
 				// result or error to a request
-				AsyncRequest::handleResult(data);
+				m_pendingRequests->handleResult(data);
 				break;
 			case Json::intValue:
 				// this jet peer implementation uses unsigned numbers as fetch id when creating a fetch.
 				// The method inside fetch notifications is of the same type
-				{
-				fetchId_t fetchId = methodNode.asInt();
-				std::lock_guard < std::recursive_mutex > lock(m_mtx_fetchers);
-				const auto iter = m_fetchers.find(fetchId);
-				if (iter!=m_fetchers.cend()) {
-					// it is a notification for a fetch
-					const Json::Value& params = data[jsonrpc::PARAMS];
-					try {
-							iter->second.callback(params, 0);
-						} catch(const std::runtime_error &e) {
-							syslog(LOG_ERR, "Fetch callback '%s' threw exception '%s'!", iter->second.matcher.print().c_str(), e.what());
-						} catch(...) {
-							syslog(LOG_ERR, "Fetch callback '%s' threw exception!", iter->second.matcher.print().c_str());
-						}
-					}
-				}
+				consumeFetchNotification(methodNode.asInt(), data[jsonrpc::PARAMS]);
 				break;
 			case Json::stringValue:
 				// this is any kind of request or notification
 				{
-					const std::string method(methodNode.asString());
-					{
-						std::lock_guard < std::recursive_mutex > lock(m_mtx_stateCallbacks);
-						const auto iter = m_stateCallbacks.find(method);
-						if (iter != m_stateCallbacks.cend()) {
-							// it is a state!
-							const Json::Value& value = data[jsonrpc::PARAMS][VALUE];
-
-							if (!value.isNull()) {
-								Json::Value response;
-								stateCallback_t& callback = iter->second;
-								if (!callback) {
-									response[jsonrpc::ERR][jsonrpc::CODE] = jsonrpc::internalError;
-									response[jsonrpc::ERR][jsonrpc::MESSAGE] = "state is read only!";
-								} else {
-									try {
-										SetStateCbResult stateCallbackResult = callback(value, method);
-										const Json::Value& notifyValue = stateCallbackResult.value;
-										if (!notifyValue.isNull()) {
-											// Notifies the changed value. This happens before eventually sending the response.
-											// If there is no change, there is no notification.
-											Json::Value sendata;
-											sendata[jsonrpc::METHOD] = CHANGE;
-											Json::Value& dataparams = sendata[jsonrpc::PARAMS];
-											dataparams[PATH] = method;
-											dataparams[VALUE] = notifyValue;
-											sendMessage(sendata);
-										}
-
-										static const Json::Value SUCCESS_RESPONSE = Json::Value(Json::objectValue);
-										if (stateCallbackResult.result.code) {
-											response[jsonrpc::RESULT][WARNING][jsonrpc::CODE] = stateCallbackResult.result.code;
-											if (!stateCallbackResult.result.message.empty()) {
-												response[jsonrpc::RESULT][WARNING][jsonrpc::MESSAGE] = stateCallbackResult.result.message;
-											}
-										} else {
-											response[jsonrpc::RESULT] = SUCCESS_RESPONSE;
-										}
-									} catch (const jsoncpprpcException& e) {
-										response = e.json();
-									} catch (const hbk::exception::jsonrpcException& e) {
-										response[jsonrpc::ERR][jsonrpc::CODE] = e.code();
-										response[jsonrpc::ERR][jsonrpc::MESSAGE] = e.message();
-									} catch (const std::exception& e) {
-										response[jsonrpc::ERR][jsonrpc::CODE] = jsonrpc::internalError;
-										response[jsonrpc::ERR][jsonrpc::MESSAGE] = e.what();
-									} catch (...) {
-										response[jsonrpc::ERR][jsonrpc::CODE] = jsonrpc::internalError;
-										response[jsonrpc::ERR][jsonrpc::MESSAGE] = "caught exception!";
-									}
-								}
-
-								const Json::Value& idNode = data[jsonrpc::ID];
-								if (idNode) {
-									response[jsonrpc::ID] = idNode;
-									try {
-										sendMessage(response);
-									} catch (const hbk::exception::jsonrpcException& e) {
-										syslog(LOG_ERR, "jet peer: Unable to send %s", e.message().c_str());
-									}
-								}
-							}
-							return;
+					// the received path is looked up in place, no string is composed
+					const char* pMethod = nullptr;
+					const char* pMethodEnd = nullptr;
+					methodNode.getString(&pMethod, &pMethodEnd);
+					// Keeps the state or method alive while its callback is executed. No lock is held, the callback might add or remove states and methods.
+					const PathRegistry::elementPtr_t element = m_pathRegistry->find(pMethod, static_cast < size_t > (pMethodEnd-pMethod));
+					if (!element) {
+						++m_droppedRequestCount;
+						syslog(LOG_ERR, "jet peer: unknown request or notification '%s'", std::string(pMethod, pMethodEnd).c_str());
+						break;
+					}
+					if (!m_callbackWorkers) {
+						if (element->state) {
+							handleStateRequest(*element->state, data);
+						} else if (element->deferredMethod) {
+							handleDeferredMethodRequest(element->deferredMethod, data);
+						} else {
+							handleMethodRequest(element->method, data);
 						}
+						break;
 					}
+
+					// Requests for the same path are executed by the same worker, hence they stay in order.
+					// The element keeps the state or method alive until the callback was executed.
+					const Json::Value request(data);
+					const uint64_t generation = m_connectionGeneration;
+					m_callbackWorkers->execute(std::hash < std::string > ()(element->path), [this, element, request, generation]()
 					{
-						std::lock_guard < std::recursive_mutex > lock(m_mtx_methodCallbacks);
-						const auto iter = m_methodCallbacks.find(method);
-						if (iter != m_methodCallbacks.cend()) {
-							// it is a method!
-							Json::Value response;
-							try {
-								const Json::Value& params = data[jsonrpc::PARAMS];
-								response[jsonrpc::RESULT] = iter->second(params);
-							} catch(const jsoncpprpcException& e) {
-								response = e.json();
-							} catch (const hbk::exception::jsonrpcException& e) {
-								response[jsonrpc::ERR][jsonrpc::CODE] = e.code();
-								response[jsonrpc::ERR][jsonrpc::MESSAGE] = e.message();
-							} catch(const std::exception& e) {
-								response[jsonrpc::ERR][jsonrpc::CODE] = jsonrpc::internalError;
-								response[jsonrpc::ERR][jsonrpc::MESSAGE] = e.what();
-							} catch(...) {
-								response[jsonrpc::ERR][jsonrpc::CODE] = jsonrpc::internalError;
-								response[jsonrpc::ERR][jsonrpc::MESSAGE] = "caught exception!";
-							}
-							const Json::Value& idNode = data[jsonrpc::ID];
-							if (idNode) {
-								response[jsonrpc::ID] = idNode;
-								try {
-									sendMessage(response);
-								} catch (const hbk::exception::jsonrpcException& e) {
-									syslog(LOG_ERR, "jet peer: Unable to send %s", e.message().c_str());
-								}
-							}
+						if (generation!=m_connectionGeneration) {
+							// The request came with a connection that is gone, there is nobody to respond to.
+							// Its id would be unknown to or even reused by the connection after reconnecting.
 							return;
 						}
-					}
-					syslog(LOG_ERR, "jet peer: unknown request or notification '%s'", method.c_str());
+						if (element->state) {
+							handleStateRequest(*element->state, request);
+						} else if (element->deferredMethod) {
+							handleDeferredMethodRequest(element->deferredMethod, request);
+						} else {
+							handleMethodRequest(element->method, request);
+						}
+					});
 				}
 				break;
 			default:
 				break;
 			}
 		}
+
+		void PeerAsync::handleStateRequest(const detail::stateEntry& state, const Json::Value& data)
+		{
+			const Json::Value& value = data[jsonrpc::PARAMS][VALUE];
+			if (value.isNull()) {
+				return;
+			}
+
+			if (state.deferredCallback) {
+				Responder responder(std::make_shared < detail::pendingResponse > (m_responderLink, data[jsonrpc::ID], state.path));
+				try {
+					state.deferredCallback(value, state.path, responder);
+				} catch (...) {
+					Json::Value response = composeErrorResponse();
+					responder.m_response->send(response, Json::Value());
+				}
+				return;
+			}
+
+			Json::Value response;
+			const stateCallback_t& callback = state.callback;
+			if (!callback) {
+				response[jsonrpc::ERR][jsonrpc::CODE] = jsonrpc::internalError;
+				response[jsonrpc::ERR][jsonrpc::MESSAGE] = "state is read only!";
+			} else {
+				try {
+					SetStateCbResult stateCallbackResult = callback(value, state.path);
+					const Json::Value& notifyValue = stateCallbackResult.value;
+					if (!notifyValue.isNull()) {
+						// Notifies the changed value. This happens before eventually sending the response.
+						// If there is no change, there is no notification.
+						keepStateValue(state.path, notifyValue);
+						sendMessage(composeSetChange(state.path, notifyValue));
+					}
+					response = composeStateResponse(stateCallbackResult);
+				} catch (...) {
+					response = composeErrorResponse();
+				}
+			}
+
+			const Json::Value& idNode = data[jsonrpc::ID];
+			if (idNode) {
+				response[jsonrpc::ID] = idNode;
+				try {
+					sendMessage(response);
+				} catch (const hbk::exception::jsonrpcException& e) {
+					syslog(LOG_ERR, "jet peer: Unable to send %s", e.message().c_str());
+				}
+			}
+		}
+
+		void PeerAsync::handleMethodRequest(const methodCallback_t& callback, const Json::Value& data)
+		{
+			Json::Value response;
+			try {
+				const Json::Value& params = data[jsonrpc::PARAMS];
+				response[jsonrpc::RESULT] = callback(params);
+			} catch(...) {
+				response = composeErrorResponse();
+			}
+			const Json::Value& idNode = data[jsonrpc::ID];
+			if (idNode) {
+				response[jsonrpc::ID] = idNode;
+				try {
+					sendMessage(response);
+				} catch (const hbk::exception::jsonrpcException& e) {
+					syslog(LOG_ERR, "jet peer: Unable to send %s", e.message().c_str());
+				}
+			}
+		}
+
+		void PeerAsync::handleDeferredMethodRequest(const deferredMethodCallback_t& callback, const Json::Value& data)
+		{
+			Responder responder(std::make_shared < detail::pendingResponse > (m_responderLink, data[jsonrpc::ID], std::string()));
+			try {
+				callback(data[jsonrpc::PARAMS], responder);
+			} catch(...) {
+				Json::Value response = composeErrorResponse();
+				responder.m_response->send(response, Json::Value());
+			}
+		}
 	} // namespace jet
 } // namespace hbk
@@ -0,0 +1,360 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <utility>
+
+#ifdef _WIN32
+#define syslog fprintf
+#define LOG_ERR stderr
+#else
+#include "syslog.h"
+#endif
+
+#include "hbk/jsonrpc/jsonrpc_defines.h"
+
+#include "pendingrequests.h"
+
+namespace hbk
+{
+	namespace jet
+	{
+		/// lower bits of the request id: index of the slot
+		static const unsigned int SLOT_INDEX_BITS = 24;
+		static const PendingRequests::requestId_t SLOT_INDEX_MASK = (static_cast < PendingRequests::requestId_t > (1) << SLOT_INDEX_BITS) - 1;
+		/// upper bits of the request id: sequence number. Together with the index bits this stays below 2^53
+		static const PendingRequests::requestId_t SEQUENCE_MASK = (static_cast < PendingRequests::requestId_t > (1) << (53 - SLOT_INDEX_BITS)) - 1;
+
+		/// member of the error data of error objects created by the peer itself
+		static const char LOCAL_ERROR[] = "local";
+
+		/// resolution of deadlines
+		static const std::chrono::milliseconds TICK(10);
+		/// number of buckets of the timer wheel. One revolution takes 5.12s
+		static const size_t WHEEL_SIZE = 512;
+
+		PendingRequests::Slot::Slot()
+			: id(0)
+			, responseCallback()
+			, errorNotifier()
+			, deadline()
+		{
+		}
+
+		PendingRequests::PendingRequests(sys::EventLoop& eventLoop)
+			: m_slots()
+			, m_freeSlots()
+			, m_sequence(0)
+			, m_count(0)
+			, m_wheel(WHEEL_SIZE)
+			, m_wheelPosition(0)
+			, m_wheelTime(clock_t::now())
+			, m_wheelEntries(0)
+			, m_deadlineTimerArmed(false)
+			, m_deadlineNotifier(eventLoop)
+			, m_deadlineTimer(eventLoop)
+			, m_mtx()
+		{
+			m_deadlineNotifier.set(std::bind(&PendingRequests::startDeadlineTimer, this));
+		}
+
+		PendingRequests::requestId_t PendingRequests::add(const responseCallback_t& responseCallback, std::chrono::milliseconds timeout)
+		{
+			std::lock_guard < std::mutex > lock(m_mtx);
+			size_t index;
+			if (m_freeSlots.empty()) {
+				index = m_slots.size();
+				if (index > SLOT_INDEX_MASK) {
+					throw hbk::exception::jsonrpcException(-1, "too many open jet requests!");
+				}
+				m_slots.push_back(Slot());
+			} else {
+				index = m_freeSlots.back();
+				m_freeSlots.pop_back();
+			}
+
+			// sequence starts with 1, hence id 0 is never used
+			m_sequence = (m_sequence % SEQUENCE_MASK) + 1;
+			requestId_t id = (m_sequence << SLOT_INDEX_BITS) | index;
+
+			Slot& slot = m_slots[index];
+			slot.id = id;
+			slot.responseCallback = responseCallback;
+			++m_count;
+
+			if (timeout.count() > 0) {
+				clock_t::time_point now = clock_t::now();
+				if (m_wheelEntries == 0) {
+					// the wheel was idle, it starts now
+					m_wheelTime = now;
+				}
+				slot.deadline = now + timeout;
+				insertDeadline(id, slot.deadline);
+				if (!m_deadlineTimerArmed) {
+					m_deadlineTimerArmed = true;
+					m_deadlineNotifier.notify();
+				}
+			}
+			return id;
+		}
+
+		void PendingRequests::insertDeadline(requestId_t id, clock_t::time_point deadline)
+		{
+			size_t ticks = 1;
+			if (deadline > m_wheelTime + TICK) {
+				clock_t::duration distance = deadline - m_wheelTime;
+				if (distance >= TICK * static_cast < int > (WHEEL_SIZE)) {
+					// moved on when the bucket is reached
+					ticks = WHEEL_SIZE - 1;
+				} else {
+					// rounded up in unsigned arithmetic, the distance is positive and below one revolution
+					size_t tick = static_cast < size_t > (std::chrono::duration_cast < clock_t::duration > (TICK).count());
+					size_t count = static_cast < size_t > (distance.count());
+					ticks = std::min((count + tick - 1) / tick, WHEEL_SIZE - 1);
+				}
+			}
+			m_wheel[(m_wheelPosition + ticks) % WHEEL_SIZE].push_back(id);
+			++m_wheelEntries;
+		}
+
+		void PendingRequests::startDeadlineTimer()
+		{
+			m_deadlineTimer.set(TICK, false, std::bind(&PendingRequests::expire, this, std::placeholders::_1));
+		}
+
+		void PendingRequests::expire(bool fired)
+		{
+			if (!fired) {
+				return;
+			}
+
+			std::vector < completion_t > expired;
+			std::vector < std::unique_ptr < hbk::sys::Notifier > > errorNotifiers;
+			bool rearm;
+			{
+				std::lock_guard < std::mutex > lock(m_mtx);
+				clock_t::time_point now = clock_t::now();
+				std::vector < requestId_t > bucket;
+				while ((m_wheelEntries > 0) && (m_wheelTime + TICK <= now)) {
+					m_wheelTime += TICK;
+					m_wheelPosition = (m_wheelPosition + 1) % WHEEL_SIZE;
+					bucket.swap(m_wheel[m_wheelPosition]);
+					m_wheelEntries -= bucket.size();
+					for (requestId_t id: bucket) {
+						size_t index = findSlot(id);
+						if (index == m_slots.size()) {
+							// got its response meanwhile
+							continue;
+						}
+						Slot& slot = m_slots[index];
+						if (slot.deadline > now) {
+							insertDeadline(id, slot.deadline);
+							continue;
+						}
+						expired.push_back(completion_t(id, std::move(slot.responseCallback)));
+						if (slot.errorNotifier) {
+							errorNotifiers.push_back(std::move(slot.errorNotifier));
+						}
+						releaseSlot(index);
+					}
+					// keep the capacity of the bucket
+					bucket.clear();
+					bucket.swap(m_wheel[m_wheelPosition]);
+				}
+				rearm = (m_wheelEntries > 0);
+				m_deadlineTimerArmed = rearm;
+			}
+
+			// callbacks are called without holding the lock. They might start new requests.
+			for (const auto &iter: expired) {
+				complete(iter, "no response to jet request within timeout!");
+			}
+			if (rearm) {
+				m_deadlineNotifier.notify();
+			}
+		}
+
+		void PendingRequests::complete(const completion_t& completion, const char* pMessage)
+		{
+			if (!completion.second) {
+				return;
+			}
+			Json::Value error;
+			error[jsonrpc::ID] = static_cast < Json::UInt64 > (completion.first);
+			error[jsonrpc::ERR][jsonrpc::CODE] = -1;
+			error[jsonrpc::ERR][jsonrpc::MESSAGE] = pMessage;
+			markLocalError(error);
+			try {
+				completion.second(error);
+			} catch(...) {
+				// catch and ignore everything!
+			}
+		}
+
+		size_t PendingRequests::findSlot(requestId_t id) const
+		{
+			size_t index = static_cast < size_t > (id & SLOT_INDEX_MASK);
+			if ((id == 0) || (index >= m_slots.size()) || (m_slots[index].id != id)) {
+				return m_slots.size();
+			}
+			return index;
+		}
+
+		void PendingRequests::releaseSlot(size_t index)
+		{
+			Slot& slot = m_slots[index];
+			slot.id = 0;
+			slot.responseCallback = responseCallback_t();
+			m_freeSlots.push_back(index);
+			--m_count;
+		}
+
+		void PendingRequests::erase(requestId_t id)
+		{
+			std::unique_ptr < hbk::sys::Notifier > errorNotifier;
+			std::lock_guard < std::mutex > lock(m_mtx);
+			size_t index = findSlot(id);
+			if (index == m_slots.size()) {
+				return;
+			}
+			errorNotifier = std::move(m_slots[index].errorNotifier);
+			releaseSlot(index);
+		}
+
+		int PendingRequests::cancel(requestId_t id)
+		{
+			completion_t completion;
+			std::unique_ptr < hbk::sys::Notifier > errorNotifier;
+			{
+				std::lock_guard < std::mutex > lock(m_mtx);
+				size_t index = findSlot(id);
+				if (index == m_slots.size()) {
+					return -1;
+				}
+				completion = completion_t(id, std::move(m_slots[index].responseCallback));
+				errorNotifier = std::move(m_slots[index].errorNotifier);
+				releaseSlot(index);
+			}
+			complete(completion, "jet request has been canceled!");
+			return 0;
+		}
+
+		void PendingRequests::notifyError(requestId_t id, sys::EventLoop& eventLoop, const Json::Value& error)
+		{
+			std::lock_guard < std::mutex > lock(m_mtx);
+			size_t index = findSlot(id);
+			if (index == m_slots.size()) {
+				return;
+			}
+
+			// "instant" error response call back is not to be called in this context but in eventloop context
+			// that handles all response callback functions.
+			Json::Value response = error;
+			response[jsonrpc::ID] = static_cast < Json::UInt64 > (id);
+			markLocalError(response);
+			auto notifierCb = [this, response]()
+			{
+				handleResult(response);
+			};
+			// no std::make_unique because we are bound to C++11
+			std::unique_ptr < hbk::sys::Notifier >& errorNotifier = m_slots[index].errorNotifier;
+			errorNotifier = std::unique_ptr < hbk::sys::Notifier > (new hbk::sys::Notifier(eventLoop));
+			errorNotifier->set(notifierCb);
+			errorNotifier->notify();
+		}
+
+		void PendingRequests::handleResult(const Json::Value& data)
+		{
+			const Json::Value& idNode = data[jsonrpc::ID];
+			if (!idNode.isUInt64()) {
+				syslog(LOG_ERR, "jet peer: Response without valid id!");
+				return;
+			}
+			requestId_t id = idNode.asUInt64();
+			responseCallback_t responseCallback;
+			std::unique_ptr < hbk::sys::Notifier > errorNotifier;
+			{
+				std::lock_guard < std::mutex > lock(m_mtx);
+				size_t index = findSlot(id);
+				if (index == m_slots.size()) {
+					syslog(LOG_ERR, "jet peer: No request with id='%llu' is waiting for a response!", static_cast < unsigned long long > (id));
+					return;
+				}
+				responseCallback.swap(m_slots[index].responseCallback);
+				errorNotifier = std::move(m_slots[index].errorNotifier);
+				releaseSlot(index);
+			}
+			try {
+				responseCallback(data);
+			} catch(...) {
+				// catch and ignore everything!
+			}
+		}
+
+		size_t PendingRequests::clear()
+		{
+			slots_t slots;
+			{
+				std::lock_guard < std::mutex > lock(m_mtx);
+				slots.swap(m_slots);
+				m_freeSlots.clear();
+				m_count = 0;
+				// the timer stops on its next tick
+				for (auto &bucket: m_wheel) {
+					bucket.clear();
+				}
+				m_wheelEntries = 0;
+			}
+
+			// callbacks are called without holding the lock. They might start new requests.
+			size_t count = 0;
+			for (auto &iter: slots) {
+				if (iter.id == 0) {
+					continue;
+				}
+				++count;
+				complete(completion_t(iter.id, std::move(iter.responseCallback)), "jet request has been canceled without response!");
+			}
+			return count;
+		}
+
+		void PendingRequests::markLocalError(Json::Value& response)
+		{
+			response[jsonrpc::ERR][jsonrpc::DATA][LOCAL_ERROR] = true;
+		}
+
+		bool PendingRequests::isLocalError(const Json::Value& response)
+		{
+			const Json::Value& data = response[jsonrpc::ERR][jsonrpc::DATA];
+			return (data.isObject()) && (data[LOCAL_ERROR].asBool());
+		}
+
+		size_t PendingRequests::size() const
+		{
+			std::lock_guard < std::mutex > lock(m_mtx);
+			return m_count;
+		}
+	}
+}
@@ -0,0 +1,154 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef __HBK_JET_PENDINGREQUESTS_H
+#define __HBK_JET_PENDINGREQUESTS_H
+
+#include <stdint.h>
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <json/value.h>
+
+#include "hbk/sys/eventloop.h"
+#include "hbk/sys/notifier.h"
+#include "hbk/sys/timer.h"
+
+#include "jet/defines.h"
+
+namespace hbk
+{
+	namespace jet
+	{
+		/// All requests of one jet peer that are waiting for their response.
+		///
+		/// Requests are kept in a dense array of slots. The id of a request carries the index of its slot in the lower bits
+		/// and a sequence number in the upper bits. Hence finding the request a response belongs to is an array access.
+		/// The sequence number makes sure that a late response does not hit a request that reuses the slot.
+		/// \note ids stay below 2^53, they survive a round trip through jet daemons storing numbers as double.
+		///
+		/// Requests with a deadline are put into a timer wheel. Each bucket covers one tick, a request is put into the bucket of its deadline.
+		/// Deadlines beyond one revolution of the wheel are put into the last bucket reachable and are moved on when it is reached.
+		/// Requests that get their response are not removed from the wheel, they are skipped when their bucket is reached.
+		/// Hence adding and completing requests is O(1). The wheel is driven by a timer of the eventloop, which runs only while there are deadlines.
+		class PendingRequests
+		{
+		public:
+			using requestId_t = jet::requestId_t;
+
+			/// @param eventLoop expired requests are completed in the context of this eventloop
+			explicit PendingRequests(sys::EventLoop& eventLoop);
+			PendingRequests(const PendingRequests&) = delete;
+			PendingRequests& operator=(const PendingRequests&) = delete;
+
+			/// @param timeout The response callback is called with an error object if there is no response within this time. 0 for no deadline.
+			/// \return the id to be send with the request
+			requestId_t add(const responseCallback_t& responseCallback, std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+
+			/// Forget a request without calling its response callback.
+			void erase(requestId_t id);
+
+			/// Forget a request. Its response callback is called with an error object before returning.
+			/// \return 0 on success, -1 if the request is not waiting for a response
+			int cancel(requestId_t id);
+
+			/// The response callback of the request is called with the error object in the context of the eventloop.
+			/// Used if sending of the request failed.
+			void notifyError(requestId_t id, sys::EventLoop& eventLoop, const Json::Value& error);
+
+			/// find the request this reply belongs to and call its response callback!
+			void handleResult(const Json::Value& data);
+
+			/// Clear all open requests. Responses for those won't be recognized afterwards!
+			/// All request callbacks will be called with an error object stating that the request was canceled without response!
+			/// \return number of requests removed
+			size_t clear();
+
+			/// \return number of requests waiting for a response
+			size_t size() const;
+
+			/// \return true if the error object was created by the peer itself and not received from the jet daemon.
+			/// This is the case if the request timed out, got canceled, could not be send or the connection got lost.
+			static bool isLocalError(const Json::Value& response);
+			/// mark an error object as created by the peer itself
+			static void markLocalError(Json::Value& response);
+
+		private:
+			using clock_t = std::chrono::steady_clock;
+
+			struct Slot {
+				Slot();
+				/// 0 if the slot is not in use
+				requestId_t id;
+				responseCallback_t responseCallback;
+				/// Since creating a notifier involves system calls, we do this only if needed.
+				std::unique_ptr<hbk::sys::Notifier> errorNotifier;
+				/// only valid if the request is in the timer wheel
+				clock_t::time_point deadline;
+			};
+
+			using slots_t = std::vector < Slot >;
+			/// a request removed with its response callback to be called with an error object
+			using completion_t = std::pair < requestId_t, responseCallback_t >;
+
+			/// \return index of the slot if id belongs to a request in use, otherwise m_slots.size()
+			size_t findSlot(requestId_t id) const;
+			void releaseSlot(size_t index);
+
+			/// put request into the bucket of its deadline. m_mtx needs to be locked by the caller!
+			void insertDeadline(requestId_t id, clock_t::time_point deadline);
+			/// arm the timer, executed in eventloop context
+			void startDeadlineTimer();
+			/// complete all requests whose deadline passed, executed in eventloop context
+			void expire(bool fired);
+			/// call the response callback with an error object. m_mtx may not be locked by the caller!
+			static void complete(const completion_t& completion, const char* pMessage);
+
+			slots_t m_slots;
+			/// indices of unused slots
+			std::vector < size_t > m_freeSlots;
+			uint64_t m_sequence;
+			size_t m_count;
+
+			/// buckets with the ids of requests expiring in the tick of the bucket
+			std::vector < std::vector < requestId_t > > m_wheel;
+			/// bucket of the current tick
+			size_t m_wheelPosition;
+			/// start of the current tick
+			clock_t::time_point m_wheelTime;
+			/// number of ids in all buckets, including those of completed requests
+			size_t m_wheelEntries;
+			/// timer is running or about to be started
+			bool m_deadlineTimerArmed;
+			/// the timer is armed in eventloop context only
+			hbk::sys::Notifier m_deadlineNotifier;
+			hbk::sys::Timer m_deadlineTimer;
+
+			mutable std::mutex m_mtx;
+		};
+	}
+}
+#endif
@@ -0,0 +1,112 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <stdint.h>
+
+#include <cstring>
+
+#include "receivebuffer.h"
+
+namespace hbk
+{
+	namespace jet
+	{
+		static const size_t LENGTH_SIZE = sizeof(uint32_t);
+
+		/// \return the big endian length information at pData
+		static size_t readLength(const char* pData)
+		{
+			const unsigned char* pBytes = reinterpret_cast < const unsigned char* > (pData);
+			return (static_cast < size_t > (pBytes[0]) << 24) | (static_cast < size_t > (pBytes[1]) << 16) | (static_cast < size_t > (pBytes[2]) << 8) | static_cast < size_t > (pBytes[3]);
+		}
+
+		ReceiveBuffer::ReceiveBuffer(size_t maxTelegramSize, size_t chunkSize)
+			: m_maxTelegramSize(maxTelegramSize)
+			, m_buffer(LENGTH_SIZE+maxTelegramSize+chunkSize)
+			, m_level(0)
+		{
+		}
+
+		char* ReceiveBuffer::writePosition()
+		{
+			return m_buffer.data()+m_level;
+		}
+
+		size_t ReceiveBuffer::space() const
+		{
+			return m_buffer.size()-m_level;
+		}
+
+		size_t ReceiveBuffer::level() const
+		{
+			return m_level;
+		}
+
+		size_t ReceiveBuffer::announcedLength() const
+		{
+			if (m_level<LENGTH_SIZE) {
+				return 0;
+			}
+			return readLength(m_buffer.data());
+		}
+
+		void ReceiveBuffer::clear()
+		{
+			m_level = 0;
+		}
+
+		int ReceiveBuffer::commit(size_t count, const telegramCallback_t& telegramCallback)
+		{
+			m_level += count;
+
+			int result = 0;
+			size_t pos = 0;
+			while (m_level-pos >= LENGTH_SIZE) {
+				size_t len = readLength(m_buffer.data()+pos);
+				if (len>m_maxTelegramSize) {
+					result = -1;
+					break;
+				}
+				if (m_level-pos-LENGTH_SIZE < len) {
+					// telegram is not complete yet
+					break;
+				}
+				const char* pTelegram = m_buffer.data()+pos+LENGTH_SIZE;
+				pos += LENGTH_SIZE+len;
+				telegramCallback(pTelegram, len);
+				if (pos>m_level) {
+					// cleared by the callback. What is left is to be dropped.
+					return 0;
+				}
+			}
+
+			// move the incomplete rest to the front. This is less than one telegram.
+			if (pos>0) {
+				m_level -= pos;
+				memmove(m_buffer.data(), m_buffer.data()+pos, m_level);
+			}
+			return result;
+		}
+	}
+}
@@ -0,0 +1,75 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef __HBK_JET_RECEIVEBUFFER_H
+#define __HBK_JET_RECEIVEBUFFER_H
+
+#include <functional>
+#include <vector>
+
+namespace hbk
+{
+	namespace jet
+	{
+		/// Received data is read into this buffer in chunks as large as possible. Telegrams (4 byte big endian length information followed by payload)
+		/// are handed out in place. An incomplete telegram at the end is moved to the front. Allocated once, never resized.
+		/// It holds the largest telegram allowed and at least one chunk to read.
+		class ReceiveBuffer
+		{
+		public:
+			/// called with the payload of each complete telegram
+			using telegramCallback_t = std::function < void(const char* pTelegram, size_t len) >;
+
+			/// @param maxTelegramSize largest payload allowed
+			/// @param chunkSize there is always room to read at least this many bytes
+			ReceiveBuffer(size_t maxTelegramSize, size_t chunkSize);
+			ReceiveBuffer(const ReceiveBuffer&) = delete;
+			ReceiveBuffer& operator=(const ReceiveBuffer&) = delete;
+
+			/// \return where to read to
+			char* writePosition();
+			/// \return number of bytes that can be read to writePosition(), at least the chunk size
+			size_t space() const;
+			/// \return number of bytes received but not handed out yet
+			size_t level() const;
+			/// \return length announced by the telegram at the front, 0 if not even its length information was received
+			size_t announcedLength() const;
+
+			/// Forget everything received. Might be called from within the telegram callback to drop the rest of the data.
+			void clear();
+
+			/// Hand out all complete telegrams and move the incomplete rest to the front
+			/// @param count number of bytes read to writePosition()
+			/// \return -1 if a telegram exceeds the maximum size. It is left at the front.
+			int commit(size_t count, const telegramCallback_t& telegramCallback);
+
+		private:
+			size_t m_maxTelegramSize;
+			std::vector < char > m_buffer;
+			/// number of bytes in m_buffer
+			size_t m_level;
+		};
+	}
+}
+#endif
@@ -22,7 +22,6 @@
 // THE SOFTWARE.
 
 #include <future>
-#include <mutex>
 
 #include "syncrequest.h"
 
@@ -39,8 +38,9 @@ namespace hbk
 		{
 			// destruction in destructor of base class might be to late.
 			// before calling the base desctructor the object is already missing the parts from the specialized class and might be used by another thread!
-			std::lock_guard < std::mutex > local(m_mtx_openRequestCbs);
-			m_openRequestCbs.erase(m_id);
+			if (m_pPendingRequests) {
+				m_pPendingRequests->erase(m_id);
+			}
 		}
 
 		Json::Value SyncRequest::executeSync(PeerAsync& peerAsync)
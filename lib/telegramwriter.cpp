@@ -0,0 +1,227 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+#include "hbk/jsonrpc/jsonrpc_defines.h"
+
+#include "jet/defines.h"
+#include "telegramwriter.h"
+
+namespace hbk
+{
+	namespace jet
+	{
+		namespace telegramWriter
+		{
+			static const char HEX[] = "0123456789abcdef";
+
+			static void appendEscaped16Bit(std::string& out, unsigned int value)
+			{
+				out += "\\u";
+				out += HEX[(value >> 12) & 0x0f];
+				out += HEX[(value >> 8) & 0x0f];
+				out += HEX[(value >> 4) & 0x0f];
+				out += HEX[value & 0x0f];
+			}
+
+			/// Decodes the utf-8 sequence starting at pPos the way jsoncpp does.
+			/// Continuation bytes are not validated, sequences that are truncated, oversized or encode a surrogate result in the replacement character.
+			/// @param pPos is moved to the last byte of the sequence
+			static unsigned int decodeUtf8(const char*& pPos, const char* pEnd)
+			{
+				static const unsigned int REPLACEMENT_CHARACTER = 0xfffd;
+				unsigned int first = static_cast < unsigned char > (*pPos);
+				unsigned int codepoint;
+				if (first < 0xe0) {
+					if (pEnd-pPos < 2) {
+						return REPLACEMENT_CHARACTER;
+					}
+					codepoint = ((first & 0x1f) << 6) | (static_cast < unsigned int > (pPos[1]) & 0x3f);
+					pPos += 1;
+					return (codepoint < 0x80) ? REPLACEMENT_CHARACTER : codepoint;
+				} else if (first < 0xf0) {
+					if (pEnd-pPos < 3) {
+						return REPLACEMENT_CHARACTER;
+					}
+					codepoint = ((first & 0x0f) << 12) | ((static_cast < unsigned int > (pPos[1]) & 0x3f) << 6) | (static_cast < unsigned int > (pPos[2]) & 0x3f);
+					pPos += 2;
+					if ((codepoint >= 0xd800) && (codepoint <= 0xdfff)) {
+						return REPLACEMENT_CHARACTER;
+					}
+					return (codepoint < 0x800) ? REPLACEMENT_CHARACTER : codepoint;
+				} else if (first < 0xf8) {
+					if (pEnd-pPos < 4) {
+						return REPLACEMENT_CHARACTER;
+					}
+					codepoint = ((first & 0x07) << 18) | ((static_cast < unsigned int > (pPos[1]) & 0x3f) << 12) | ((static_cast < unsigned int > (pPos[2]) & 0x3f) << 6) | (static_cast < unsigned int > (pPos[3]) & 0x3f);
+					pPos += 3;
+					return (codepoint < 0x10000) ? REPLACEMENT_CHARACTER : codepoint;
+				}
+				return REPLACEMENT_CHARACTER;
+			}
+
+			void appendString(std::string& out, const char* pString, size_t len)
+			{
+				out += '"';
+				const char* pStart = pString;
+				const char* pEnd = pString+len;
+				for (const char* pPos = pString; pPos<pEnd; ++pPos) {
+					unsigned char character = static_cast < unsigned char > (*pPos);
+					if ((character>=0x20) && (character<0x80) && (character!='"') && (character!='\\')) {
+						continue;
+					}
+					// copy everything that needs no escaping at once
+					out.append(pStart, static_cast < size_t > (pPos-pStart));
+					if (character>=0x80) {
+						// like jsoncpp, anything beyond ascii is written as \u escape sequence
+						unsigned int codepoint = decodeUtf8(pPos, pEnd);
+						if (codepoint < 0x10000) {
+							appendEscaped16Bit(out, codepoint);
+						} else {
+							// surrogate pair
+							codepoint -= 0x10000;
+							appendEscaped16Bit(out, 0xd800 + ((codepoint >> 10) & 0x3ff));
+							appendEscaped16Bit(out, 0xdc00 + (codepoint & 0x3ff));
+						}
+						pStart = pPos+1;
+						continue;
+					}
+					pStart = pPos+1;
+					switch (character) {
+					case '"':
+						out += "\\\"";
+						break;
+					case '\\':
+						out += "\\\\";
+						break;
+					case '\b':
+						out += "\\b";
+						break;
+					case '\f':
+						out += "\\f";
+						break;
+					case '\n':
+						out += "\\n";
+						break;
+					case '\r':
+						out += "\\r";
+						break;
+					case '\t':
+						out += "\\t";
+						break;
+					default:
+						out += "\\u00";
+						out += HEX[character >> 4];
+						out += HEX[character & 0x0f];
+						break;
+					}
+				}
+				out.append(pStart, static_cast < size_t > (pEnd-pStart));
+				out += '"';
+			}
+
+			void appendString(std::string& out, const std::string& value)
+			{
+				appendString(out, value.c_str(), value.length());
+			}
+
+			void appendUInt(std::string& out, uint64_t value)
+			{
+				char buffer[24];
+				char* pPos = buffer+sizeof(buffer);
+				do {
+					*--pPos = static_cast < char > ('0' + (value % 10));
+					value /= 10;
+				} while (value);
+				out.append(pPos, static_cast < size_t > (buffer+sizeof(buffer)-pPos));
+			}
+
+			void appendInt(std::string& out, int64_t value)
+			{
+				if (value<0) {
+					out += '-';
+					// avoid overflow on negation of the smallest value
+					appendUInt(out, static_cast < uint64_t > (-(value+1))+1);
+				} else {
+					appendUInt(out, static_cast < uint64_t > (value));
+				}
+			}
+
+			void appendDouble(std::string& out, double value)
+			{
+				if (std::isnan(value)) {
+					out += "null";
+					return;
+				} else if (std::isinf(value)) {
+					out += (value<0) ? "-1e+9999" : "1e+9999";
+					return;
+				}
+
+				char buffer[36];
+				int len = snprintf(buffer, sizeof(buffer), "%.17g", value);
+				bool isFloat = false;
+				for (int index = 0; index<len; ++index) {
+					if (buffer[index]==',') {
+						// locale might use ',' as decimal point
+						buffer[index] = '.';
+						isFloat = true;
+					} else if ((buffer[index]=='.') || (buffer[index]=='e')) {
+						isFloat = true;
+					}
+				}
+				out.append(buffer, static_cast < size_t > (len));
+				if (!isFloat) {
+					// keep it a floating point value for the receiver
+					out += ".0";
+				}
+			}
+
+			void appendBool(std::string& out, bool value)
+			{
+				out += value ? "true" : "false";
+			}
+
+			std::string composeChangePrefix(const std::string& path)
+			{
+				std::string prefix;
+				prefix = "{\"";
+				prefix += jsonrpc::METHOD;
+				prefix += "\":\"";
+				prefix += CHANGE;
+				prefix += "\",\"";
+				prefix += jsonrpc::PARAMS;
+				prefix += "\":{\"";
+				prefix += PATH;
+				prefix += "\":";
+				appendString(prefix, path);
+				prefix += ",\"";
+				prefix += VALUE;
+				prefix += "\":";
+				return prefix;
+			}
+		}
+	}
+}
@@ -0,0 +1,54 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef __HBK_JET_TELEGRAMWRITER_H
+#define __HBK_JET_TELEGRAMWRITER_H
+
+#include <stdint.h>
+
+#include <string>
+
+namespace hbk
+{
+	namespace jet
+	{
+		/// Writes json without creating a Json::Value. Used where json composition is time critical (i.e. notification of state changes).
+		/// Output is compatible to Json::writeString without indentation.
+		namespace telegramWriter
+		{
+			/// append as quoted and escaped json string.
+			/// Like jsoncpp, characters beyond ascii are escaped as \\uXXXX, those beyond the basic multilingual plane as surrogate pair.
+			void appendString(std::string& out, const char* pString, size_t len);
+			void appendString(std::string& out, const std::string& value);
+			void appendInt(std::string& out, int64_t value);
+			void appendUInt(std::string& out, uint64_t value);
+			/// Like jsoncpp: 17 significant digits, nan is null, infinity is 1e+9999
+			void appendDouble(std::string& out, double value);
+			void appendBool(std::string& out, bool value);
+
+			/// \return the start of a change notification of this state. The value and "}}" is to be appended.
+			std::string composeChangePrefix(const std::string& path);
+		}
+	}
+}
+#endif
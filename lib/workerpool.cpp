@@ -0,0 +1,126 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "workerpool.h"
+
+namespace hbk
+{
+	namespace jet
+	{
+		WorkerPool::Worker::Worker()
+			: mtx()
+			, condition()
+			, jobs()
+			, stop(false)
+			, thread()
+		{
+		}
+
+		WorkerPool::WorkerPool(unsigned int workerCount)
+			: m_workers()
+		{
+			if (workerCount == 0) {
+				workerCount = 1;
+			}
+			for (unsigned int index = 0; index < workerCount; ++index) {
+				// no std::make_unique because we are bound to C++11
+				m_workers.push_back(std::unique_ptr < Worker > (new Worker()));
+				Worker& worker = *m_workers.back();
+				worker.thread = std::thread(&WorkerPool::run, std::ref(worker));
+			}
+		}
+
+		WorkerPool::~WorkerPool()
+		{
+			for (auto &worker: m_workers) {
+				{
+					std::lock_guard < std::mutex > lock(worker->mtx);
+					worker->stop = true;
+				}
+				worker->condition.notify_one();
+			}
+			for (auto &worker: m_workers) {
+				worker->thread.join();
+			}
+		}
+
+		void WorkerPool::execute(size_t key, job_t job)
+		{
+			Worker& worker = *m_workers[key % m_workers.size()];
+			{
+				std::lock_guard < std::mutex > lock(worker.mtx);
+				worker.jobs.push_back(std::move(job));
+			}
+			worker.condition.notify_one();
+		}
+
+		size_t WorkerPool::discard()
+		{
+			size_t count = 0;
+			for (auto &worker: m_workers) {
+				std::deque < job_t > jobs;
+				{
+					std::lock_guard < std::mutex > lock(worker->mtx);
+					jobs.swap(worker->jobs);
+				}
+				// destructed without holding the lock
+				count += jobs.size();
+			}
+			return count;
+		}
+
+		size_t WorkerPool::size() const
+		{
+			return m_workers.size();
+		}
+
+		void WorkerPool::run(Worker& worker)
+		{
+			std::unique_lock < std::mutex > lock(worker.mtx);
+			while (true) {
+				worker.condition.wait(lock, [&worker]() { return worker.stop || !worker.jobs.empty(); });
+				if (worker.jobs.empty()) {
+					// stopped and nothing left to do
+					return;
+				}
+				job_t job = std::move(worker.jobs.front());
+				worker.jobs.pop_front();
+				lock.unlock();
+				try {
+					job();
+				} catch(...) {
+					// catch and ignore everything!
+				}
+				lock.lock();
+			}
+		}
+	}
+}
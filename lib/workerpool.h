@@ -0,0 +1,86 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef __HBK_JET_WORKERPOOL_H
+#define __HBK_JET_WORKERPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hbk
+{
+	namespace jet
+	{
+		/// A fixed number of threads executing jobs.
+		///
+		/// Each worker has its own queue. Jobs with the same key are executed by the same worker, hence they are executed in the order they were queued.
+		class WorkerPool
+		{
+		public:
+			using job_t = std::function < void() >;
+
+			/// @param workerCount number of threads, at least 1
+			explicit WorkerPool(unsigned int workerCount);
+			WorkerPool(const WorkerPool&) = delete;
+			WorkerPool& operator=(const WorkerPool&) = delete;
+
+			/// All jobs queued are executed before the threads are joined.
+			/// \warning Do not destruct from within a job!
+			~WorkerPool();
+
+			/// Queue a job. Exceptions thrown by the job are caught and ignored.
+			/// @param key jobs with the same key are executed in order
+			void execute(size_t key, job_t job);
+
+			/// Drop all jobs not being executed yet
+			/// \return number of jobs dropped
+			size_t discard();
+
+			/// \return number of threads
+			size_t size() const;
+
+		private:
+			struct Worker
+			{
+				Worker();
+
+				std::mutex mtx;
+				std::condition_variable condition;
+				std::deque < job_t > jobs;
+				bool stop;
+				std::thread thread;
+			};
+
+			static void run(Worker& worker);
+
+			std::vector < std::unique_ptr < Worker > > m_workers;
+		};
+	}
+}
+#endif
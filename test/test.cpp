@@ -350,6 +350,41 @@ TEST_F(SyncPeerTest, testFetchState)
 }
 
 
+TEST_F(SyncPeerTest, testAddBatch)
+{
+	std::vector < hbk::jet::StateSpec > states;
+	states.push_back(hbk::jet::StateSpec("batch/first", 1));
+	states.push_back(hbk::jet::StateSpec("batch/second", 2));
+	// contained twice, the first one is added
+	states.push_back(hbk::jet::StateSpec("batch/first", 3));
+	std::vector < hbk::jet::StateHandle > handles;
+	std::vector < Json::Value > results = servingJetPeer.addStates(states, &handles);
+	ASSERT_EQ(results.size(), 3u);
+	ASSERT_EQ(handles.size(), 3u);
+	ASSERT_TRUE(results[0].isMember(hbk::jsonrpc::RESULT));
+	ASSERT_TRUE(results[1].isMember(hbk::jsonrpc::RESULT));
+	ASSERT_TRUE(results[2].isMember(hbk::jsonrpc::ERR));
+	ASSERT_TRUE(handles[0].isRegistered());
+	ASSERT_TRUE(handles[1].isRegistered());
+	ASSERT_FALSE(handles[2].isRegistered());
+	hbk::jet::matcher_t matchFirst;
+	matchFirst.equals = "batch/first";
+	Json::Value served = servingJetPeer.get(matchFirst)[hbk::jsonrpc::RESULT];
+	ASSERT_EQ(served.size(), 1u);
+	ASSERT_EQ(served[0][hbk::jet::VALUE], 1);
+
+	std::vector < hbk::jet::MethodSpec > methods;
+	methods.push_back(hbk::jet::MethodSpec("batch/method", [](const Json::Value& params) { return params; }));
+	results = servingJetPeer.addMethods(methods);
+	ASSERT_EQ(results.size(), 1u);
+	ASSERT_TRUE(results[0].isMember(hbk::jsonrpc::RESULT));
+	ASSERT_EQ(servingJetPeer.callMethod("batch/method", 7).asInt(), 7);
+
+	servingJetPeer.removeMethodAsync("batch/method");
+	servingJetPeer.removeStateAsync("batch/first");
+	servingJetPeer.removeStateAsync("batch/second");
+}
+
 TEST_F(SyncPeerTest, testGetState)
 {
 #ifdef USE_UNIX_DOMAIN_SOCKETS
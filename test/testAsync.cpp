@@ -21,25 +21,39 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
 #include <stdexcept>
 #include <iostream>
 #include <sstream>
 #include <stdint.h>
 #include <functional>
 #include <future>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #include <json/value.h>
 #include <json/writer.h>
 
+#include "jet/cache.hpp"
 #include "jet/defines.h"
+#include "jet/fetchmultiplexer.hpp"
+#include "jet/getcache.hpp"
 #include "jet/peerasync.hpp"
 #include "hbk/sys/eventloop.h"
 #include "hbk/jsonrpc/jsonrpc_defines.h"
 
 #ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
 #define USE_UNIX_DOMAIN_SOCKETS
 #endif
 
@@ -87,6 +101,47 @@ static void cbAsyncJsonResult( const Json::Value& result, std::promise < Json::V
 	promise.set_value(result);
 }
 
+/// Poll the condition every 10ms
+/// \return true as soon as the condition is met, false if it is not met within one second
+static bool waitFor(const std::function < bool () >& condition)
+{
+	for (unsigned int retry = 0; retry < 100; ++retry) {
+		if (condition()) {
+			return true;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return condition();
+}
+
+/// Add a read only state and wait for the response of the jet daemon
+/// @param pHandle receives the handle of the state if not null
+/// \return the response, null if there was none within 5 seconds
+static Json::Value addStateAndWait(PeerAsync& peer, const std::string& path, const Json::Value& value, StateHandle* pHandle = nullptr)
+{
+	// a late response must not hit a promise that is gone
+	std::shared_ptr < std::promise < Json::Value > > addPromise = std::make_shared < std::promise < Json::Value > > ();
+	StateHandle handle = peer.addStateAsync(path, value, [addPromise](const Json::Value& response)
+	{
+		addPromise->set_value(response);
+	}, hbk::jet::stateCallback_t());
+	if (pHandle) {
+		*pHandle = handle;
+	}
+	std::future < Json::Value > added = addPromise->get_future();
+	if (added.wait_for(std::chrono::seconds(5))!=std::future_status::ready) {
+		return Json::Value();
+	}
+	return added.get();
+}
+
+/// \return path of a file in the temporary directory of the test that is running
+static std::string tempFileName(const std::string& suffix)
+{
+	const ::testing::TestInfo* pTestInfo = ::testing::UnitTest::GetInstance()->current_test_info();
+	return ::testing::TempDir() + "jet_" + pTestInfo->test_suite_name() + "_" + pTestInfo->name() + suffix;
+}
+
 class AsyncTest : public ::testing::Test {
 
 protected:
@@ -327,9 +382,14 @@ TEST_F(AsyncTest, test_async_fetch)
 
 			hbk::jet::matcher_t match;
 			match.equals = state_zahl;
-			hbk::jet::fetchId_t fetchZahl = fetchingPeer.addFetchAsync(match, std::bind(&fetchCbCountDownOnChange, std::ref(fetchCount), std::ref(p), std::placeholders::_1), hbk::jet::responseCallback_t());
+			std::promise < bool > fetchResultPromise;
+			std::future < bool > fetchResultFuture = fetchResultPromise.get_future();
+			hbk::jet::fetchId_t fetchZahl = fetchingPeer.addFetchAsync(match, std::bind(&fetchCbCountDownOnChange, std::ref(fetchCount), std::ref(p), std::placeholders::_1), std::bind(&cbAsyncBoolResult, std::placeholders::_1, std::ref(fetchResultPromise)));
 			std::string printedMatcher = match.print();
 			ASSERT_EQ(printedMatcher, std::string(EQUALS) + "=" + state_zahl);
+			// notifications are send by another peer. Those might reach the jet daemon before the fetch is registered.
+			ASSERT_EQ(fetchResultFuture.wait_for(std::chrono::milliseconds(1000)), std::future_status::ready);
+			ASSERT_EQ(fetchResultFuture.get(), true);
 			for(int count = 0; count < notifyCount; ++count) {
 				peer.notifyState(state_zahl, count);
 			}
@@ -589,6 +649,1513 @@ TEST_F(AsyncTest, test_states)
 
 }
 
+/// deferred methods and states are completed after their callback returned, from any thread and in any order
+TEST_F(AsyncTest, test_deferred)
+{
+#ifdef USE_UNIX_DOMAIN_SOCKETS
+	hbk::jet::PeerAsync callingPeer(eventloop, hbk::jet::JET_UNIX_DOMAIN_SOCKET_NAME, 0, "callingPeer");
+#else
+	hbk::jet::PeerAsync callingPeer(eventloop, "127.0.0.1", hbk::jet::JETD_TCP_PORT, "callingPeer");
+#endif
+	static const unsigned int callCount = 3;
+	static const std::string methodPath = "test/deferred/method";
+	static const std::string statePath = "test/deferred/state";
+	static const std::string droppedPath = "test/deferred/dropped";
+
+	std::mutex mtx;
+	std::vector < std::pair < int, hbk::jet::Responder > > calls;
+	std::promise < void > allCalledPromise;
+	auto cbDeferredMethod = [&](const Json::Value& params, hbk::jet::Responder responder)
+	{
+		std::lock_guard < std::mutex > lock(mtx);
+		calls.push_back(std::make_pair(params.asInt(), responder));
+		if (calls.size()==callCount) {
+			allCalledPromise.set_value();
+		}
+	};
+	hbk::jet::Responder stateResponder;
+	std::promise < void > stateSetPromise;
+	auto cbDeferredState = [&](const Json::Value&, const std::string& path, hbk::jet::Responder responder)
+	{
+		ASSERT_EQ(path, statePath);
+		stateResponder = responder;
+		stateSetPromise.set_value();
+	};
+	auto cbDropped = [](const Json::Value&, hbk::jet::Responder)
+	{
+	};
+
+	std::promise < Json::Value > addPromise;
+	peer.addDeferredMethodAsync(methodPath, 1.0, std::bind(&cbAsyncJsonResult, std::placeholders::_1, std::ref(addPromise)), cbDeferredMethod);
+	ASSERT_TRUE(addPromise.get_future().get().isMember(hbk::jsonrpc::RESULT));
+	addPromise = std::promise < Json::Value > ();
+	peer.addDeferredStateAsync(statePath, 0, 1.0, std::bind(&cbAsyncJsonResult, std::placeholders::_1, std::ref(addPromise)), cbDeferredState);
+	ASSERT_TRUE(addPromise.get_future().get().isMember(hbk::jsonrpc::RESULT));
+	addPromise = std::promise < Json::Value > ();
+	peer.addDeferredMethodAsync(droppedPath, 1.0, std::bind(&cbAsyncJsonResult, std::placeholders::_1, std::ref(addPromise)), cbDropped);
+	ASSERT_TRUE(addPromise.get_future().get().isMember(hbk::jsonrpc::RESULT));
+
+	std::promise < Json::Value > callPromises[callCount];
+	for (unsigned int index = 0; index < callCount; ++index) {
+		callingPeer.callMethodAsync(methodPath, static_cast < int > (index), 1.0, std::bind(&cbAsyncJsonResult, std::placeholders::_1, std::ref(callPromises[index])));
+	}
+	ASSERT_EQ(allCalledPromise.get_future().wait_for(std::chrono::seconds(1)), std::future_status::ready);
+
+	// complete in reverse order from another thread
+	std::thread completer([&]()
+	{
+		std::lock_guard < std::mutex > lock(mtx);
+		for (auto iter = calls.rbegin(); iter != calls.rend(); ++iter) {
+			ASSERT_FALSE(iter->second.isCompleted());
+			ASSERT_EQ(iter->second.complete(iter->first * 10), 0);
+			ASSERT_TRUE(iter->second.isCompleted());
+			// completed once only
+			ASSERT_EQ(iter->second.fail(-1, "too late"), -1);
+		}
+	});
+	completer.join();
+	for (unsigned int index = 0; index < callCount; ++index) {
+		std::future < Json::Value > callFuture = callPromises[index].get_future();
+		ASSERT_EQ(callFuture.wait_for(std::chrono::seconds(1)), std::future_status::ready);
+		ASSERT_EQ(callFuture.get()[hbk::jsonrpc::RESULT].asInt(), static_cast < int > (index * 10));
+	}
+
+	// the changed value is notified before the response is send
+	std::promise < Json::Value > setPromise;
+	callingPeer.setStateValueAsync(statePath, 41, 1.0, std::bind(&cbAsyncJsonResult, std::placeholders::_1, std::ref(setPromise)));
+	ASSERT_EQ(stateSetPromise.get_future().wait_for(std::chrono::seconds(1)), std::future_status::ready);
+	ASSERT_EQ(stateResponder.complete(SetStateCbResult(42, WARN_ADAPTED)), 0);
+	std::future < Json::Value > setFuture = setPromise.get_future();
+	ASSERT_EQ(setFuture.wait_for(std::chrono::seconds(1)), std::future_status::ready);
+	ASSERT_EQ(setFuture.get()[hbk::jsonrpc::RESULT][WARNING][hbk::jsonrpc::CODE], WARN_ADAPTED);
+
+	// not completing at all results in an error response
+	std::promise < Json::Value > droppedPromise;
+	callingPeer.callMethodAsync(droppedPath, Json::Value(), 1.0, std::bind(&cbAsyncJsonResult, std::placeholders::_1, std::ref(droppedPromise)));
+	std::future < Json::Value > droppedFuture = droppedPromise.get_future();
+	ASSERT_EQ(droppedFuture.wait_for(std::chrono::seconds(1)), std::future_status::ready);
+	ASSERT_TRUE(droppedFuture.get().isMember(hbk::jsonrpc::ERR));
+
+	peer.removeMethodAsync(methodPath);
+	peer.removeStateAsync(statePath);
+	peer.removeMethodAsync(droppedPath);
+}
+
+/// collected messages are send at the end of the eventloop cycle, after the window elapsed or on flush
+TEST_F(AsyncTest, test_cork)
+{
+#ifdef USE_UNIX_DOMAIN_SOCKETS
+	hbk::jet::PeerAsync fetchingPeer(eventloop, hbk::jet::JET_UNIX_DOMAIN_SOCKET_NAME, 0, "fetchingPeer");
+#else
+	hbk::jet::PeerAsync fetchingPeer(eventloop, "127.0.0.1", hbk::jet::JETD_TCP_PORT, "fetchingPeer");
+#endif
+	static const int notifyCount = 100;
+	std::string jetPath = "test/corked";
+
+	std::promise < bool > addStatePromise;
+	std::future < bool > addStateFuture = addStatePromise.get_future();
+	peer.cork();
+	peer.addStateAsync(jetPath, 0, std::bind(&cbAsyncBoolResult, std::placeholders::_1, std::ref(addStatePromise)), hbk::jet::stateCallback_t());
+	ASSERT_EQ(addStateFuture.wait_for(std::chrono::milliseconds(1000)), std::future_status::ready);
+	ASSERT_TRUE(addStateFuture.get());
+
+	std::promise < bool > fetchPromise;
+	std::future < bool > fetchFuture = fetchPromise.get_future();
+	hbk::jet::matcher_t match;
+	match.equals = jetPath;
+	int fetchCount = notifyCount;
+	std::promise < void > changesPromise;
+	std::future < void > changesFuture = changesPromise.get_future();
+	hbk::jet::fetchId_t fetchId = fetchingPeer.addFetchAsync(match,
+		std::bind(&fetchCbCountDownOnChange, std::ref(fetchCount), std::ref(changesPromise), std::placeholders::_1),
+		std::bind(&cbAsyncBoolResult, std::placeholders::_1, std::ref(fetchPromise)));
+	ASSERT_EQ(fetchFuture.wait_for(std::chrono::milliseconds(1000)), std::future_status::ready);
+	ASSERT_TRUE(fetchFuture.get());
+
+	// send at the end of the eventloop cycle
+	for (int count = 0; count < notifyCount/2; ++count) {
+		peer.notifyState(jetPath, count);
+	}
+
+	// send on flush
+	peer.cork(std::chrono::seconds(10));
+	for (int count = notifyCount/2; count < notifyCount; ++count) {
+		peer.notifyState(jetPath, count);
+	}
+	peer.flush();
+	ASSERT_EQ(changesFuture.wait_for(std::chrono::milliseconds(1000)), std::future_status::ready);
+	ASSERT_EQ(fetchCount, 0);
+
+	peer.uncork();
+	fetchingPeer.removeFetchAsync(fetchId);
+	peer.removeStateAsync(jetPath);
+}
+
+/// notify via the handle returned when adding the state
+TEST_F(AsyncTest, test_state_handle)
+{
+#ifdef USE_UNIX_DOMAIN_SOCKETS
+	hbk::jet::PeerAsync fetchingPeer(eventloop, hbk::jet::JET_UNIX_DOMAIN_SOCKET_NAME, 0, "fetchingPeer");
+#else
+	hbk::jet::PeerAsync fetchingPeer(eventloop, "127.0.0.1", hbk::jet::JETD_TCP_PORT, "fetchingPeer");
+#endif
+	static const std::string jetPath = "test/handle \"quoted\"";
+
+	hbk::jet::StateHandle noState;
+	ASSERT_FALSE(noState.isRegistered());
+	ASSERT_TRUE(noState.getPath().empty());
+	ASSERT_EQ(peer.notifyState(noState, 1), -1);
+
+	std::promise < bool > addStatePromise;
+	std::future < bool > addStateFuture = addStatePromise.get_future();
+	hbk::jet::StateHandle state = peer.addStateAsync(jetPath, 0, std::bind(&cbAsyncBoolResult, std::placeholders::_1, std::ref(addStatePromise)), hbk::jet::stateCallback_t());
+	ASSERT_TRUE(state.isRegistered());
+	ASSERT_EQ(state.getPath(), jetPath);
+	ASSERT_EQ(addStateFuture.wait_for(std::chrono::milliseconds(1000)), std::future_status::ready);
+	ASSERT_TRUE(addStateFuture.get());
+
+	std::vector < Json::Value > values;
+	std::promise < void > changesPromise;
+	std::future < void > changesFuture = changesPromise.get_future();
+	auto fetchCb = [&](const Json::Value& notification, int)
+	{
+		if (notification[hbk::jet::EVENT]!=hbk::jet::CHANGE) {
+			return;
+		}
+		values.push_back(notification[hbk::jet::VALUE]);
+		if (values.size()==5) {
+			changesPromise.set_value();
+		}
+	};
+	std::promise < bool > fetchPromise;
+	std::future < bool > fetchFuture = fetchPromise.get_future();
+	hbk::jet::matcher_t match;
+	match.equals = jetPath;
+	hbk::jet::fetchId_t fetchId = fetchingPeer.addFetchAsync(match, fetchCb, std::bind(&cbAsyncBoolResult, std::placeholders::_1, std::ref(fetchPromise)));
+	ASSERT_EQ(fetchFuture.wait_for(std::chrono::milliseconds(1000)), std::future_status::ready);
+	ASSERT_TRUE(fetchFuture.get());
+
+	ASSERT_EQ(peer.notifyState(state, -42), 0);
+	ASSERT_EQ(peer.notifyState(state, 42u), 0);
+	ASSERT_EQ(peer.notifyState(state, 0.5), 0);
+	ASSERT_EQ(peer.notifyState(state, true), 0);
+	ASSERT_EQ(peer.notifyState(state, "text \"quoted\""), 0);
+	ASSERT_EQ(changesFuture.wait_for(std::chrono::milliseconds(1000)), std::future_status::ready);
+	ASSERT_EQ(values[0].asInt(), -42);
+	ASSERT_EQ(values[1].asUInt(), 42u);
+	ASSERT_EQ(values[2].asDouble(), 0.5);
+	ASSERT_EQ(values[3].asBool(), true);
+	ASSERT_EQ(values[4].asString(), "text \"quoted\"");
+
+	peer.removeStateAsync(jetPath);
+	ASSERT_FALSE(state.isRegistered());
+	ASSERT_EQ(peer.notifyState(state, 1), -1);
+	fetchingPeer.removeFetchAsync(fetchId);
+}
+
+/// only the latest value of a conflated state is send
+TEST_F(AsyncTest, test_conflate)
+{
+#ifdef USE_UNIX_DOMAIN_SOCKETS
+	hbk::jet::PeerAsync fetchingPeer(eventloop, hbk::jet::JET_UNIX_DOMAIN_SOCKET_NAME, 0, "fetchingPeer");
+#else
+	hbk::jet::PeerAsync fetchingPeer(eventloop, "127.0.0.1", hbk::jet::JETD_TCP_PORT, "fetchingPeer");
+#endif
+	static const int notifyCount = 1000;
+	static const std::string jetPath = "test/conflated";
+
+	std::promise < bool > addStatePromise;
+	std::future < bool > addStateFuture = addStatePromise.get_future();
+	hbk::jet::StateHandle state = peer.addStateAsync(jetPath, -1, std::bind(&cbAsyncBoolResult, std::placeholders::_1, std::ref(addStatePromise)), hbk::jet::stateCallback_t());
+	ASSERT_EQ(addStateFuture.wait_for(std::chrono::milliseconds(1000)), std::future_status::ready);
+	ASSERT_TRUE(addStateFuture.get());
+
+	std::vector < int > values;
+	std::unique_ptr < std::promise < void > > lastValuePromise(new std::promise < void >);
+	std::future < void > lastValueFuture = lastValuePromise->get_future();
+	auto fetchCb = [&](const Json::Value& notification, int)
+	{
+		if (notification[hbk::jet::EVENT]!=hbk::jet::CHANGE) {
+			return;
+		}
+		values.push_back(notification[hbk::jet::VALUE].asInt());
+		if (values.back()==notifyCount-1) {
+			lastValuePromise->set_value();
+		}
+	};
+	std::promise < bool > fetchPromise;
+	std::future < bool > fetchFuture = fetchPromise.get_future();
+	hbk::jet::matcher_t match;
+	match.equals = jetPath;
+	hbk::jet::fetchId_t fetchId = fetchingPeer.addFetchAsync(match, fetchCb, std::bind(&cbAsyncBoolResult, std::placeholders::_1, std::ref(fetchPromise)));
+	ASSERT_EQ(fetchFuture.wait_for(std::chrono::milliseconds(1000)), std::future_status::ready);
+	ASSERT_TRUE(fetchFuture.get());
+
+	// whole peer, send on flush
+	peer.conflate(std::chrono::seconds(10));
+	for (int count = 0; count < notifyCount; ++count) {
+		ASSERT_EQ(peer.notifyState(jetPath, count), 0);
+	}
+	peer.flush();
+	ASSERT_EQ(lastValueFuture.wait_for(std::chrono::milliseconds(1000)), std::future_status::ready);
+	ASSERT_EQ(values.size(), 1u);
+	peer.unconflate();
+
+	// single state, send at the end of the eventloop cycle
+	values.clear();
+	lastValuePromise.reset(new std::promise < void >);
+	lastValueFuture = lastValuePromise->get_future();
+	ASSERT_EQ(peer.conflate(state, true), 0);
+	for (int count = 0; count < notifyCount; ++count) {
+		ASSERT_EQ(peer.notifyState(state, count), 0);
+	}
+	ASSERT_EQ(lastValueFuture.wait_for(std::chrono::milliseconds(1000)), std::future_status::ready);
+	ASSERT_LT(values.size(), static_cast < size_t > (notifyCount));
+	ASSERT_EQ(peer.conflate(state, false), 0);
+
+	fetchingPeer.removeFetchAsync(fetchId);
+	peer.removeStateAsync(jetPath);
+	ASSERT_EQ(peer.conflate(state, true), -1);
+}
+
+#ifndef _WIN32
+/// Listens on a local tcp port and plays the jet daemon.
+/// \return listening socket or -1 on error
+static int listenAsDaemon(unsigned int& port)
+{
+	int listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+	if (listenFd < 0) {
+		return -1;
+	}
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = 0;
+	socklen_t addressLen = sizeof(address);
+	if ((::bind(listenFd, reinterpret_cast < struct sockaddr* > (&address), sizeof(address)) < 0) ||
+		(::getsockname(listenFd, reinterpret_cast < struct sockaddr* > (&address), &addressLen) < 0) ||
+		(::listen(listenFd, 1) < 0)) {
+		::close(listenFd);
+		return -1;
+	}
+	port = ntohs(address.sin_port);
+	return listenFd;
+}
+
+/// send a telegram like the jet daemon does
+static void sendAsDaemon(int fd, const std::string& payload)
+{
+	uint32_t lenBig = htonl(static_cast < uint32_t > (payload.length()));
+	std::string telegram(reinterpret_cast < const char* > (&lenBig), sizeof(lenBig));
+	telegram += payload;
+	ASSERT_EQ(::send(fd, telegram.data(), telegram.length(), 0), static_cast < ssize_t > (telegram.length()));
+}
+
+/// receive a telegram like the jet daemon does
+/// \return null on timeout or error
+static Json::Value receiveAsDaemon(int fd)
+{
+	std::string telegram;
+	size_t expected = sizeof(uint32_t);
+	while (telegram.length() < expected) {
+		struct pollfd pfd;
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		if (::poll(&pfd, 1, 1000) != 1) {
+			return Json::Value();
+		}
+		char buffer[1024];
+		ssize_t result = ::recv(fd, buffer, std::min(sizeof(buffer), expected - telegram.length()), 0);
+		if (result <= 0) {
+			return Json::Value();
+		}
+		telegram.append(buffer, static_cast < size_t > (result));
+		if (telegram.length() == sizeof(uint32_t)) {
+			uint32_t lenBig;
+			memcpy(&lenBig, telegram.data(), sizeof(lenBig));
+			expected += ntohl(lenBig);
+		}
+	}
+	Json::Value message;
+	Json::CharReaderBuilder builder;
+	std::unique_ptr < Json::CharReader > reader(builder.newCharReader());
+	reader->parse(telegram.data() + sizeof(uint32_t), telegram.data() + telegram.length(), &message, nullptr);
+	return message;
+}
+
+/// Plays the jet daemon for an object that adds a fetch and gets destroyed before the response of the fetch arrives.
+/// Returns when the peer processed that response.
+/// \param scope creates the object with the peer given and destroys it again
+/// \param fetchResponse result or error member of the response
+static void destroyBeforeFetchResponse(hbk::sys::EventLoop& eventloop, const std::function < void (hbk::jet::PeerAsync&) >& scope, const std::string& fetchResponse)
+{
+	unsigned int port;
+	int listenFd = listenAsDaemon(port);
+	ASSERT_GE(listenFd, 0);
+	{
+		hbk::jet::PeerAsync fetchingPeer(eventloop, "127.0.0.1", port, "fetchingPeer");
+		int fd = ::accept(listenFd, nullptr, nullptr);
+		ASSERT_GE(fd, 0);
+		ASSERT_EQ(receiveAsDaemon(fd)[hbk::jsonrpc::METHOD], hbk::jet::CONFIG);
+
+		scope(fetchingPeer);
+		Json::Value request = receiveAsDaemon(fd);
+		ASSERT_EQ(request[hbk::jsonrpc::METHOD], hbk::jet::FETCH);
+		ASSERT_EQ(receiveAsDaemon(fd)[hbk::jsonrpc::METHOD], hbk::jet::UNFETCH);
+
+		// responses are processed in order, the fetch response is done when the one of this get arrives
+		std::promise < Json::Value > responsePromise;
+		fetchingPeer.getAsync(hbk::jet::matcher_t(), std::bind(&cbAsyncJsonResult, std::placeholders::_1, std::ref(responsePromise)));
+		Json::Value getRequest = receiveAsDaemon(fd);
+		sendAsDaemon(fd, "{\"id\":" + request[hbk::jsonrpc::ID].toStyledString() + "," + fetchResponse + "}");
+		sendAsDaemon(fd, "{\"id\":" + getRequest[hbk::jsonrpc::ID].toStyledString() + ",\"result\":[]}");
+		std::future < Json::Value > response = responsePromise.get_future();
+		ASSERT_EQ(response.wait_for(std::chrono::seconds(1)), std::future_status::ready);
+		::close(fd);
+	}
+	::close(listenFd);
+}
+
+/// sending does not block if the jet daemon does not read
+TEST_F(AsyncTest, test_send_queue)
+{
+	// a jet daemon that does not read until we tell so
+	unsigned int port;
+	int listenFd = listenAsDaemon(port);
+	ASSERT_GE(listenFd, 0);
+
+	static const size_t lowWatermark = 65536;
+	static const size_t highWatermark = 1048576;
+	std::promise < void > congestedPromise;
+	std::future < void > congestedFuture = congestedPromise.get_future();
+	std::promise < void > relievedPromise;
+	std::future < void > relievedFuture = relievedPromise.get_future();
+	auto backpressureCb = [&](bool congested)
+	{
+		if (congested) {
+			congestedPromise.set_value();
+		} else {
+			relievedPromise.set_value();
+		}
+	};
+
+	{
+		hbk::jet::PeerAsync slowPeer(eventloop, "127.0.0.1", port, "slowPeer");
+		slowPeer.setSendQueueWatermarks(lowWatermark, highWatermark, backpressureCb);
+
+		Json::Value message;
+		message[hbk::jsonrpc::METHOD] = hbk::jet::CHANGE;
+		message[hbk::jsonrpc::PARAMS][hbk::jet::PATH] = "test/queued";
+		message[hbk::jsonrpc::PARAMS][hbk::jet::VALUE] = std::string(16384, 'x');
+		for (unsigned int count = 0; count < 100000; ++count) {
+			slowPeer.sendMessage(message);
+			if (slowPeer.isCongested()) {
+				break;
+			}
+		}
+		ASSERT_TRUE(slowPeer.isCongested());
+		ASSERT_EQ(congestedFuture.wait_for(std::chrono::milliseconds(1000)), std::future_status::ready);
+		hbk::jet::sendQueueStatus_t status = slowPeer.getSendQueueStatus();
+		ASSERT_GT(status.queuedBytes, highWatermark);
+		ASSERT_EQ(status.congestionCount, 1u);
+
+		// read everything
+		int fd = ::accept(listenFd, nullptr, nullptr);
+		ASSERT_GE(fd, 0);
+		char buffer[65536];
+		while (relievedFuture.wait_for(std::chrono::milliseconds(0)) != std::future_status::ready) {
+			struct pollfd pfd = { fd, POLLIN, 0 };
+			ASSERT_EQ(::poll(&pfd, 1, 1000), 1);
+			ASSERT_GT(::recv(fd, buffer, sizeof(buffer), 0), 0);
+		}
+		ASSERT_FALSE(slowPeer.isCongested());
+		status = slowPeer.getSendQueueStatus();
+		ASSERT_LE(status.queuedBytes, lowWatermark);
+		ASSERT_GT(status.maxQueuedBytes, highWatermark);
+		::close(fd);
+	}
+	::close(listenFd);
+}
+
+/// notifications of unknown fetches and requests for unknown states or methods are dropped and counted
+TEST_F(AsyncTest, test_drop_unknown)
+{
+	unsigned int port;
+	int listenFd = listenAsDaemon(port);
+	ASSERT_GE(listenFd, 0);
+	{
+		hbk::jet::PeerAsync otherPeer(eventloop, "127.0.0.1", port, "otherPeer");
+		int fd = ::accept(listenFd, nullptr, nullptr);
+		ASSERT_GE(fd, 0);
+
+		sendAsDaemon(fd, "{\"method\":12345,\"params\":{\"path\":\"removed\",\"event\":\"change\",\"value\":1}}");
+		sendAsDaemon(fd, "{\"id\":1,\"method\":\"unknown/state\",\"params\":{\"value\":1}}");
+		sendAsDaemon(fd, "{\"method\":\"unknown/method\"}");
+		sendAsDaemon(fd, "no json");
+
+		ASSERT_TRUE(waitFor([&otherPeer]() { return otherPeer.getReceiveStatus().telegramCount==4; }));
+		hbk::jet::receiveStatus_t status = otherPeer.getReceiveStatus();
+		ASSERT_EQ(status.telegramCount, 4u);
+		ASSERT_EQ(status.droppedFetchNotificationCount, 1u);
+		ASSERT_EQ(status.droppedRequestCount, 2u);
+		ASSERT_EQ(status.decodeErrorCount, 1u);
+		::close(fd);
+	}
+	::close(listenFd);
+}
+
+/// method callbacks are executed without holding a lock. They may remove themselves and add other methods.
+TEST_F(AsyncTest, test_method_modifies_registry)
+{
+	static const unsigned int methodCount = 100;
+	unsigned int port;
+	int listenFd = listenAsDaemon(port);
+	ASSERT_GE(listenFd, 0);
+	{
+		hbk::jet::PeerAsync methodPeer(eventloop, "127.0.0.1", port, "methodPeer");
+		int fd = ::accept(listenFd, nullptr, nullptr);
+		ASSERT_GE(fd, 0);
+
+		std::atomic < unsigned int > callCount(0);
+		std::atomic < unsigned int > replacementCallCount(0);
+		auto cbReplacement = [&](const Json::Value&) -> Json::Value
+		{
+			++replacementCallCount;
+			return Json::Value();
+		};
+		auto cbReplaceSelf = [&](const Json::Value&) -> Json::Value
+		{
+			++callCount;
+			methodPeer.removeMethodAsync("method/0");
+			methodPeer.addMethodAsync("method/replacement", hbk::jet::responseCallback_t(), cbReplacement);
+			return Json::Value();
+		};
+		auto cbCount = [&](const Json::Value&) -> Json::Value
+		{
+			++callCount;
+			return Json::Value();
+		};
+		methodPeer.addMethodAsync("method/0", hbk::jet::responseCallback_t(), cbReplaceSelf);
+		for (unsigned int index = 1; index < methodCount; ++index) {
+			methodPeer.addMethodAsync("method/" + std::to_string(index), hbk::jet::responseCallback_t(), cbCount);
+		}
+
+		sendAsDaemon(fd, "{\"method\":\"method/0\"}");
+		sendAsDaemon(fd, "{\"method\":\"method/0\"}");
+		sendAsDaemon(fd, "{\"method\":\"method/replacement\"}");
+		sendAsDaemon(fd, "{\"method\":\"method/" + std::to_string(methodCount-1) + "\"}");
+
+		ASSERT_TRUE(waitFor([&methodPeer]() { return methodPeer.getReceiveStatus().telegramCount==4; }));
+		hbk::jet::receiveStatus_t status = methodPeer.getReceiveStatus();
+		ASSERT_EQ(status.telegramCount, 4u);
+		ASSERT_EQ(status.droppedRequestCount, 1u);
+		ASSERT_EQ(callCount, 2u);
+		ASSERT_EQ(replacementCallCount, 1u);
+		::close(fd);
+	}
+	::close(listenFd);
+}
+
+/// a slow method does not block other methods. Requests for the same method stay in order
+TEST_F(AsyncTest, test_callback_workers)
+{
+	unsigned int port;
+	int listenFd = listenAsDaemon(port);
+	ASSERT_GE(listenFd, 0);
+	{
+		hbk::jet::PeerAsync methodPeer(eventloop, "127.0.0.1", port, "methodPeer");
+		methodPeer.setCallbackWorkers(4);
+		int fd = ::accept(listenFd, nullptr, nullptr);
+		ASSERT_GE(fd, 0);
+
+		std::mutex mtx;
+		std::vector < int > order;
+		std::promise < void > slowStarted;
+		std::promise < void > fastExecuted;
+		std::promise < void > releaseSlow;
+		std::shared_future < void > slowReleased = releaseSlow.get_future().share();
+		auto cbSlow = [&](const Json::Value& params) -> Json::Value
+		{
+			if (params.asInt()==0) {
+				slowStarted.set_value();
+				slowReleased.wait();
+			}
+			std::lock_guard < std::mutex > lock(mtx);
+			order.push_back(params.asInt());
+			return Json::Value();
+		};
+		auto cbFast = [&](const Json::Value&) -> Json::Value
+		{
+			fastExecuted.set_value();
+			return Json::Value();
+		};
+		methodPeer.addMethodAsync("slow", hbk::jet::responseCallback_t(), cbSlow);
+		methodPeer.addMethodAsync("fast", hbk::jet::responseCallback_t(), cbFast);
+
+		for (int index = 0; index < 10; ++index) {
+			sendAsDaemon(fd, "{\"id\":" + std::to_string(index) + ",\"method\":\"slow\",\"params\":" + std::to_string(index) + "}");
+		}
+		ASSERT_EQ(slowStarted.get_future().wait_for(std::chrono::seconds(1)), std::future_status::ready);
+		sendAsDaemon(fd, "{\"id\":10,\"method\":\"fast\"}");
+		ASSERT_EQ(fastExecuted.get_future().wait_for(std::chrono::seconds(1)), std::future_status::ready);
+
+		releaseSlow.set_value();
+		methodPeer.setCallbackWorkers(0);
+		ASSERT_EQ(order.size(), 10u);
+		for (int index = 0; index < 10; ++index) {
+			ASSERT_EQ(order[static_cast < size_t > (index)], index);
+		}
+		::close(fd);
+	}
+	::close(listenFd);
+}
+
+/// replacing the workers does not block receiving, a callback being finished might wait for a response.
+/// Callbacks still queued are dropped when the peer is destructed.
+TEST_F(AsyncTest, test_callback_workers_replaced)
+{
+	unsigned int port;
+	int listenFd = listenAsDaemon(port);
+	ASSERT_GE(listenFd, 0);
+	{
+		std::atomic < unsigned int > executedCount(0);
+		std::promise < void > callbackStarted;
+		std::promise < void > slowCallbackStarted;
+		std::promise < std::future_status > getStatus;
+		int fd;
+		{
+			hbk::jet::PeerAsync methodPeer(eventloop, "127.0.0.1", port, "methodPeer");
+			methodPeer.setCallbackWorkers(1);
+			fd = ::accept(listenFd, nullptr, nullptr);
+			ASSERT_GE(fd, 0);
+			ASSERT_EQ(receiveAsDaemon(fd)[hbk::jsonrpc::METHOD], hbk::jet::CONFIG);
+
+			auto cb = [&](const Json::Value& params) -> Json::Value
+			{
+				++executedCount;
+				if (params.asInt()==0) {
+					callbackStarted.set_value();
+					hbk::jet::ResponseFuture response = methodPeer.get(hbk::jet::matcher_t());
+					getStatus.set_value(response.waitFor(std::chrono::seconds(1)) ? std::future_status::ready : std::future_status::timeout);
+				} else if (params.asInt()==1) {
+					slowCallbackStarted.set_value();
+					std::this_thread::sleep_for(std::chrono::milliseconds(100));
+				}
+				return Json::Value();
+			};
+			methodPeer.addMethodAsync("method", hbk::jet::responseCallback_t(), cb);
+			ASSERT_EQ(receiveAsDaemon(fd)[hbk::jsonrpc::METHOD], hbk::jet::ADD);
+
+			sendAsDaemon(fd, "{\"id\":0,\"method\":\"method\",\"params\":0}");
+			ASSERT_EQ(callbackStarted.get_future().wait_for(std::chrono::seconds(1)), std::future_status::ready);
+			std::thread replacing([&methodPeer]()
+			{
+				methodPeer.setCallbackWorkers(1);
+			});
+			Json::Value getRequest = receiveAsDaemon(fd);
+			ASSERT_EQ(getRequest[hbk::jsonrpc::METHOD], hbk::jet::GET);
+			// wait until the workers are being replaced
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			sendAsDaemon(fd, "{\"id\":" + getRequest[hbk::jsonrpc::ID].toStyledString() + ",\"result\":[]}");
+			replacing.join();
+			ASSERT_EQ(getStatus.get_future().get(), std::future_status::ready);
+			ASSERT_EQ(executedCount, 1u);
+
+			for (int index = 1; index < 4; ++index) {
+				sendAsDaemon(fd, "{\"id\":" + std::to_string(index) + ",\"method\":\"method\",\"params\":" + std::to_string(index) + "}");
+			}
+			ASSERT_EQ(slowCallbackStarted.get_future().wait_for(std::chrono::seconds(1)), std::future_status::ready);
+		}
+		// callbacks still queued are dropped on destruction
+		ASSERT_EQ(executedCount, 2u);
+		::close(fd);
+	}
+	::close(listenFd);
+}
+
+/// Callbacks still queued when the connection is lost are dropped. Their request ids belong to the connection that is gone.
+TEST_F(AsyncTest, test_callback_workers_connection_lost)
+{
+	unsigned int port;
+	int listenFd = listenAsDaemon(port);
+	ASSERT_GE(listenFd, 0);
+	{
+		hbk::jet::PeerAsync methodPeer(eventloop, "127.0.0.1", port, "methodPeer");
+		methodPeer.setCallbackWorkers(1);
+		int fd = ::accept(listenFd, nullptr, nullptr);
+		ASSERT_GE(fd, 0);
+		ASSERT_EQ(receiveAsDaemon(fd)[hbk::jsonrpc::METHOD], hbk::jet::CONFIG);
+
+		std::promise < void > restoredPromise;
+		methodPeer.setAutoReconnect(std::chrono::milliseconds(10), std::chrono::milliseconds(100), [&](bool connected)
+		{
+			if (connected) {
+				restoredPromise.set_value();
+			}
+		});
+
+		std::atomic < unsigned int > executedCount(0);
+		std::promise < void > callbackStarted;
+		std::promise < void > releaseCallback;
+		std::shared_future < void > callbackReleased = releaseCallback.get_future().share();
+		auto cb = [&](const Json::Value& params) -> Json::Value
+		{
+			++executedCount;
+			if (params.asInt()==0) {
+				callbackStarted.set_value();
+				callbackReleased.wait();
+			}
+			return Json::Value();
+		};
+		methodPeer.addMethodAsync("method", hbk::jet::responseCallback_t(), cb);
+		ASSERT_EQ(receiveAsDaemon(fd)[hbk::jsonrpc::METHOD], hbk::jet::ADD);
+
+		sendAsDaemon(fd, "{\"id\":0,\"method\":\"method\",\"params\":0}");
+		ASSERT_EQ(callbackStarted.get_future().wait_for(std::chrono::seconds(1)), std::future_status::ready);
+		// queued behind the blocking one
+		sendAsDaemon(fd, "{\"id\":1,\"method\":\"method\",\"params\":1}");
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+		::close(fd);
+		fd = ::accept(listenFd, nullptr, nullptr);
+		ASSERT_GE(fd, 0);
+		ASSERT_EQ(restoredPromise.get_future().wait_for(std::chrono::seconds(1)), std::future_status::ready);
+
+		releaseCallback.set_value();
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		methodPeer.setCallbackWorkers(0);
+		ASSERT_EQ(executedCount, 1u);
+
+		methodPeer.setAutoReconnect(std::chrono::milliseconds(0), std::chrono::milliseconds(0));
+		::close(fd);
+	}
+	::close(listenFd);
+}
+
+/// requests without response are completed with an error object when their deadline passed or when canceled
+TEST_F(AsyncTest, test_request_timeout)
+{
+	static const unsigned int requestCount = 10000;
+	unsigned int port;
+	int listenFd = listenAsDaemon(port);
+	ASSERT_GE(listenFd, 0);
+	{
+		// a jet daemon that never responds
+		hbk::jet::PeerAsync callingPeer(eventloop, "127.0.0.1", port, "callingPeer");
+		int fd = ::accept(listenFd, nullptr, nullptr);
+		ASSERT_GE(fd, 0);
+		callingPeer.setRequestTimeout(std::chrono::milliseconds(50));
+
+		std::atomic < unsigned int > errorCount(0);
+		std::promise < void > allExpiredPromise;
+		auto cbExpired = [&](const Json::Value& response)
+		{
+			if (response.isMember(hbk::jsonrpc::ERR)) {
+				if (++errorCount==requestCount) {
+					allExpiredPromise.set_value();
+				}
+			}
+		};
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (unsigned int index = 0; index < requestCount; ++index) {
+			callingPeer.callMethodAsync("never/answered", Json::Value(), cbExpired);
+		}
+		ASSERT_EQ(allExpiredPromise.get_future().wait_for(std::chrono::seconds(5)), std::future_status::ready);
+		ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+
+		// a canceled request is completed right away, a late response is ignored
+		callingPeer.setRequestTimeout(std::chrono::milliseconds(0));
+		unsigned int canceledCount = 0;
+		auto cbCanceled = [&](const Json::Value& response)
+		{
+			ASSERT_TRUE(response.isMember(hbk::jsonrpc::ERR));
+			++canceledCount;
+		};
+		hbk::jet::requestId_t requestId = callingPeer.setStateValueAsync("never/answered", 1, 0.1, cbCanceled);
+		ASSERT_NE(requestId, 0u);
+		ASSERT_EQ(callingPeer.cancelRequest(requestId), 0);
+		ASSERT_EQ(canceledCount, 1u);
+		ASSERT_EQ(callingPeer.cancelRequest(requestId), -1);
+
+		sendAsDaemon(fd, "{\"id\":" + std::to_string(requestId) + ",\"result\":true}");
+		ASSERT_TRUE(waitFor([&callingPeer]() { return callingPeer.getReceiveStatus().telegramCount==1; }));
+		ASSERT_EQ(canceledCount, 1u);
+		::close(fd);
+	}
+	::close(listenFd);
+}
+
+/// many requests are pipelined, their responses are collected with whenAll
+/// overlapping subscriptions share one fetch of the jet daemon
+TEST_F(AsyncTest, test_fetch_multiplexer)
+{
+	hbk::jet::StateHandle stateA;
+	ASSERT_TRUE(addStateAndWait(peer, "mux/a/1", 1, &stateA).isMember(hbk::jsonrpc::RESULT));
+	ASSERT_TRUE(addStateAndWait(peer, "mux/b/1", 2).isMember(hbk::jsonrpc::RESULT));
+
+	std::mutex mtx;
+	std::vector < std::string > wideEvents;
+	std::vector < std::string > narrowEvents;
+	auto cbRecord = [&mtx](std::vector < std::string >& events, const Json::Value& notification, int status)
+	{
+		if (status==0) {
+			std::lock_guard < std::mutex > lock(mtx);
+			events.push_back(notification[hbk::jet::PATH].asString() + ":" + notification[hbk::jet::EVENT].asString());
+		}
+	};
+	auto eventCount = [&mtx](const std::vector < std::string >& events)
+	{
+		std::lock_guard < std::mutex > lock(mtx);
+		return events.size();
+	};
+	auto waitForEvents = [&eventCount](const std::vector < std::string >& events, size_t count)
+	{
+		waitFor([&eventCount, &events, count]() { return eventCount(events) >= count; });
+		return eventCount(events);
+	};
+
+	hbk::jet::FetchMultiplexer multiplexer(peer);
+	hbk::jet::matcher_t wideMatch;
+	wideMatch.startsWith = "mux/";
+	hbk::jet::FetchMultiplexer::subscriptionId_t wideId = multiplexer.subscribe(wideMatch, std::bind(cbRecord, std::ref(wideEvents), std::placeholders::_1, std::placeholders::_2));
+	ASSERT_EQ(waitForEvents(wideEvents, 2), 2u);
+
+	// not covered by the case sensitive fetch
+	hbk::jet::matcher_t narrowMatch;
+	narrowMatch.startsWith = "mux/A/";
+	narrowMatch.caseInsensitive = true;
+	ASSERT_EQ(multiplexer.subscribe(narrowMatch, [](const Json::Value&, int) {}), wideId + 1);
+	ASSERT_EQ(multiplexer.getFetchCount(), 2u);
+
+	// served by the existing fetch, the element known already is notified at once
+	narrowMatch.caseInsensitive = false;
+	narrowMatch.startsWith = "mux/a/";
+	hbk::jet::FetchMultiplexer::subscriptionId_t narrowId = multiplexer.subscribe(narrowMatch, std::bind(cbRecord, std::ref(narrowEvents), std::placeholders::_1, std::placeholders::_2));
+	ASSERT_EQ(multiplexer.getFetchCount(), 2u);
+	ASSERT_EQ(multiplexer.getSubscriptionCount(), 3u);
+	ASSERT_EQ(eventCount(narrowEvents), 1u);
+	ASSERT_EQ(narrowEvents[0], "mux/a/1:add");
+
+	ASSERT_EQ(peer.notifyState(stateA, 3), 0);
+	ASSERT_EQ(waitForEvents(narrowEvents, 2), 2u);
+	ASSERT_EQ(narrowEvents[1], "mux/a/1:change");
+
+	ASSERT_EQ(multiplexer.unsubscribe(narrowId), 0);
+	ASSERT_EQ(multiplexer.unsubscribe(narrowId), -1);
+	ASSERT_EQ(multiplexer.unsubscribe(wideId), 0);
+	ASSERT_EQ(multiplexer.unsubscribe(wideId + 1), 0);
+	ASSERT_EQ(multiplexer.getFetchCount(), 0u);
+	ASSERT_EQ(multiplexer.getSubscriptionCount(), 0u);
+
+	peer.removeStateAsync("mux/a/1");
+	peer.removeStateAsync("mux/b/1");
+}
+
+/// An error response of the fetch would be passed to the subscriptions
+TEST_F(AsyncTest, test_fetch_multiplexer_destroyed_before_fetch_result)
+{
+	std::atomic < unsigned int > errorCount(0);
+	destroyBeforeFetchResponse(eventloop, [&errorCount](hbk::jet::PeerAsync& fetchingPeer)
+	{
+		hbk::jet::FetchMultiplexer multiplexer(fetchingPeer);
+		hbk::jet::matcher_t match;
+		match.startsWith = "a";
+		multiplexer.subscribe(match, [&errorCount](const Json::Value&, int status)
+		{
+			if (status<0) {
+				++errorCount;
+			}
+		});
+	}, "\"error\":{\"code\":-32602,\"message\":\"invalid fetch\"}");
+	ASSERT_EQ(errorCount, 0u);
+}
+
+TEST_F(AsyncTest, test_get_cache)
+{
+	hbk::jet::StateHandle stateA;
+	ASSERT_TRUE(addStateAndWait(peer, "getcache/a", 1, &stateA).isMember(hbk::jsonrpc::RESULT));
+	ASSERT_TRUE(addStateAndWait(peer, "getcache/b", "b").isMember(hbk::jsonrpc::RESULT));
+
+	hbk::jet::GetCache getCache(peer, 2);
+	hbk::jet::matcher_t match;
+	match.startsWith = "getcache/";
+	Json::Value response = getCache.get(match).get();
+	ASSERT_EQ(response[hbk::jsonrpc::RESULT], peer.get(match).get()[hbk::jsonrpc::RESULT]);
+	ASSERT_EQ(getCache.getMatcherCount(), 1u);
+	ASSERT_EQ(getCache.getStateCount(), 2u);
+
+	// a cached matcher is answered before returning, in the context of the caller
+	auto isAnsweredLocally = [&getCache](const hbk::jet::matcher_t& matcher)
+	{
+		std::promise < bool > promise;
+		std::thread::id caller = std::this_thread::get_id();
+		getCache.getAsync(matcher, [&promise, caller](const Json::Value&)
+		{
+			promise.set_value(std::this_thread::get_id()==caller);
+		});
+		return promise.get_future().get();
+	};
+	ASSERT_TRUE(isAnsweredLocally(match));
+	hbk::jet::matcher_t foldedMatch;
+	foldedMatch.startsWith = "getcache/";
+	foldedMatch.caseInsensitive = true;
+	ASSERT_FALSE(isAnsweredLocally(foldedMatch));
+	hbk::jet::matcher_t sameMatch;
+	sameMatch.startsWith = "GETCACHE/";
+	sameMatch.caseInsensitive = true;
+	ASSERT_TRUE(isAnsweredLocally(sameMatch));
+	ASSERT_EQ(getCache.get(sameMatch).get()[hbk::jsonrpc::RESULT].size(), 2u);
+	ASSERT_EQ(getCache.getMatcherCount(), 2u);
+
+	// kept up to date by the fetch
+	ASSERT_EQ(peer.notifyState(stateA, 2), 0);
+	peer.removeStateAsync("getcache/b");
+	ASSERT_TRUE(waitFor([&getCache, &match]()
+	{
+		Json::Value result = getCache.get(match).get()[hbk::jsonrpc::RESULT];
+		return (result.size()==1) && (result[0][hbk::jet::VALUE]==2);
+	}));
+
+	// the least recently used matcher is dropped
+	hbk::jet::matcher_t otherMatch;
+	otherMatch.equals = "getcache/a";
+	ASSERT_EQ(getCache.get(otherMatch).get()[hbk::jsonrpc::RESULT].size(), 1u);
+	ASSERT_EQ(getCache.getMatcherCount(), 2u);
+	ASSERT_TRUE(isAnsweredLocally(match));
+	ASSERT_FALSE(isAnsweredLocally(sameMatch));
+
+	getCache.clear();
+	ASSERT_EQ(getCache.getMatcherCount(), 0u);
+	ASSERT_EQ(getCache.getStateCount(), 0u);
+	peer.removeStateAsync("getcache/a");
+}
+
+/// states added while no get is done count as well
+TEST_F(AsyncTest, test_get_cache_state_limit_by_notifications)
+{
+	ASSERT_TRUE(addStateAndWait(peer, "getcachelimit/a", 1).isMember(hbk::jsonrpc::RESULT));
+	ASSERT_TRUE(addStateAndWait(peer, "getcachelimit/b", 2).isMember(hbk::jsonrpc::RESULT));
+
+	hbk::jet::GetCache getCache(peer, 4, 3);
+	hbk::jet::matcher_t match;
+	match.startsWith = "getcachelimit/";
+	ASSERT_EQ(getCache.get(match).get()[hbk::jsonrpc::RESULT].size(), 2u);
+	ASSERT_EQ(getCache.getMatcherCount(), 1u);
+	ASSERT_EQ(getCache.getStateCount(), 2u);
+
+	ASSERT_TRUE(addStateAndWait(peer, "getcachelimit/c", 3).isMember(hbk::jsonrpc::RESULT));
+	ASSERT_TRUE(waitFor([&getCache]() { return getCache.getStateCount()==3; }));
+	ASSERT_EQ(getCache.getMatcherCount(), 1u);
+
+	// exceeding the limit drops the matcher together with its states
+	ASSERT_TRUE(addStateAndWait(peer, "getcachelimit/d", 4).isMember(hbk::jsonrpc::RESULT));
+	ASSERT_TRUE(waitFor([&getCache]() { return getCache.getMatcherCount()==0; }));
+	ASSERT_EQ(getCache.getStateCount(), 0u);
+
+	peer.removeStateAsync("getcachelimit/a");
+	peer.removeStateAsync("getcachelimit/b");
+	peer.removeStateAsync("getcachelimit/c");
+	peer.removeStateAsync("getcachelimit/d");
+}
+
+/// The response of the fetch would complete the waiting callbacks, those got completed on destruction already
+TEST_F(AsyncTest, test_get_cache_destroyed_before_fetch_result)
+{
+	std::atomic < unsigned int > resultCount(0);
+	std::atomic < unsigned int > errorCount(0);
+	destroyBeforeFetchResponse(eventloop, [&resultCount, &errorCount](hbk::jet::PeerAsync& fetchingPeer)
+	{
+		hbk::jet::GetCache getCache(fetchingPeer);
+		hbk::jet::matcher_t match;
+		match.startsWith = "a";
+		getCache.getAsync(match, [&resultCount, &errorCount](const Json::Value& result)
+		{
+			++resultCount;
+			if (result.isMember(hbk::jsonrpc::ERR)) {
+				++errorCount;
+			}
+		});
+		ASSERT_EQ(resultCount, 0u);
+	}, "\"result\":true");
+	// completed with an error on destruction only
+	ASSERT_EQ(resultCount, 1u);
+	ASSERT_EQ(errorCount, 1u);
+}
+
+TEST_F(AsyncTest, test_cache)
+{
+	hbk::jet::StateHandle stateA;
+	ASSERT_TRUE(addStateAndWait(peer, "cache/a", 1, &stateA).isMember(hbk::jsonrpc::RESULT));
+	ASSERT_TRUE(addStateAndWait(peer, "cache/b", "b").isMember(hbk::jsonrpc::RESULT));
+
+	std::atomic < unsigned int > removeCount(0);
+	hbk::jet::matcher_t match;
+	match.startsWith = "cache/";
+	// all paths share one shard
+	hbk::jet::cache cache(peer, match, 1);
+	cache.setCbs(hbk::jet::cache::Cb(), hbk::jet::cache::Cb(), [&removeCount](const std::string& path, const Json::Value&)
+	{
+		if (path=="cache/b") {
+			++removeCount;
+		}
+	});
+	ASSERT_TRUE(waitFor([&cache]() { return cache.size()==2; }));
+
+	hbk::jet::cache::entryPtr_t entry = cache.find("cache/a");
+	ASSERT_TRUE(entry);
+	ASSERT_EQ(entry->value, 1);
+	ASSERT_EQ(entry->version, 1u);
+	ASSERT_EQ(cache.getEntry("cache/b"), "b");
+	ASSERT_FALSE(cache.find("cache/unknown"));
+	ASSERT_TRUE(cache.getEntry("cache/unknown").isNull());
+
+	ASSERT_EQ(peer.notifyState(stateA, 2), 0);
+	ASSERT_TRUE(waitFor([&cache]() { return cache.find("cache/a")->version==2; }));
+	ASSERT_EQ(cache.find("cache/a")->value, 2);
+	// the snapshot taken before is immutable
+	ASSERT_EQ(entry->value, 1);
+
+	peer.removeStateAsync("cache/b");
+	ASSERT_TRUE(waitFor([&cache]() { return cache.size()==1; }));
+	ASSERT_EQ(removeCount, 1u);
+	std::vector < std::string > paths;
+	cache.forEach([&paths](const std::string& path, const hbk::jet::cache::entryPtr_t&)
+	{
+		paths.push_back(path);
+	});
+	ASSERT_EQ(paths, std::vector < std::string > ({ "cache/a" }));
+
+	peer.removeStateAsync("cache/a");
+}
+
+TEST_F(AsyncTest, test_cache_snapshot)
+{
+	const std::string snapshotFileName = tempFileName(".snapshot");
+	hbk::jet::StateHandle stateA;
+	ASSERT_TRUE(addStateAndWait(peer, "snapshot/a", 1, &stateA).isMember(hbk::jsonrpc::RESULT));
+	ASSERT_TRUE(addStateAndWait(peer, "snapshot/b", "b").isMember(hbk::jsonrpc::RESULT));
+	ASSERT_TRUE(addStateAndWait(peer, "snapshot/c", Json::Value(Json::objectValue)).isMember(hbk::jsonrpc::RESULT));
+
+	hbk::jet::matcher_t match;
+	match.startsWith = "snapshot/";
+	{
+		hbk::jet::cache cache(peer, match);
+		ASSERT_TRUE(waitFor([&cache]() { return cache.size()==3; }));
+		ASSERT_EQ(peer.notifyState(stateA, 2), 0);
+		ASSERT_TRUE(waitFor([&cache]() { return cache.find("snapshot/a")->version==2; }));
+		ASSERT_EQ(cache.saveSnapshotFile(snapshotFileName), 0);
+	}
+
+	// changed while there was no cache
+	ASSERT_EQ(peer.notifyState(stateA, 3), 0);
+	peer.removeStateAsync("snapshot/c");
+
+	std::atomic < unsigned int > changeCount(0);
+	std::atomic < unsigned int > removeCount(0);
+	hbk::jet::cache cache(peer, match, snapshotFileName, hbk::jet::cache::Cb(), [&changeCount](const std::string&, const Json::Value&)
+	{
+		++changeCount;
+	}, [&removeCount](const std::string& path, const Json::Value& value)
+	{
+		if ((path=="snapshot/c") && (value.isObject())) {
+			++removeCount;
+		}
+	});
+	// served before the fetch delivers anything
+	ASSERT_EQ(cache.getEntry("snapshot/b"), "b");
+
+	// callbacks are called after the cache got updated
+	ASSERT_TRUE(waitFor([&removeCount]() { return removeCount==1; }));
+	ASSERT_EQ(cache.size(), 2u);
+	ASSERT_TRUE(waitFor([&changeCount]() { return changeCount==1; }));
+	ASSERT_EQ(cache.find("snapshot/a")->value, 3);
+	ASSERT_EQ(cache.find("snapshot/a")->version, 3u);
+	ASSERT_EQ(cache.find("snapshot/b")->version, 1u);
+
+	// a damaged snapshot file is not used
+	const std::string damagedFileName = tempFileName(".damaged");
+	{
+		std::ofstream file(damagedFileName, std::ios::binary | std::ios::trunc);
+		file << "JETCACHE";
+	}
+	hbk::jet::cache emptyCache(peer, match, damagedFileName);
+	ASSERT_TRUE(waitFor([&emptyCache]() { return emptyCache.size()==2; }));
+	std::remove(damagedFileName.c_str());
+	std::remove(snapshotFileName.c_str());
+
+	peer.removeStateAsync("snapshot/a");
+	peer.removeStateAsync("snapshot/b");
+}
+
+/// The response of the fetch would remove the elements of the snapshot file that were not confirmed
+TEST_F(AsyncTest, test_cache_destroyed_before_fetch_result)
+{
+	const std::string snapshotFileName = tempFileName(".snapshot");
+	hbk::jet::matcher_t match;
+	match.startsWith = "destroyed/";
+	ASSERT_TRUE(addStateAndWait(peer, "destroyed/a", 1).isMember(hbk::jsonrpc::RESULT));
+	{
+		hbk::jet::cache cache(peer, match);
+		ASSERT_TRUE(waitFor([&cache]() { return cache.size()==1; }));
+		ASSERT_EQ(cache.saveSnapshotFile(snapshotFileName), 0);
+	}
+	peer.removeStateAsync("destroyed/a");
+
+	std::atomic < unsigned int > removeCount(0);
+	destroyBeforeFetchResponse(eventloop, [&](hbk::jet::PeerAsync& fetchingPeer)
+	{
+		hbk::jet::cache cache(fetchingPeer, match, snapshotFileName, hbk::jet::cache::Cb(), hbk::jet::cache::Cb(), [&removeCount](const std::string&, const Json::Value&)
+		{
+			++removeCount;
+		});
+		ASSERT_EQ(cache.size(), 1u);
+	}, "\"result\":true");
+	ASSERT_EQ(removeCount, 0u);
+	std::remove(snapshotFileName.c_str());
+}
+
+TEST_F(AsyncTest, test_cache_index)
+{
+	static const size_t stateCount = 600;
+	std::vector < hbk::jet::StateSpec > states;
+	states.push_back(hbk::jet::StateSpec("index/dev1/a", 1));
+	states.push_back(hbk::jet::StateSpec("index/dev1/b", 2));
+	states.push_back(hbk::jet::StateSpec("index/dev10/a", 3));
+	states.push_back(hbk::jet::StateSpec("index/dev2/a", 4));
+	// more than one chunk of the index
+	for (size_t index = 0; index < stateCount; ++index) {
+		states.push_back(hbk::jet::StateSpec("index/many/" + std::to_string(index), static_cast < Json::UInt64 > (index)));
+	}
+	std::promise < void > addPromise;
+	peer.addStatesAsync(states, [&addPromise](const std::vector < Json::Value >&)
+	{
+		addPromise.set_value();
+	});
+	ASSERT_EQ(addPromise.get_future().wait_for(std::chrono::seconds(5)), std::future_status::ready);
+
+	hbk::jet::matcher_t match;
+	match.startsWith = "index/";
+	hbk::jet::cache cache(peer, match, 4);
+	ASSERT_TRUE(waitFor([&cache, &states]() { return cache.size()==states.size(); }));
+
+	std::vector < std::string > paths;
+	auto collect = [&paths](const std::string& path, const hbk::jet::cache::entryPtr_t& entry)
+	{
+		if (entry) {
+			paths.push_back(path);
+		}
+	};
+	cache.forEachWithPrefix("index/dev1/", collect);
+	ASSERT_EQ(paths, std::vector < std::string > ({ "index/dev1/a", "index/dev1/b" }));
+	paths.clear();
+	cache.forEachInRange("index/dev1/b", "index/dev2/", collect);
+	ASSERT_EQ(paths, std::vector < std::string > ({ "index/dev1/b", "index/dev10/a" }));
+	paths.clear();
+	cache.forEachMatching("index/*/a", collect);
+	ASSERT_EQ(paths, std::vector < std::string > ({ "index/dev1/a", "index/dev10/a", "index/dev2/a" }));
+	paths.clear();
+	cache.forEachMatching("index/dev?/a", collect);
+	ASSERT_EQ(paths, std::vector < std::string > ({ "index/dev1/a", "index/dev2/a" }));
+	paths.clear();
+	cache.forEachMatching("index/**", collect);
+	ASSERT_EQ(paths.size(), states.size());
+	ASSERT_TRUE(std::is_sorted(paths.begin(), paths.end()));
+	paths.clear();
+	cache.forEachInRange("", "", collect);
+	ASSERT_EQ(paths.size(), states.size());
+	paths.clear();
+
+	// kept up to date by the fetch
+	for (const auto &iter: states) {
+		if (iter.path!="index/dev2/a") {
+			peer.removeStateAsync(iter.path);
+		}
+	}
+	ASSERT_TRUE(waitFor([&cache]() { return cache.size()==1; }));
+	cache.forEachWithPrefix("index/", collect);
+	ASSERT_EQ(paths, std::vector < std::string > ({ "index/dev2/a" }));
+	peer.removeStateAsync("index/dev2/a");
+}
+
+TEST_F(AsyncTest, test_futures)
+{
+	static const unsigned int requestCount = 1000;
+	static const char methodPath[] = "future/method";
+	static const char statePath[] = "future/state";
+	auto cbDouble = [](const Json::Value& params) -> Json::Value
+	{
+		return params.asInt() * 2;
+	};
+	auto cbSet = [](const Json::Value& value, const std::string&) -> SetStateCbResult
+	{
+		return SetStateCbResult(value);
+	};
+	std::promise < Json::Value > addMethodPromise;
+	std::promise < Json::Value > addStatePromise;
+	peer.addMethodAsync(methodPath, std::bind(&cbAsyncJsonResult, std::placeholders::_1, std::ref(addMethodPromise)), cbDouble);
+	peer.addStateAsync(statePath, 0, std::bind(&cbAsyncJsonResult, std::placeholders::_1, std::ref(addStatePromise)), cbSet);
+	ASSERT_TRUE(addMethodPromise.get_future().get().isMember(hbk::jsonrpc::RESULT));
+	ASSERT_TRUE(addStatePromise.get_future().get().isMember(hbk::jsonrpc::RESULT));
+
+	std::vector < hbk::jet::Future < int > > calls;
+	std::vector < hbk::jet::ResponseFuture > sets;
+	for (unsigned int index = 0; index < requestCount; ++index) {
+		calls.push_back(peer.callMethod(methodPath, index, 1.0).then([](const hbk::jet::JsonRpcResponseObject& response)
+		{
+			return response[hbk::jsonrpc::RESULT].asInt();
+		}));
+		sets.push_back(peer.setStateValue(statePath, index, 1.0));
+	}
+
+	hbk::jet::Future < std::vector < int > > allCalls = hbk::jet::whenAll(calls);
+	hbk::jet::Future < std::vector < hbk::jet::JsonRpcResponseObject > > allSets = hbk::jet::whenAll(sets);
+	ASSERT_TRUE(allCalls.waitFor(std::chrono::seconds(5)));
+	ASSERT_TRUE(allSets.waitFor(std::chrono::seconds(5)));
+	for (unsigned int index = 0; index < requestCount; ++index) {
+		ASSERT_EQ(allCalls.get()[index], static_cast < int > (index) * 2);
+		ASSERT_TRUE(allSets.get()[index].isMember(hbk::jsonrpc::RESULT));
+	}
+
+	hbk::jet::matcher_t match;
+	match.equals = statePath;
+	Json::Value getResponse = peer.get(match).get();
+	ASSERT_EQ(getResponse[hbk::jsonrpc::RESULT][0][hbk::jet::VALUE].asUInt(), requestCount - 1);
+
+	// error objects are responses too
+	Json::Value errorResponse = peer.callMethod("future/unknown", Json::Value(), 1.0).get();
+	ASSERT_TRUE(errorResponse.isMember(hbk::jsonrpc::ERR));
+
+	peer.removeMethodAsync(methodPath);
+	peer.removeStateAsync(statePath);
+}
+
+/// many states and methods are added with all requests in flight at once
+TEST_F(AsyncTest, test_add_batch)
+{
+	static const size_t stateCount = 5000;
+	std::vector < hbk::jet::StateSpec > states;
+	std::atomic < unsigned int > setCount(0);
+	auto cbSet = [&setCount](const Json::Value& value, const std::string&) -> SetStateCbResult
+	{
+		++setCount;
+		return SetStateCbResult(value);
+	};
+	for (size_t index = 0; index < stateCount; ++index) {
+		states.push_back(hbk::jet::StateSpec("batch/state/" + std::to_string(index), static_cast < Json::UInt64 > (index), cbSet, 1.0));
+	}
+	// fails
+	states.push_back(hbk::jet::StateSpec("", 0));
+
+	std::promise < std::vector < Json::Value > > statesPromise;
+	std::vector < hbk::jet::StateHandle > handles = peer.addStatesAsync(states, [&statesPromise](const std::vector < Json::Value >& results)
+	{
+		statesPromise.set_value(results);
+	});
+	ASSERT_EQ(handles.size(), states.size());
+	std::future < std::vector < Json::Value > > statesFuture = statesPromise.get_future();
+	ASSERT_EQ(statesFuture.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+	std::vector < Json::Value > results = statesFuture.get();
+	ASSERT_EQ(results.size(), states.size());
+	for (size_t index = 0; index < stateCount; ++index) {
+		ASSERT_TRUE(results[index].isMember(hbk::jsonrpc::RESULT));
+		ASSERT_TRUE(handles[index].isRegistered());
+	}
+	ASSERT_TRUE(results.back().isMember(hbk::jsonrpc::ERR));
+	ASSERT_FALSE(handles.back().isRegistered());
+
+	std::vector < hbk::jet::MethodSpec > methods;
+	methods.push_back(hbk::jet::MethodSpec("batch/method/echo", [](const Json::Value& params) { return params; }));
+	methods.push_back(hbk::jet::MethodSpec("batch/method/negate", [](const Json::Value& params) { return Json::Value(-params.asInt()); }));
+	std::promise < std::vector < Json::Value > > methodsPromise;
+	peer.addMethodsAsync(methods, [&methodsPromise](const std::vector < Json::Value >& results)
+	{
+		methodsPromise.set_value(results);
+	});
+	std::vector < Json::Value > methodResults = methodsPromise.get_future().get();
+	ASSERT_EQ(methodResults.size(), 2u);
+	ASSERT_TRUE(methodResults[0].isMember(hbk::jsonrpc::RESULT));
+	ASSERT_TRUE(methodResults[1].isMember(hbk::jsonrpc::RESULT));
+
+	hbk::jet::matcher_t match;
+	match.startsWith = "batch/state/";
+	ASSERT_EQ(peer.get(match).get()[hbk::jsonrpc::RESULT].size(), stateCount);
+	ASSERT_TRUE(peer.setStateValue("batch/state/42", 43, 1.0).get().isMember(hbk::jsonrpc::RESULT));
+	ASSERT_EQ(setCount, 1u);
+	ASSERT_EQ(peer.callMethod("batch/method/negate", 5, 1.0).get()[hbk::jsonrpc::RESULT].asInt(), -5);
+
+	// an empty batch completes without a request, in eventloop context
+	std::promise < bool > emptyPromise;
+	std::thread::id caller = std::this_thread::get_id();
+	peer.addMethodsAsync(std::vector < hbk::jet::MethodSpec > (), [&emptyPromise, caller](const std::vector < Json::Value >& results)
+	{
+		emptyPromise.set_value(results.empty() && (std::this_thread::get_id()!=caller));
+	});
+	std::future < bool > emptyCompleted = emptyPromise.get_future();
+	ASSERT_EQ(emptyCompleted.wait_for(std::chrono::seconds(1)), std::future_status::ready);
+	ASSERT_TRUE(emptyCompleted.get());
+
+	for (const auto &iter: methods) {
+		peer.removeMethodAsync(iter.path);
+	}
+	for (size_t index = 0; index < stateCount; ++index) {
+		peer.removeStateAsync(states[index].path);
+	}
+}
+
+/// states and methods are added again with their latest values after reconnecting
+TEST_F(AsyncTest, test_auto_reconnect)
+{
+	unsigned int port;
+	int listenFd = listenAsDaemon(port);
+	ASSERT_GE(listenFd, 0);
+	{
+		hbk::jet::PeerAsync owningPeer(eventloop, "127.0.0.1", port, "owningPeer");
+		int fd = ::accept(listenFd, nullptr, nullptr);
+		ASSERT_GE(fd, 0);
+
+		std::mutex mtx;
+		std::vector < bool > connectionEvents;
+		std::promise < void > lostPromise;
+		std::promise < void > restoredPromise;
+		auto cbConnection = [&](bool connected)
+		{
+			std::lock_guard < std::mutex > lock(mtx);
+			connectionEvents.push_back(connected);
+			if (connected) {
+				restoredPromise.set_value();
+			} else {
+				lostPromise.set_value();
+			}
+		};
+		owningPeer.setAutoReconnect(std::chrono::milliseconds(10), std::chrono::milliseconds(100), cbConnection);
+
+		hbk::jet::userGroups_t groups;
+		groups.push_back("admin");
+		hbk::jet::StateHandle state = owningPeer.addStateAsync("reconnect/state", groups, groups, 1, 2.0, hbk::jet::responseCallback_t(),
+			[](const Json::Value& value, const std::string&) { return SetStateCbResult(value); });
+		owningPeer.addMethodAsync("reconnect/method", 3.0, hbk::jet::responseCallback_t(), [](const Json::Value& params) { return params; });
+		ASSERT_EQ(owningPeer.notifyState(state, 42), 0);
+
+		// the jet daemon restarts
+		::close(fd);
+		ASSERT_EQ(lostPromise.get_future().wait_for(std::chrono::seconds(1)), std::future_status::ready);
+		ASSERT_TRUE(state.isRegistered());
+		fd = ::accept(listenFd, nullptr, nullptr);
+		ASSERT_GE(fd, 0);
+		ASSERT_EQ(restoredPromise.get_future().wait_for(std::chrono::seconds(1)), std::future_status::ready);
+
+		// config first, then all states and methods at once
+		Json::Value message = receiveAsDaemon(fd);
+		ASSERT_EQ(message[hbk::jsonrpc::METHOD], hbk::jet::CONFIG);
+		Json::Value batch = receiveAsDaemon(fd);
+		ASSERT_TRUE(batch.isArray());
+		ASSERT_EQ(batch.size(), 2u);
+		for (const auto &request: batch) {
+			ASSERT_EQ(request[hbk::jsonrpc::METHOD], hbk::jet::ADD);
+			const Json::Value& params = request[hbk::jsonrpc::PARAMS];
+			if (params[hbk::jet::PATH]=="reconnect/state") {
+				ASSERT_EQ(params[hbk::jet::VALUE], 42);
+				ASSERT_EQ(params[hbk::jet::TIMEOUT], 2.0);
+				ASSERT_EQ(params[hbk::jet::ACCESS][hbk::jet::SET_GROUPS][0], "admin");
+			} else {
+				ASSERT_EQ(params[hbk::jet::PATH], "reconnect/method");
+				ASSERT_EQ(params[hbk::jet::TIMEOUT], 3.0);
+				ASSERT_FALSE(params.isMember(hbk::jet::VALUE));
+			}
+			sendAsDaemon(fd, "{\"id\":" + request[hbk::jsonrpc::ID].toStyledString() + ",\"result\":true}");
+		}
+		ASSERT_TRUE(state.isRegistered());
+		{
+			std::lock_guard < std::mutex > lock(mtx);
+			ASSERT_EQ(connectionEvents, std::vector < bool > ({ false, true }));
+		}
+		owningPeer.setAutoReconnect(std::chrono::milliseconds(0), std::chrono::milliseconds(0));
+		::close(fd);
+	}
+	::close(listenFd);
+}
+
+/// all fetches are restored with one batch. A fetch that can not be restored is removed.
+TEST_F(AsyncTest, test_restore_fetches)
+{
+	unsigned int port;
+	int listenFd = listenAsDaemon(port);
+	ASSERT_GE(listenFd, 0);
+	{
+		hbk::jet::PeerAsync fetchingPeer(eventloop, "127.0.0.1", port, "fetchingPeer");
+		int fd = ::accept(listenFd, nullptr, nullptr);
+		ASSERT_GE(fd, 0);
+
+		std::promise < void > restoredPromise;
+		fetchingPeer.setAutoReconnect(std::chrono::milliseconds(10), std::chrono::milliseconds(100), [&](bool connected)
+		{
+			if (connected) {
+				restoredPromise.set_value();
+			}
+		});
+
+		std::atomic < unsigned int > lostCount(0);
+		std::promise < Json::Value > failedPromise;
+		hbk::jet::matcher_t match;
+		match.startsWith = "a";
+		hbk::jet::fetchId_t keptFetchId = fetchingPeer.addFetchAsync(match, [](const Json::Value&, int) {});
+		match.startsWith = "b";
+		hbk::jet::fetchId_t failingFetchId = fetchingPeer.addFetchAsync(match, [&](const Json::Value& notification, int status)
+		{
+			if (status>=0) {
+				return;
+			}
+			if (notification.isNull()) {
+				++lostCount;
+			} else {
+				failedPromise.set_value(notification);
+			}
+		});
+		// config and the initial fetch requests
+		for (unsigned int count = 0; count < 3; ++count) {
+			ASSERT_FALSE(receiveAsDaemon(fd).isNull());
+		}
+
+		::close(fd);
+		fd = ::accept(listenFd, nullptr, nullptr);
+		ASSERT_GE(fd, 0);
+		ASSERT_EQ(restoredPromise.get_future().wait_for(std::chrono::seconds(1)), std::future_status::ready);
+		ASSERT_EQ(lostCount, 1u);
+
+		Json::Value message = receiveAsDaemon(fd);
+		ASSERT_EQ(message[hbk::jsonrpc::METHOD], hbk::jet::CONFIG);
+		Json::Value batch = receiveAsDaemon(fd);
+		ASSERT_TRUE(batch.isArray());
+		ASSERT_EQ(batch.size(), 2u);
+		for (const auto &request: batch) {
+			ASSERT_EQ(request[hbk::jsonrpc::METHOD], hbk::jet::FETCH);
+			ASSERT_TRUE(request.isMember(hbk::jsonrpc::ID));
+			const Json::Value& params = request[hbk::jsonrpc::PARAMS];
+			std::string id = request[hbk::jsonrpc::ID].toStyledString();
+			if (params[hbk::jsonrpc::ID]==keptFetchId) {
+				ASSERT_EQ(params[hbk::jet::PATH][hbk::jet::STARTSWITH], "a");
+				sendAsDaemon(fd, "{\"id\":" + id + ",\"result\":true}");
+			} else {
+				ASSERT_EQ(params[hbk::jsonrpc::ID], failingFetchId);
+				sendAsDaemon(fd, "{\"id\":" + id + ",\"error\":{\"code\":-32602,\"message\":\"invalid fetch\"}}");
+			}
+		}
+
+		std::future < Json::Value > failed = failedPromise.get_future();
+		ASSERT_EQ(failed.wait_for(std::chrono::seconds(1)), std::future_status::ready);
+		ASSERT_EQ(failed.get()[hbk::jsonrpc::ERR][hbk::jsonrpc::CODE], -32602);
+
+		// only the restored fetch is left
+		fetchingPeer.setAutoReconnect(std::chrono::milliseconds(0), std::chrono::milliseconds(0));
+		ASSERT_EQ(fetchingPeer.getReceiveStatus().droppedFetchNotificationCount, 0u);
+		sendAsDaemon(fd, "{\"method\":" + std::to_string(failingFetchId) + ",\"params\":{\"path\":\"b\",\"event\":\"change\",\"value\":1}}");
+		ASSERT_TRUE(waitFor([&fetchingPeer]() { return fetchingPeer.getReceiveStatus().droppedFetchNotificationCount==1; }));
+		::close(fd);
+	}
+	::close(listenFd);
+}
+
+/// a late notification of a removed fetch does not hit the fetch reusing its slot
+TEST_F(AsyncTest, test_restore_fetches_timeout)
+{
+	unsigned int port;
+	int listenFd = listenAsDaemon(port);
+	ASSERT_GE(listenFd, 0);
+	{
+		hbk::jet::PeerAsync fetchingPeer(eventloop, "127.0.0.1", port, "fetchingPeer");
+		int fd = ::accept(listenFd, nullptr, nullptr);
+		ASSERT_GE(fd, 0);
+
+		std::promise < void > restoredPromise;
+		fetchingPeer.setAutoReconnect(std::chrono::milliseconds(10), std::chrono::milliseconds(100), [&](bool connected)
+		{
+			if (connected) {
+				restoredPromise.set_value();
+			}
+		});
+
+		std::promise < Json::Value > notifiedPromise;
+		std::atomic < unsigned int > errorCount(0);
+		hbk::jet::matcher_t match;
+		match.startsWith = "a";
+		hbk::jet::fetchId_t fetchId = fetchingPeer.addFetchAsync(match, [&](const Json::Value& notification, int status)
+		{
+			if (status>=0) {
+				notifiedPromise.set_value(notification);
+			} else if (!notification.isNull()) {
+				++errorCount;
+			}
+		});
+		// config and the initial fetch request
+		for (unsigned int count = 0; count < 2; ++count) {
+			ASSERT_FALSE(receiveAsDaemon(fd).isNull());
+		}
+
+		fetchingPeer.setRequestTimeout(std::chrono::milliseconds(50));
+		::close(fd);
+		fd = ::accept(listenFd, nullptr, nullptr);
+		ASSERT_GE(fd, 0);
+		ASSERT_EQ(restoredPromise.get_future().wait_for(std::chrono::seconds(1)), std::future_status::ready);
+		ASSERT_EQ(receiveAsDaemon(fd)[hbk::jsonrpc::METHOD], hbk::jet::CONFIG);
+		ASSERT_TRUE(receiveAsDaemon(fd).isArray());
+
+		// the restore request times out without response. This is no reason to forget the fetch.
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		ASSERT_EQ(errorCount, 0u);
+		sendAsDaemon(fd, "{\"method\":" + std::to_string(fetchId) + ",\"params\":{\"path\":\"a\",\"event\":\"change\",\"value\":1}}");
+		std::future < Json::Value > notified = notifiedPromise.get_future();
+		ASSERT_EQ(notified.wait_for(std::chrono::seconds(1)), std::future_status::ready);
+		ASSERT_EQ(notified.get()[hbk::jet::PATH], "a");
+
+		fetchingPeer.setAutoReconnect(std::chrono::milliseconds(0), std::chrono::milliseconds(0));
+		::close(fd);
+	}
+	::close(listenFd);
+}
+
+TEST_F(AsyncTest, test_fetch_id_reuse)
+{
+	unsigned int port;
+	int listenFd = listenAsDaemon(port);
+	ASSERT_GE(listenFd, 0);
+	{
+		hbk::jet::PeerAsync fetchingPeer(eventloop, "127.0.0.1", port, "fetchingPeer");
+		int fd = ::accept(listenFd, nullptr, nullptr);
+		ASSERT_GE(fd, 0);
+
+		std::atomic < unsigned int > removedCount(0);
+		std::atomic < unsigned int > reusedCount(0);
+		hbk::jet::matcher_t match;
+		hbk::jet::fetchId_t removedFetchId = fetchingPeer.addFetchAsync(match, [&](const Json::Value&, int status)
+		{
+			if (status==0) {
+				++removedCount;
+			}
+		});
+		fetchingPeer.removeFetchAsync(removedFetchId);
+		hbk::jet::fetchId_t reusedFetchId = fetchingPeer.addFetchAsync(match, [&](const Json::Value&, int status)
+		{
+			if (status==0) {
+				++reusedCount;
+			}
+		});
+		ASSERT_NE(removedFetchId, reusedFetchId);
+
+		sendAsDaemon(fd, "{\"method\":" + std::to_string(removedFetchId) + ",\"params\":{\"path\":\"a\",\"event\":\"change\",\"value\":1}}");
+		sendAsDaemon(fd, "{\"method\":" + std::to_string(reusedFetchId) + ",\"params\":{\"path\":\"a\",\"event\":\"change\",\"value\":2}}");
+		ASSERT_TRUE(waitFor([&fetchingPeer]() { return fetchingPeer.getReceiveStatus().telegramCount==2; }));
+		hbk::jet::receiveStatus_t status = fetchingPeer.getReceiveStatus();
+		ASSERT_EQ(status.telegramCount, 2u);
+		ASSERT_EQ(status.droppedFetchNotificationCount, 1u);
+		ASSERT_EQ(removedCount, 0u);
+		ASSERT_EQ(reusedCount, 1u);
+		::close(fd);
+	}
+	::close(listenFd);
+}
+#endif
+
 TEST_F(AsyncTest, test_method_timeout)
 {
 
@@ -714,6 +2281,59 @@ TEST_F(AsyncTest, test_stop_before_result)
 	peer.removeMethodAsync(jetPath);
 }
 
+/// stopping a peer cancels its own open requests only. Requests of other peers are still waiting for their response!
+TEST_F(AsyncTest, test_stop_other_peer_before_result)
+{
+	std::promise < Json::Value > addMethodPromise;
+	std::future < Json::Value > addMethodFuture = addMethodPromise.get_future();
+	std::promise < Json::Value > execMethodPromise;
+	std::future < Json::Value > execMethodFuture = execMethodPromise.get_future();
+
+	std::string jetPath = "test/hello";
+
+	bool executed = false;
+
+	auto cb_helloAfterSomeTime = []( const Json::Value& ) -> Json::Value
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		Json::Value retVal;
+		retVal = "hello";
+		return retVal;
+	};
+
+	auto cbAsyncCanceled = [&](const Json::Value& result)
+	{
+		ASSERT_EQ(result[hbk::jsonrpc::ERR][hbk::jsonrpc::CODE].asInt(), -1);
+		executed = true;
+	};
+
+	peer.addMethodAsync(jetPath, std::bind(&cbAsyncJsonResult, std::placeholders::_1, std::ref(addMethodPromise)), cb_helloAfterSomeTime);
+	addMethodFuture.wait();
+
+#ifdef USE_UNIX_DOMAIN_SOCKETS
+	hbk::jet::PeerAsync callingPeer(eventloop, hbk::jet::JET_UNIX_DOMAIN_SOCKET_NAME, 0, "callingPeer");
+#else
+	hbk::jet::PeerAsync callingPeer(eventloop, "127.0.0.1", hbk::jet::JETD_TCP_PORT, "callingPeer");
+#endif
+	callingPeer.callMethodAsync(jetPath, Json::Value(), 1.0, std::bind(&cbAsyncJsonResult, std::placeholders::_1, std::ref(execMethodPromise)));
+
+	{
+#ifdef USE_UNIX_DOMAIN_SOCKETS
+		hbk::jet::PeerAsync stoppedPeer(eventloop, hbk::jet::JET_UNIX_DOMAIN_SOCKET_NAME, 0, "stoppedPeer");
+#else
+		hbk::jet::PeerAsync stoppedPeer(eventloop, "127.0.0.1", hbk::jet::JETD_TCP_PORT, "stoppedPeer");
+#endif
+		stoppedPeer.callMethodAsync(jetPath, Json::Value(), 1.0, cbAsyncCanceled);
+	}
+	ASSERT_TRUE(executed);
+
+	std::future_status futureStatus = execMethodFuture.wait_for(std::chrono::milliseconds(2000));
+	ASSERT_EQ(futureStatus, std::future_status::ready);
+	Json::Value result = execMethodFuture.get();
+	ASSERT_EQ(result[hbk::jsonrpc::RESULT].asString(), "hello");
+	peer.removeMethodAsync(jetPath);
+}
+
 /// a fetch callback throws on shutwon of the peer. This has to be caught by the peer!
 TEST_F(AsyncTest, test_stop_excaption)
 {
@@ -0,0 +1,222 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <json/value.h>
+
+#include "jet/coroutine.hpp"
+#include "jet/defines.h"
+#include "jet/peerasync.hpp"
+#include "hbk/sys/eventloop.h"
+#include "hbk/jsonrpc/jsonrpc_defines.h"
+
+#ifndef _WIN32
+#define USE_UNIX_DOMAIN_SOCKETS
+#endif
+
+namespace hbk::jet {
+
+static const char methodPath[] = "coroutine/method";
+static const char statePath[] = "coroutine/state";
+static const char deferredMethodPath[] = "coroutine/deferred";
+
+class CoroutineTest : public ::testing::Test {
+
+protected:
+	hbk::sys::EventLoop eventloop;
+
+	hbk::jet::PeerAsync peer;
+	// we promise to wait for the result before leaving!
+	std::future <int > asy;
+
+	CoroutineTest()
+#ifdef USE_UNIX_DOMAIN_SOCKETS
+		: peer(eventloop, hbk::jet::JET_UNIX_DOMAIN_SOCKET_NAME, 0, "CoroutineTest")
+#else
+		: peer(eventloop, "127.0.0.1", hbk::jet::JETD_TCP_PORT, "CoroutineTest")
+#endif
+	{
+		asy = std::async(std::launch::async, &hbk::sys::EventLoop::execute, std::ref(eventloop));
+	}
+
+	virtual ~CoroutineTest()
+	{
+		eventloop.stop();
+		asy.wait();
+	}
+};
+
+static Future < int > doubled(Future < int > value)
+{
+	int result = co_await value;
+	co_return result * 2;
+}
+
+/// set the state, call the method with the value of the state and return the result of the method
+static Future < int > sequence(PeerAsync& peer, int value)
+{
+	JsonRpcResponseObject response = co_await peer.setStateValue(statePath, value, 1.0);
+	if (!response.isMember(hbk::jsonrpc::RESULT)) {
+		throw std::runtime_error("set failed");
+	}
+	response = co_await peer.callMethod(methodPath, value, 1.0);
+	if (!response.isMember(hbk::jsonrpc::RESULT)) {
+		throw std::runtime_error("call failed");
+	}
+	co_return response[hbk::jsonrpc::RESULT].asInt();
+}
+
+/// stopping the peer cancels all pending requests
+class StoppablePeer : public PeerAsync
+{
+public:
+	using PeerAsync::PeerAsync;
+	using PeerAsync::stop;
+};
+
+/// await the response of the method and tell where the coroutine got resumed
+static Future < int > awaitResponse(PeerAsync& peer, std::thread::id& resumedIn)
+{
+	JsonRpcResponseObject response = co_await peer.callMethod(deferredMethodPath, Json::Value(), 10.0);
+	resumedIn = std::this_thread::get_id();
+	co_return response.isMember(hbk::jsonrpc::ERR) ? -1 : 0;
+}
+
+TEST(coroutine, test_await)
+{
+	Promise < int > promise;
+	Future < int > result = doubled(promise.getFuture());
+	ASSERT_FALSE(result.isReady());
+
+	std::thread worker([&promise]()
+	{
+		promise.setValue(21);
+	});
+	ASSERT_TRUE(result.waitFor(std::chrono::seconds(1)));
+	worker.join();
+	ASSERT_EQ(result.get(), 42);
+
+	// awaiting a future that is ready already does not suspend
+	ASSERT_EQ(doubled(result).get(), 84);
+}
+
+TEST(coroutine, test_exception)
+{
+	Promise < int > promise;
+	Future < int > result = doubled(promise.getFuture());
+	promise.setException(std::make_exception_ptr(std::runtime_error("broken")));
+	ASSERT_THROW(result.get(), std::runtime_error);
+}
+
+/// many sequences of dependent requests are executed concurrently without a thread each
+TEST_F(CoroutineTest, test_sequences)
+{
+	static const int sequenceCount = 200;
+	auto cbNegate = [](const Json::Value& params) -> Json::Value
+	{
+		return -params.asInt();
+	};
+	auto cbSet = [](const Json::Value& value, const std::string&) -> SetStateCbResult
+	{
+		return SetStateCbResult(value);
+	};
+	Future < JsonRpcResponseObject > addMethod = [&]()
+	{
+		Promise < JsonRpcResponseObject > promise;
+		peer.addMethodAsync(methodPath, [promise](const Json::Value& response) mutable { promise.setValue(response); }, cbNegate);
+		return promise.getFuture();
+	}();
+	Future < JsonRpcResponseObject > addState = [&]()
+	{
+		Promise < JsonRpcResponseObject > promise;
+		peer.addStateAsync(statePath, 0, [promise](const Json::Value& response) mutable { promise.setValue(response); }, cbSet);
+		return promise.getFuture();
+	}();
+	ASSERT_TRUE(addMethod.get().isMember(hbk::jsonrpc::RESULT));
+	ASSERT_TRUE(addState.get().isMember(hbk::jsonrpc::RESULT));
+
+	std::vector < Future < int > > sequences;
+	for (int index = 0; index < sequenceCount; ++index) {
+		sequences.push_back(sequence(peer, index));
+	}
+	Future < std::vector < int > > all = whenAll(sequences);
+	ASSERT_TRUE(all.waitFor(std::chrono::seconds(5)));
+	for (int index = 0; index < sequenceCount; ++index) {
+		ASSERT_EQ(all.get()[static_cast < size_t > (index)], -index);
+	}
+
+	peer.removeMethodAsync(methodPath);
+	peer.removeStateAsync(statePath);
+}
+
+/// a coroutine awaiting a request canceled by another thread is resumed in the eventloop
+TEST_F(CoroutineTest, test_resume_in_eventloop)
+{
+	std::promise < std::thread::id > requestedPromise;
+	std::vector < Responder > responders;
+	auto cbDeferred = [&](const Json::Value&, Responder responder)
+	{
+		// never completed before the request is canceled
+		responders.push_back(responder);
+		requestedPromise.set_value(std::this_thread::get_id());
+	};
+	Future < JsonRpcResponseObject > addMethod = [&]()
+	{
+		Promise < JsonRpcResponseObject > promise;
+		peer.addDeferredMethodAsync(deferredMethodPath, 10.0, [promise](const Json::Value& response) mutable { promise.setValue(response); }, cbDeferred);
+		return promise.getFuture();
+	}();
+	ASSERT_TRUE(addMethod.get().isMember(hbk::jsonrpc::RESULT));
+
+#ifdef USE_UNIX_DOMAIN_SOCKETS
+	StoppablePeer callingPeer(eventloop, hbk::jet::JET_UNIX_DOMAIN_SOCKET_NAME, 0, "callingPeer");
+#else
+	StoppablePeer callingPeer(eventloop, "127.0.0.1", hbk::jet::JETD_TCP_PORT, "callingPeer");
+#endif
+	std::thread::id resumedIn;
+	Future < int > result = awaitResponse(callingPeer, resumedIn);
+	std::future < std::thread::id > requested = requestedPromise.get_future();
+	ASSERT_EQ(requested.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+	std::thread::id eventloopThread = requested.get();
+	ASSERT_NE(eventloopThread, std::this_thread::get_id());
+
+	// canceling completes the request in this thread
+	callingPeer.stop();
+	ASSERT_TRUE(result.waitFor(std::chrono::seconds(5)));
+	ASSERT_EQ(result.get(), -1);
+	ASSERT_EQ(resumedIn, eventloopThread);
+
+	peer.removeMethodAsync(deferredMethodPath);
+}
+}
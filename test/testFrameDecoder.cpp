@@ -0,0 +1,169 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#include <string>
+#include <vector>
+
+#include <json/value.h>
+
+#include <gtest/gtest.h>
+
+#include "hbk/jsonrpc/jsonrpc_defines.h"
+
+#include "jet/defines.h"
+#include "jet/framedecoder.hpp"
+
+/// remembers everything consumed
+class RecordingConsumer : public hbk::jet::FrameConsumer
+{
+public:
+	RecordingConsumer()
+		: consumedFetchId(1)
+		, consumedPath("some/state")
+	{
+	}
+
+	virtual void consumeMessage(const Json::Value& message) override
+	{
+		messages.push_back(message);
+	}
+
+	virtual bool isFetchConsumed(hbk::jet::fetchId_t fetchId) override
+	{
+		return fetchId==consumedFetchId;
+	}
+
+	virtual bool isRequestConsumed(const std::string& path) override
+	{
+		return path==consumedPath;
+	}
+
+	virtual void consumeFetchNotification(hbk::jet::fetchId_t fetchId, const Json::Value& params) override
+	{
+		Json::Value message;
+		message[hbk::jsonrpc::METHOD] = fetchId;
+		message[hbk::jsonrpc::PARAMS] = params;
+		fetchNotifications.push_back(message);
+	}
+
+	hbk::jet::fetchId_t consumedFetchId;
+	std::string consumedPath;
+	std::vector < Json::Value > messages;
+	std::vector < Json::Value > fetchNotifications;
+};
+
+static bool decode(hbk::jet::FrameDecoder& decoder, const std::string& telegram, RecordingConsumer& consumer)
+{
+	std::string errorMessage;
+	return decoder.decode(telegram.c_str(), telegram.length(), consumer, errorMessage);
+}
+
+TEST(frameDecoder, testFetchNotification)
+{
+	static const std::string telegram = "{\"method\":1,\"params\":{\"path\":\"a/{\\\"b\\\"}\",\"event\":\"change\",\"value\":[1,{\"c\":\"]}\"}]}}";
+	hbk::jet::ScanningFrameDecoder scanningDecoder;
+	RecordingConsumer scanned;
+	ASSERT_TRUE(decode(scanningDecoder, telegram, scanned));
+	ASSERT_TRUE(scanned.messages.empty());
+	ASSERT_EQ(scanned.fetchNotifications.size(), 1u);
+
+	hbk::jet::JsonFrameDecoder jsonDecoder;
+	RecordingConsumer parsed;
+	ASSERT_TRUE(decode(jsonDecoder, telegram, parsed));
+	ASSERT_EQ(parsed.messages.size(), 1u);
+	ASSERT_EQ(scanned.fetchNotifications[0], parsed.messages[0]);
+	ASSERT_EQ(scanned.fetchNotifications[0][hbk::jsonrpc::PARAMS][hbk::jet::PATH].asString(), "a/{\"b\"}");
+}
+
+TEST(frameDecoder, testUnknownFetch)
+{
+	// parameters are not parsed, only skipped
+	static const std::string telegram = " {\"params\":{\"value\":[tru,]}, \"method\" : -7 } ";
+	hbk::jet::ScanningFrameDecoder decoder;
+	RecordingConsumer consumer;
+	ASSERT_TRUE(decode(decoder, telegram, consumer));
+	ASSERT_TRUE(consumer.messages.empty());
+	ASSERT_TRUE(consumer.fetchNotifications.empty());
+
+	consumer.consumedFetchId = -7;
+	ASSERT_FALSE(decode(decoder, telegram, consumer));
+	ASSERT_TRUE(consumer.fetchNotifications.empty());
+}
+
+TEST(frameDecoder, testUnknownRequest)
+{
+	static const std::string telegram = "{\"id\":6,\"method\":\"other/state\",\"params\":{\"value\":[tru,]}}";
+	hbk::jet::ScanningFrameDecoder decoder;
+	RecordingConsumer consumer;
+	ASSERT_TRUE(decode(decoder, telegram, consumer));
+	ASSERT_TRUE(consumer.messages.empty());
+
+	consumer.consumedPath = "other/state";
+	ASSERT_FALSE(decode(decoder, telegram, consumer));
+}
+
+TEST(frameDecoder, testOtherMessages)
+{
+	static const std::vector < std::string > telegrams = {
+		"{\"id\":5,\"result\":{}}",
+		"{\"id\":6,\"method\":\"some/state\",\"params\":{\"value\":4}}",
+		"{\"id\":\"a\",\"method\":\"some\\/state\",\"params\":{\"value\":4}}",
+		"{\"method\":1,\"id\":7,\"params\":{}}",
+		"{\"method\":1.5,\"params\":{}}",
+		"{\"method\":99999999999,\"params\":{}}",
+		"{\"m\\u0065thod\":1,\"params\":{}}",
+		"[{\"method\":1,\"params\":{}},{\"id\":8,\"result\":true}]",
+		"{}",
+	};
+	hbk::jet::ScanningFrameDecoder scanningDecoder;
+	hbk::jet::JsonFrameDecoder jsonDecoder;
+	for (const std::string& telegram: telegrams) {
+		RecordingConsumer scanned;
+		RecordingConsumer parsed;
+		ASSERT_TRUE(decode(scanningDecoder, telegram, scanned)) << telegram;
+		ASSERT_TRUE(decode(jsonDecoder, telegram, parsed)) << telegram;
+		ASSERT_TRUE(scanned.fetchNotifications.empty()) << telegram;
+		ASSERT_EQ(scanned.messages, parsed.messages) << telegram;
+	}
+}
+
+TEST(frameDecoder, testInvalid)
+{
+	static const std::vector < std::string > telegrams = {
+		"",
+		"{",
+		"{\"method\":1,\"params\":{}",
+		"{\"method\":1,\"params\":{\"path\":\"unterminated}}",
+		"{\"method\":1,\"params\":{\"value\":tru}}",
+		"{\"method\":1 \"params\":{}}",
+	};
+	hbk::jet::ScanningFrameDecoder decoder;
+	for (const std::string& telegram: telegrams) {
+		RecordingConsumer consumer;
+		ASSERT_FALSE(decode(decoder, telegram, consumer)) << telegram;
+		ASSERT_TRUE(consumer.messages.empty()) << telegram;
+		ASSERT_TRUE(consumer.fetchNotifications.empty()) << telegram;
+	}
+}
@@ -0,0 +1,136 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "jet/future.hpp"
+
+using namespace hbk::jet;
+
+TEST(future, test_then)
+{
+	Promise < int > promise;
+	Future < std::string > future = promise.getFuture().then([](const int& value)
+	{
+		return std::to_string(value * 2);
+	});
+	ASSERT_FALSE(future.isReady());
+	promise.setValue(21);
+	ASSERT_TRUE(future.isReady());
+	ASSERT_EQ(future.get(), "42");
+
+	// attached to a future that is ready already
+	Future < int > next = future.then([](const std::string& value)
+	{
+		return static_cast < int > (value.size());
+	});
+	ASSERT_TRUE(next.isReady());
+	ASSERT_EQ(next.get(), 2);
+}
+
+TEST(future, test_set_once)
+{
+	Promise < int > promise;
+	Future < int > future = promise.getFuture();
+	promise.setValue(1);
+	promise.setValue(2);
+	promise.setException(std::make_exception_ptr(std::runtime_error("too late")));
+	ASSERT_EQ(future.get(), 1);
+}
+
+TEST(future, test_exception)
+{
+	Promise < int > promise;
+	bool called = false;
+	Future < int > future = promise.getFuture().then([&called](const int& value)
+	{
+		called = true;
+		return value;
+	});
+	promise.setException(std::make_exception_ptr(std::runtime_error("broken")));
+	ASSERT_FALSE(called);
+	ASSERT_THROW(future.get(), std::runtime_error);
+
+	// exception thrown by the continuation
+	Promise < int > other;
+	Future < int > thrown = other.getFuture().then([](const int& value) -> int
+	{
+		throw std::runtime_error(std::to_string(value));
+	});
+	other.setValue(1);
+	ASSERT_THROW(thrown.get(), std::runtime_error);
+}
+
+TEST(future, test_when_all)
+{
+	static const size_t COUNT = 10;
+	std::vector < Promise < size_t > > promises(COUNT);
+	std::vector < Future < size_t > > futures;
+	for (const auto& iter: promises) {
+		futures.push_back(iter.getFuture());
+	}
+	Future < std::vector < size_t > > all = whenAll(futures);
+
+	// completed from another thread in reverse order
+	std::thread worker([&promises]()
+	{
+		for (size_t index = COUNT; index > 0; --index) {
+			promises[index-1].setValue(index-1);
+		}
+	});
+	ASSERT_TRUE(all.waitFor(std::chrono::seconds(5)));
+	worker.join();
+	const std::vector < size_t >& values = all.get();
+	ASSERT_EQ(values.size(), COUNT);
+	for (size_t index = 0; index < COUNT; ++index) {
+		ASSERT_EQ(values[index], index);
+	}
+}
+
+TEST(future, test_when_all_exception)
+{
+	Promise < int > first;
+	Promise < int > second;
+	Future < std::vector < int > > all = whenAll(std::vector < Future < int > > { first.getFuture(), second.getFuture() });
+	second.setException(std::make_exception_ptr(std::runtime_error("broken")));
+	ASSERT_FALSE(all.isReady());
+	first.setValue(1);
+	ASSERT_THROW(all.get(), std::runtime_error);
+}
+
+TEST(future, test_when_all_empty)
+{
+	Future < std::vector < int > > all = whenAll(std::vector < Future < int > > ());
+	ASSERT_TRUE(all.isReady());
+	ASSERT_TRUE(all.get().empty());
+	ASSERT_FALSE(Future < int > ().valid());
+}
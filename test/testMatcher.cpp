@@ -0,0 +1,246 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+
+
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "jet/compiledmatcher.hpp"
+#include "jet/defines.h"
+
+using namespace hbk::jet;
+
+/// straight forward evaluation as reference
+static bool matchReference(const matcher_t& matcher, const std::string& path)
+{
+	auto fold = [&matcher](std::string text)
+	{
+		if (matcher.caseInsensitive) {
+			for (auto &character: text) {
+				if ((character >= 'A') && (character <= 'Z')) {
+					character = static_cast < char > (character - 'A' + 'a');
+				}
+			}
+		}
+		return text;
+	};
+	std::string subject = fold(path);
+	if ((!matcher.contains.empty()) && (subject.find(fold(matcher.contains))==std::string::npos)) {
+		return false;
+	}
+	if ((!matcher.startsWith.empty()) && (subject.compare(0, matcher.startsWith.length(), fold(matcher.startsWith))!=0)) {
+		return false;
+	}
+	if (!matcher.endsWith.empty()) {
+		if ((subject.length() < matcher.endsWith.length()) || (subject.compare(subject.length() - matcher.endsWith.length(), matcher.endsWith.length(), fold(matcher.endsWith))!=0)) {
+			return false;
+		}
+	}
+	if ((!matcher.equals.empty()) && (subject!=fold(matcher.equals))) {
+		return false;
+	}
+	if ((!matcher.equalsNot.empty()) && (subject==fold(matcher.equalsNot))) {
+		return false;
+	}
+	for (const auto &iter: matcher.containsAllOf) {
+		if (subject.find(fold(iter))==std::string::npos) {
+			return false;
+		}
+	}
+	return true;
+}
+
+TEST(matcher, test_conditions)
+{
+	matcher_t matcher;
+	ASSERT_TRUE(CompiledMatcher(matcher).match(""));
+	ASSERT_TRUE(CompiledMatcher().match("any/path"));
+
+	matcher.startsWith = "devices/";
+	matcher.endsWith = "/value";
+	CompiledMatcher compiled(matcher);
+	ASSERT_TRUE(compiled.match("devices/a/value"));
+	ASSERT_FALSE(compiled.match("devices/a/values"));
+	ASSERT_FALSE(compiled.match("Devices/a/value"));
+	ASSERT_FALSE(compiled.match("devices/"));
+
+	matcher = matcher_t();
+	matcher.equals = "a/b";
+	ASSERT_TRUE(CompiledMatcher(matcher).match("a/b"));
+	ASSERT_FALSE(CompiledMatcher(matcher).match("a/bc"));
+	matcher.caseInsensitive = true;
+	ASSERT_TRUE(CompiledMatcher(matcher).match("A/B"));
+
+	matcher = matcher_t();
+	matcher.equalsNot = "a/b";
+	ASSERT_FALSE(CompiledMatcher(matcher).match("a/b"));
+	ASSERT_TRUE(CompiledMatcher(matcher).match("a/b/c"));
+
+	matcher = matcher_t();
+	matcher.containsAllOf.push_back("channel");
+	matcher.containsAllOf.push_back("measured");
+	ASSERT_TRUE(CompiledMatcher(matcher).match("device/measured/channel1"));
+	ASSERT_FALSE(CompiledMatcher(matcher).match("device/channel1"));
+}
+
+TEST(matcher, test_contains)
+{
+	// needles found at each position, also beyond the blocks compared at once
+	const std::string needle = "xyz0123456789abcdefg";
+	for (size_t needleLength = 1; needleLength <= needle.length(); ++needleLength) {
+		matcher_t matcher;
+		matcher.contains = needle.substr(0, needleLength);
+		CompiledMatcher compiled(matcher);
+		for (size_t pathLength = needleLength; pathLength < 70; ++pathLength) {
+			for (size_t pos = 0; pos + needleLength <= pathLength; ++pos) {
+				std::string path(pathLength, '-');
+				path.replace(pos, needleLength, matcher.contains);
+				ASSERT_TRUE(compiled.match(path)) << path << " " << matcher.contains;
+				// last character differs
+				path[pos + needleLength - 1] = '-';
+				ASSERT_FALSE(compiled.match(path)) << path << " " << matcher.contains;
+			}
+		}
+	}
+}
+
+TEST(matcher, test_case_insensitive)
+{
+	matcher_t matcher;
+	matcher.caseInsensitive = true;
+	matcher.contains = "MeasuredValue";
+	CompiledMatcher compiled(matcher);
+	ASSERT_TRUE(compiled.match("device/channel1/MEASUREDVALUE/unit"));
+	ASSERT_TRUE(compiled.match("device/channel1/measuredvalue/with/a/path/longer/than/the/buffer/on/the/stack/" + std::string(300, 'x')));
+	ASSERT_FALSE(compiled.match("device/channel1/measured_value"));
+
+	// only ASCII is folded, other bytes are compared as they are
+	matcher.contains = "\xc3\x84";
+	ASSERT_TRUE(CompiledMatcher(matcher).match("a/\xc3\x84/b"));
+	ASSERT_FALSE(CompiledMatcher(matcher).match("a/\xc3\xa4/b"));
+	ASSERT_EQ(CompiledMatcher::foldCase("ABCXYZ@[`{\xc3\x84 0123456789abcdefghijklmnopqrstUVWXYZ"), "abcxyz@[`{\xc3\x84 0123456789abcdefghijklmnopqrstuvwxyz");
+}
+
+TEST(matcher, test_random)
+{
+	std::mt19937 generator(42);
+	// a small alphabet for many partial matches
+	const std::string alphabet = "aAbB/";
+	auto randomText = [&](size_t maxLength)
+	{
+		std::string text(generator() % (maxLength + 1), ' ');
+		for (auto &character: text) {
+			character = alphabet[generator() % alphabet.size()];
+		}
+		return text;
+	};
+
+	std::vector < std::string > paths;
+	for (unsigned int index = 0; index < 2000; ++index) {
+		paths.push_back(randomText(40));
+	}
+
+	MatcherSet matcherSet;
+	std::vector < matcher_t > matchers;
+	for (unsigned int index = 0; index < 200; ++index) {
+		matcher_t matcher;
+		matcher.caseInsensitive = (generator() % 2)==0;
+		switch (generator() % 6) {
+		case 0:
+			matcher.contains = randomText(5);
+			break;
+		case 1:
+			matcher.startsWith = randomText(3);
+			break;
+		case 2:
+			matcher.endsWith = randomText(3);
+			break;
+		case 3:
+			matcher.equals = paths[generator() % paths.size()];
+			break;
+		case 4:
+			matcher.equalsNot = paths[generator() % paths.size()];
+			break;
+		default:
+			matcher.containsAllOf.push_back(randomText(3));
+			matcher.containsAllOf.push_back(randomText(3));
+			break;
+		}
+		matchers.push_back(matcher);
+		ASSERT_EQ(matcherSet.add(matcher), index);
+	}
+
+	std::vector < size_t > matches;
+	for (const auto &path: paths) {
+		std::vector < size_t > expected;
+		for (size_t index = 0; index < matchers.size(); ++index) {
+			bool match = matchReference(matchers[index], path);
+			ASSERT_EQ(CompiledMatcher(matchers[index]).match(path), match) << path << " " << matchers[index].print();
+			if (match) {
+				expected.push_back(index);
+			}
+		}
+		matcherSet.match(path, matches);
+		ASSERT_EQ(matches, expected) << path;
+		ASSERT_EQ(matcherSet.matchAny(path), !expected.empty());
+	}
+}
+
+TEST(matcher, test_matcher_set)
+{
+	MatcherSet matcherSet;
+	ASSERT_FALSE(matcherSet.matchAny("a"));
+
+	matcher_t matcher;
+	matcher.equals = "a/b";
+	matcher.endsWith = "c";
+	matcherSet.add(matcher);
+	matcher = matcher_t();
+	matcher.equals = "A/B";
+	matcher.caseInsensitive = true;
+	matcherSet.add(matcher);
+	matcher = matcher_t();
+	matcher.startsWith = "a/";
+	matcherSet.add(matcher);
+	ASSERT_EQ(matcherSet.size(), 3u);
+
+	std::vector < size_t > matches;
+	matcherSet.match("a/b", matches);
+	ASSERT_EQ(matches, std::vector < size_t > ({ 1, 2 }));
+	matcherSet.match("A/b", matches);
+	ASSERT_EQ(matches, std::vector < size_t > ({ 1 }));
+	matcherSet.match("b", matches);
+	ASSERT_TRUE(matches.empty());
+	ASSERT_FALSE(matcherSet.matchAny("b"));
+
+	matcherSet.clear();
+	ASSERT_EQ(matcherSet.size(), 0u);
+	ASSERT_FALSE(matcherSet.matchAny("a/b"));
+}
@@ -0,0 +1,161 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "receivebuffer.h"
+
+static const size_t maxTelegramSize = 16;
+static const size_t chunkSize = 8;
+
+/// \return payload with big endian length information in front
+static std::string frame(const std::string& payload)
+{
+	std::string telegram;
+	size_t len = payload.length();
+	telegram += static_cast < char > ((len >> 24) & 0xff);
+	telegram += static_cast < char > ((len >> 16) & 0xff);
+	telegram += static_cast < char > ((len >> 8) & 0xff);
+	telegram += static_cast < char > (len & 0xff);
+	return telegram + payload;
+}
+
+/// remembers all telegrams handed out
+class ReceiveBufferTest : public ::testing::Test
+{
+protected:
+	ReceiveBufferTest()
+		: buffer(maxTelegramSize, chunkSize)
+		, telegrams()
+	{
+	}
+
+	/// copy data as a read from the socket would do
+	/// \return result of commit
+	int receive(const std::string& data)
+	{
+		EXPECT_GE(buffer.space(), data.length());
+		data.copy(buffer.writePosition(), data.length());
+		return buffer.commit(data.length(), [this](const char* pTelegram, size_t len)
+		{
+			telegrams.push_back(std::string(pTelegram, len));
+		});
+	}
+
+	hbk::jet::ReceiveBuffer buffer;
+	std::vector < std::string > telegrams;
+};
+
+TEST_F(ReceiveBufferTest, test_several_frames_in_one_read)
+{
+	ASSERT_EQ(receive(frame("first") + frame("") + frame("third")), 0);
+	ASSERT_EQ(telegrams.size(), 3u);
+	ASSERT_EQ(telegrams[0], "first");
+	ASSERT_EQ(telegrams[1], "");
+	ASSERT_EQ(telegrams[2], "third");
+	ASSERT_EQ(buffer.level(), 0u);
+}
+
+TEST_F(ReceiveBufferTest, test_frame_split_across_reads)
+{
+	// split within the length information and within the payload
+	std::string data = frame("split telegram");
+	for (size_t index = 0; index < data.length(); ++index) {
+		ASSERT_TRUE(telegrams.empty());
+		ASSERT_EQ(receive(data.substr(index, 1)), 0);
+	}
+	ASSERT_EQ(telegrams.size(), 1u);
+	ASSERT_EQ(telegrams[0], "split telegram");
+	ASSERT_EQ(buffer.level(), 0u);
+}
+
+TEST_F(ReceiveBufferTest, test_compaction)
+{
+	size_t emptySpace = buffer.space();
+	// a complete telegram followed by the start of the next one
+	std::string next = frame("0123456789");
+	ASSERT_EQ(receive(frame("abc") + next.substr(0, 6)), 0);
+	ASSERT_EQ(telegrams.size(), 1u);
+	ASSERT_EQ(telegrams[0], "abc");
+
+	// the incomplete rest is moved to the front
+	ASSERT_EQ(buffer.level(), 6u);
+	ASSERT_EQ(buffer.space(), emptySpace-6);
+	ASSERT_EQ(buffer.announcedLength(), 10u);
+
+	ASSERT_EQ(receive(next.substr(6)), 0);
+	ASSERT_EQ(telegrams.size(), 2u);
+	ASSERT_EQ(telegrams[1], "0123456789");
+	ASSERT_EQ(buffer.level(), 0u);
+	ASSERT_EQ(buffer.space(), emptySpace);
+}
+
+TEST_F(ReceiveBufferTest, test_maximum_size_frame)
+{
+	std::string largest(maxTelegramSize, 'x');
+	std::string data = frame(largest);
+	// an incomplete telegram of maximum size still leaves room for a chunk
+	ASSERT_EQ(receive(data.substr(0, data.length()-1)), 0);
+	ASSERT_TRUE(telegrams.empty());
+	ASSERT_GE(buffer.space(), chunkSize);
+	ASSERT_EQ(receive(data.substr(data.length()-1)), 0);
+	ASSERT_EQ(telegrams.size(), 1u);
+	ASSERT_EQ(telegrams[0], largest);
+
+	// one byte more is rejected before the payload is received
+	ASSERT_EQ(receive(frame(largest + "x").substr(0, 4)), -1);
+	ASSERT_EQ(telegrams.size(), 1u);
+	ASSERT_EQ(buffer.announcedLength(), maxTelegramSize+1);
+}
+
+TEST_F(ReceiveBufferTest, test_rejected_after_complete_frames)
+{
+	// telegrams before the one being too large are handed out
+	ASSERT_EQ(receive(frame("ok") + frame(std::string(maxTelegramSize+1, 'x')).substr(0, 4)), -1);
+	ASSERT_EQ(telegrams.size(), 1u);
+	ASSERT_EQ(telegrams[0], "ok");
+	ASSERT_EQ(buffer.announcedLength(), maxTelegramSize+1);
+}
+
+TEST_F(ReceiveBufferTest, test_clear_from_callback)
+{
+	std::string data = frame("first") + frame("dropped");
+	data.copy(buffer.writePosition(), data.length());
+	ASSERT_EQ(buffer.commit(data.length(), [this](const char* pTelegram, size_t len)
+	{
+		telegrams.push_back(std::string(pTelegram, len));
+		// like a peer restarted by a callback
+		buffer.clear();
+	}), 0);
+	ASSERT_EQ(telegrams.size(), 1u);
+	ASSERT_EQ(buffer.level(), 0u);
+
+	ASSERT_EQ(receive(frame("new")), 0);
+	ASSERT_EQ(telegrams.size(), 2u);
+	ASSERT_EQ(telegrams[1], "new");
+}
@@ -0,0 +1,132 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <cmath>
+#include <limits>
+#include <string>
+
+#include <json/value.h>
+#include <json/writer.h>
+
+#include <gtest/gtest.h>
+
+#include "hbk/jsonrpc/jsonrpc_defines.h"
+
+#include "jet/defines.h"
+#include "telegramwriter.h"
+
+/// What we write has to be the same as the composition done by jsoncpp
+static std::string jsoncppChange(const std::string& path, const Json::Value& value)
+{
+	Json::StreamWriterBuilder wBuilder;
+	wBuilder.settings_["indentation"] = "";
+	Json::Value data;
+	data[hbk::jsonrpc::METHOD] = hbk::jet::CHANGE;
+	data[hbk::jsonrpc::PARAMS][hbk::jet::PATH] = path;
+	data[hbk::jsonrpc::PARAMS][hbk::jet::VALUE] = value;
+	return Json::writeString(wBuilder, data);
+}
+
+static std::string jsoncppValue(const Json::Value& value)
+{
+	Json::StreamWriterBuilder wBuilder;
+	wBuilder.settings_["indentation"] = "";
+	return Json::writeString(wBuilder, value);
+}
+
+TEST(telegramWriter, testChange)
+{
+	static const std::string path = "test/with \"quotes\" and \\ backslash\n\t";
+	std::string telegram = hbk::jet::telegramWriter::composeChangePrefix(path);
+	hbk::jet::telegramWriter::appendInt(telegram, -42);
+	telegram += "}}";
+	ASSERT_EQ(telegram, jsoncppChange(path, -42));
+}
+
+TEST(telegramWriter, testIntegers)
+{
+	static const int64_t signedValues[] = { 0, 1, -1, 42, -42, std::numeric_limits < int64_t >::max(), std::numeric_limits < int64_t >::min() };
+	for (int64_t value: signedValues) {
+		std::string out;
+		hbk::jet::telegramWriter::appendInt(out, value);
+		ASSERT_EQ(out, jsoncppValue(Json::Int64(value)));
+	}
+
+	static const uint64_t unsignedValues[] = { 0, 1, 10, 4294967296u, std::numeric_limits < uint64_t >::max() };
+	for (uint64_t value: unsignedValues) {
+		std::string out;
+		hbk::jet::telegramWriter::appendUInt(out, value);
+		ASSERT_EQ(out, jsoncppValue(Json::UInt64(value)));
+	}
+}
+
+TEST(telegramWriter, testDouble)
+{
+	static const double values[] = { 0.0, -0.0, 1.0, -1.5, 0.1, 1e20, 1e-7, 3.14159265358979, 123456789012345678.0,
+		std::numeric_limits < double >::max(), std::numeric_limits < double >::min(), std::numeric_limits < double >::infinity(), -std::numeric_limits < double >::infinity() };
+	for (double value: values) {
+		std::string out;
+		hbk::jet::telegramWriter::appendDouble(out, value);
+		ASSERT_EQ(out, jsoncppValue(value));
+	}
+	std::string out;
+	hbk::jet::telegramWriter::appendDouble(out, std::nan(""));
+	ASSERT_EQ(out, "null");
+}
+
+TEST(telegramWriter, testBool)
+{
+	std::string out;
+	hbk::jet::telegramWriter::appendBool(out, true);
+	ASSERT_EQ(out, jsoncppValue(true));
+	out.clear();
+	hbk::jet::telegramWriter::appendBool(out, false);
+	ASSERT_EQ(out, jsoncppValue(false));
+}
+
+TEST(telegramWriter, testString)
+{
+	std::string value("plain");
+	value += '\0';
+	value += "control \x01\x1f \b\f\n\r\t \"quoted\" back\\slash /";
+	std::string out;
+	hbk::jet::telegramWriter::appendString(out, value);
+	ASSERT_EQ(out, jsoncppValue(value));
+
+	// utf-8 with two, three and four byte sequences and some that are invalid
+	static const char* nonAscii[] = {
+		"gr\xc3\xbc\xc3\x9f",
+		"\xe2\x82\xac \xf0\x9f\x98\x80 \x7f",
+		"invalid \xff \xc0\x80 \xed\xa0\x80 \xf0\x82\x82\xac",
+		"truncated \xe2\x82",
+	};
+	for (const char* pValue : nonAscii) {
+		out.clear();
+		hbk::jet::telegramWriter::appendString(out, pValue);
+		ASSERT_EQ(out, jsoncppValue(pValue));
+	}
+	out.clear();
+	hbk::jet::telegramWriter::appendString(out, "gr\xc3\xbc\xc3\x9f");
+	ASSERT_EQ(out, "\"gr\\u00fc\\u00df\"");
+}
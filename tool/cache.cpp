@@ -39,85 +39,18 @@
 
 #include "hbk/sys/eventloop.h"
 
-#include "jet/peerasync.hpp"
+#include "jet/cache.hpp"
 #include "jet/defines.h"
+#include "jet/peerasync.hpp"
 
-#include "cache.h"
-
-namespace hbk {
-	namespace jet {
-		cache::cache(hbk::jet::PeerAsync& peer, hbk::jet::matcher_t match)
-			: m_peer(peer)
-			, m_match(match)
-			, m_cache()
-			, m_cacheMtx()
-		{
-			m_fetchId = m_peer.addFetchAsync(match, std::bind(&cache::fetchCb, this, std::placeholders::_1, std::placeholders::_2));
-		}
-
-		cache::~cache()
-		{
-			m_peer.removeFetchAsync(m_fetchId);
-		}
-
-		void cache::setCbs(Cb addCb, Cb changeCb, Cb removeCb)
-		{
-			m_addCb = addCb;
-			m_changeCb = changeCb;
-			m_removeCb = removeCb;
-		}
-
-		Json::Value cache::getEntry(const std::string& path) const
-		{
-			std::lock_guard < std::mutex > lock(m_cacheMtx);
-			const auto iter = m_cache.find(path);
-			if (iter!=m_cache.end()) {
-				return iter->second;
-			}
-			return Json::Value();
-		}
-
-		void cache::fetchCb( const Json::Value& params, int status)
-		{
-			if(status < 0) {
-				std::cerr << "Lost connection to jet daemon!" << std::endl;
-			} else {
-				if(params.isObject()) {
-					std::string event = params[hbk::jet::EVENT].asString();
-					std::string path = params[hbk::jet::PATH].asString();
-					const Json::Value value = params[hbk::jet::VALUE];
-
-					if (event==hbk::jet::CHANGE) {
-						std::lock_guard < std::mutex > lock(m_cacheMtx);
-						m_cache[path] = value;
-						if (m_changeCb) {
-							m_changeCb( path, value);
-						}
-					}
-					else if (event == hbk::jet::ADD) {
-						std::lock_guard < std::mutex > lock(m_cacheMtx);
-						m_cache[path] = value;
-						if (m_addCb) {
-							m_addCb( path, value);
-						}
-						std::cout << "cache does contain " << m_cache.size() << " element(s)" << std::endl;
-					} else if (event==hbk::jet::REMOVE) {
-						std::lock_guard < std::mutex > lock(m_cacheMtx);
-						m_cache.erase(path);
-						if (m_removeCb) {
-							m_removeCb( path, value);
-						}
-						std::cout << "cache does contain " << m_cache.size() << " element(s)" << std::endl;
-					}
-				}
-			}
-		}
-	}
-}
 
-static void print(const std::string& path, const Json::Value&, const::std::string& description)
+/// \param pCache number of elements is printed if given
+static void print(const std::string& path, const Json::Value&, const::std::string& description, const hbk::jet::cache* pCache)
 {
 	std::cout << "state '" << path << "' " << description << std::endl;
+	if (pCache) {
+		std::cout << "cache does contain " << pCache->size() << " element(s)" << std::endl;
+	}
 }
 
 static void printSyntax()
@@ -162,9 +95,9 @@ int main(int argc, char* argv[])
 		// of course you may have several notifiers referencing to the same jet peer.
 		hbk::jet::cache cache(peer, match);
 		cache.setCbs(
-					std::bind(&print, std::placeholders::_1, std::placeholders::_2, "added"),
-					std::bind(&print, std::placeholders::_1, std::placeholders::_2, "changed"),
-					std::bind(&print, std::placeholders::_1, std::placeholders::_2, "removed")
+					std::bind(&print, std::placeholders::_1, std::placeholders::_2, "added", &cache),
+					std::bind(&print, std::placeholders::_1, std::placeholders::_2, "changed", nullptr),
+					std::bind(&print, std::placeholders::_1, std::placeholders::_2, "removed", &cache)
 										);
 
 		eventloop.execute();
@@ -0,0 +1,145 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "json/value.h"
+#include "json/writer.h"
+
+#include "hbk/jsonrpc/jsonrpc_defines.h"
+
+#include "jet/defines.h"
+#include "jet/framedecoder.hpp"
+
+/// @ingroup tools
+/// This program compares the frame decoders of the jet peer. No jet daemon is needed.
+/// It decodes typical telegrams received by a fetching peer and outputs the average time per telegram.
+
+
+static const unsigned int cycleCount = 100000;
+
+/// counts what it gets. Only every second fetch is consumed. No requests are consumed.
+class CountingConsumer : public hbk::jet::FrameConsumer
+{
+public:
+	CountingConsumer()
+		: messageCount(0)
+		, fetchNotificationCount(0)
+	{
+	}
+
+	virtual void consumeMessage(const Json::Value&) override
+	{
+		++messageCount;
+	}
+
+	virtual bool isFetchConsumed(hbk::jet::fetchId_t fetchId) override
+	{
+		return (fetchId % 2)==0;
+	}
+
+	virtual bool isRequestConsumed(const std::string&) override
+	{
+		return false;
+	}
+
+	virtual void consumeFetchNotification(hbk::jet::fetchId_t, const Json::Value&) override
+	{
+		++fetchNotificationCount;
+	}
+
+	unsigned int messageCount;
+	unsigned int fetchNotificationCount;
+};
+
+static std::vector < std::string > composeTelegrams()
+{
+	Json::StreamWriterBuilder wBuilder;
+	wBuilder.settings_["indentation"] = "";
+	std::vector < std::string > telegrams;
+	for (hbk::jet::fetchId_t fetchId = 0; fetchId < 4; ++fetchId) {
+		Json::Value notification;
+		notification[hbk::jsonrpc::METHOD] = fetchId;
+		Json::Value& params = notification[hbk::jsonrpc::PARAMS];
+		params[hbk::jet::PATH] = "device/channel" + std::to_string(fetchId) + "/measuredValue";
+		params[hbk::jet::EVENT] = hbk::jet::CHANGE;
+		params[hbk::jet::VALUE]["value"] = 3.14159265358979 * fetchId;
+		params[hbk::jet::VALUE]["unit"] = "mV";
+		params[hbk::jet::VALUE]["timestamp"] = static_cast < Json::UInt64 > (1700000000123456789ULL);
+		for (unsigned int index = 0; index < 8; ++index) {
+			params[hbk::jet::VALUE]["history"].append(index * 0.5);
+		}
+		telegrams.push_back(Json::writeString(wBuilder, notification));
+	}
+
+	Json::Value request;
+	request[hbk::jsonrpc::ID] = 43;
+	request[hbk::jsonrpc::METHOD] = "device/unknown/state";
+	request[hbk::jsonrpc::PARAMS][hbk::jet::VALUE] = "some value";
+	telegrams.push_back(Json::writeString(wBuilder, request));
+
+	Json::Value response;
+	response[hbk::jsonrpc::ID] = 42;
+	response[hbk::jsonrpc::RESULT] = Json::Value(Json::objectValue);
+	telegrams.push_back(Json::writeString(wBuilder, response));
+	return telegrams;
+}
+
+static void measureDecoder(const std::string& name, hbk::jet::FrameDecoder& decoder, const std::vector < std::string >& telegrams)
+{
+	CountingConsumer consumer;
+	std::string errorMessage;
+	std::chrono::high_resolution_clock::time_point t1;
+	std::chrono::high_resolution_clock::time_point t2;
+
+	t1 = std::chrono::high_resolution_clock::now();
+	for (unsigned int cycle = 0; cycle<cycleCount; ++cycle) {
+		const std::string& telegram = telegrams[cycle % telegrams.size()];
+		if (!decoder.decode(telegram.c_str(), telegram.length(), consumer, errorMessage)) {
+			std::cerr << name << ": could not decode '" << telegram << "': " << errorMessage << std::endl;
+			return;
+		}
+	}
+	t2 = std::chrono::high_resolution_clock::now();
+	std::chrono::nanoseconds diff = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1);
+	std::cout << name << ": average time (" << cycleCount << " cycles) for decoding a telegram: " << diff.count()/cycleCount << "ns"
+		<< " (" << consumer.fetchNotificationCount << " fetch notifications, " << consumer.messageCount << " complete messages)" << std::endl;
+}
+
+int main()
+{
+	std::vector < std::string > telegrams = composeTelegrams();
+	std::cout << "Decoding " << telegrams.size() << " different telegrams. Notifications of half of the fetches and requests are not consumed." << std::endl;
+
+	hbk::jet::JsonFrameDecoder jsonDecoder;
+	measureDecoder("JsonFrameDecoder", jsonDecoder, telegrams);
+
+	hbk::jet::ScanningFrameDecoder scanningDecoder;
+	measureDecoder("ScanningFrameDecoder", scanningDecoder, telegrams);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,181 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+// This code is licenced under the MIT license:
+//
+// Copyright (c) 2024 Hottinger Brüel & Kjær
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "jet/compiledmatcher.hpp"
+#include "jet/defines.h"
+
+/// @ingroup tools
+/// This program measures the local evaluation of matchers. No jet daemon is needed.
+/// It evaluates typical matchers against 100000 paths and outputs the average time per path.
+/// The straight forward evaluation with std::string operations is the reference.
+
+
+static const unsigned int pathCount = 100000;
+
+static std::vector < std::string > composePaths()
+{
+	static const char hexDigits[] = "0123456789abcdef";
+	static const char* const leafs[] = { "measuredValue", "unit", "Range/Min", "Range/Max", "filter/cutOffFrequency", "name" };
+	std::mt19937 generator(42);
+	std::vector < std::string > paths;
+	paths.reserve(pathCount);
+	while (paths.size() < pathCount) {
+		std::string uuid;
+		for (unsigned int index = 0; index < 32; ++index) {
+			uuid += hexDigits[generator() % 16];
+		}
+		for (unsigned int channel = 0; (channel < 8) && (paths.size() < pathCount); ++channel) {
+			for (const char* pLeaf: leafs) {
+				if (paths.size() == pathCount) {
+					break;
+				}
+				paths.push_back("devices/routed/" + uuid + "/channel" + std::to_string(channel) + "/" + pLeaf);
+			}
+		}
+	}
+	return paths;
+}
+
+static std::vector < hbk::jet::matcher_t > composeMatchers(const std::vector < std::string >& paths)
+{
+	std::vector < hbk::jet::matcher_t > matchers;
+	hbk::jet::matcher_t matcher;
+
+	matcher.startsWith = "devices/routed/";
+	matcher.endsWith = "/measuredValue";
+	matchers.push_back(matcher);
+
+	matcher = hbk::jet::matcher_t();
+	matcher.contains = "channel7/range";
+	matcher.caseInsensitive = true;
+	matchers.push_back(matcher);
+
+	matcher = hbk::jet::matcher_t();
+	matcher.containsAllOf.push_back("/channel3/");
+	matcher.containsAllOf.push_back("filter");
+	matchers.push_back(matcher);
+
+	// widgets showing single states
+	for (unsigned int index = 0; index < 61; ++index) {
+		matcher = hbk::jet::matcher_t();
+		matcher.equals = paths[(index * 1609) % paths.size()];
+		matchers.push_back(matcher);
+	}
+	return matchers;
+}
+
+/// straight forward evaluation with std::string operations
+static bool matchReference(const hbk::jet::matcher_t& matcher, const std::string& path)
+{
+	std::string subject = matcher.caseInsensitive ? hbk::jet::CompiledMatcher::foldCase(path) : path;
+	auto prepare = [&matcher](const std::string& text)
+	{
+		return matcher.caseInsensitive ? hbk::jet::CompiledMatcher::foldCase(text) : text;
+	};
+	if ((!matcher.contains.empty()) && (subject.find(prepare(matcher.contains))==std::string::npos)) {
+		return false;
+	}
+	if ((!matcher.startsWith.empty()) && (subject.compare(0, matcher.startsWith.length(), prepare(matcher.startsWith))!=0)) {
+		return false;
+	}
+	if (!matcher.endsWith.empty()) {
+		if ((subject.length() < matcher.endsWith.length()) || (subject.compare(subject.length() - matcher.endsWith.length(), matcher.endsWith.length(), prepare(matcher.endsWith))!=0)) {
+			return false;
+		}
+	}
+	if ((!matcher.equals.empty()) && (subject!=prepare(matcher.equals))) {
+		return false;
+	}
+	if ((!matcher.equalsNot.empty()) && (subject==prepare(matcher.equalsNot))) {
+		return false;
+	}
+	for (const auto &iter: matcher.containsAllOf) {
+		if (subject.find(prepare(iter))==std::string::npos) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void report(const std::string& name, std::chrono::high_resolution_clock::time_point t1, size_t matchCount)
+{
+	std::chrono::high_resolution_clock::time_point t2 = std::chrono::high_resolution_clock::now();
+	std::chrono::nanoseconds diff = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1);
+	std::cout << name << ": average time (" << pathCount << " paths) for evaluating all matchers: " << diff.count()/pathCount << "ns"
+		<< " (" << matchCount << " matches)" << std::endl;
+}
+
+int main()
+{
+	std::vector < std::string > paths = composePaths();
+	std::vector < hbk::jet::matcher_t > matchers = composeMatchers(paths);
+	std::cout << "Evaluating " << matchers.size() << " matchers against " << paths.size() << " paths" << std::endl;
+
+	std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
+	size_t matchCount = 0;
+	for (const auto &path: paths) {
+		for (const auto &matcher: matchers) {
+			if (matchReference(matcher, path)) {
+				++matchCount;
+			}
+		}
+	}
+	report("reference", t1, matchCount);
+
+	std::vector < hbk::jet::CompiledMatcher > compiledMatchers;
+	for (const auto &matcher: matchers) {
+		compiledMatchers.push_back(hbk::jet::CompiledMatcher(matcher));
+	}
+	t1 = std::chrono::high_resolution_clock::now();
+	matchCount = 0;
+	for (const auto &path: paths) {
+		for (const auto &compiledMatcher: compiledMatchers) {
+			if (compiledMatcher.match(path)) {
+				++matchCount;
+			}
+		}
+	}
+	report("CompiledMatcher", t1, matchCount);
+
+	hbk::jet::MatcherSet matcherSet;
+	for (const auto &matcher: matchers) {
+		matcherSet.add(matcher);
+	}
+	std::vector < size_t > matches;
+	t1 = std::chrono::high_resolution_clock::now();
+	matchCount = 0;
+	for (const auto &path: paths) {
+		matcherSet.match(path, matches);
+		matchCount += matches.size();
+	}
+	report("MatcherSet", t1, matchCount);
+	return EXIT_SUCCESS;
+}
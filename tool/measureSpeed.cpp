@@ -29,6 +29,8 @@
 
 #include "json/value.h"
 
+#include "hbk/jsonrpc/jsonrpc_defines.h"
+
 #include "jet/peer.hpp"
 
 /// @ingroup tools
@@ -60,9 +62,10 @@ static void measureSetNotify(const std::string& address, unsigned int port)
 	std::cout << "-Notifying equals pushing a new value of an existing jet state from the jet peer to the jet daemon" << std::endl;
 	// Instances of hbk::jet::Peer have their own receiver thread.
 	hbk::jet::Peer jetPeer(address, port);
+	hbk::jet::StateHandle state;
 
 	try {
-		jetPeer.addStateAsync(STATE_PATH, Json::Value(), hbk::jet::responseCallback_t(), &stateCb);
+		state = jetPeer.addStateAsync(STATE_PATH, Json::Value(), hbk::jet::responseCallback_t(), &stateCb);
 	} catch (const std::runtime_error &e) {
 		std::cerr << __FUNCTION__ << ": Caught exception: " << e.what() << "!" << std::endl;
 	}
@@ -85,6 +88,15 @@ static void measureSetNotify(const std::string& address, unsigned int port)
 	std::chrono::microseconds diff = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1);
 	std::cout << "average time (" << cycleCount << " cycles) for notifying a state: " << diff.count()/cycleCount << "µs" << std::endl;
 
+	t1 = std::chrono::high_resolution_clock::now();
+	for (unsigned int cycle = 0; cycle<cycleCount; ++cycle) {
+		// path lookup and escaping were done once when adding the state
+		jetPeer.notifyState(state, cycle);
+	}
+	t2 = std::chrono::high_resolution_clock::now();
+	diff = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1);
+	std::cout << "average time (" << cycleCount << " cycles) for notifying a state via state handle: " << diff.count()/cycleCount << "µs" << std::endl;
+
 	try {
 		t1 = std::chrono::high_resolution_clock::now();
 		for (unsigned int cycle = 0; cycle<cycleCount; ++cycle) {
@@ -186,6 +198,30 @@ static void measureCreateStates(const std::string& address, unsigned int port)
 	} catch (const std::runtime_error &e) {
 		std::cerr << __FUNCTION__ << ": Caught exception: " << e.what() << "!" << std::endl;
 	}
+
+	std::cout << "Creating " << STATE_COUNT << " jet complex states at once" << std::endl;
+	std::vector < hbk::jet::StateSpec > states;
+	for (size_t stateIndex = 0; stateIndex<STATE_COUNT; ++stateIndex) {
+		Json::Value value;
+		value["asNumber"] = stateIndex;
+		value["asString"] = std::to_string(stateIndex);
+		states.push_back(hbk::jet::StateSpec(STATE_PATH + std::to_string(stateIndex), value, &stateCb));
+	}
+	t1 = std::chrono::high_resolution_clock::now();
+	std::vector < Json::Value > results = jetPeer.addStates(states);
+	t2 = std::chrono::high_resolution_clock::now();
+	diff = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1);
+	std::cout << "This took " << diff.count()/STATE_COUNT << " µs per state" << std::endl;
+	for (const auto& iter: results) {
+		if (iter.isMember(hbk::jsonrpc::ERR)) {
+			std::cerr << __FUNCTION__ << ": Adding state failed: " << iter[hbk::jsonrpc::ERR][hbk::jsonrpc::MESSAGE].asString() << "!" << std::endl;
+			break;
+		}
+	}
+
+	for (const auto& iter: states) {
+		jetPeer.removeStateAsync(iter.path);
+	}
 }
 
 int main(int argc, char *argv[])